@@ -0,0 +1,20 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Driver ADS1115 non-blocking. Satu konversi single-shot berjalan pada satu
+// waktu; channel di-round-robin (ADS_CHANNEL_SMPS, ADS_CHANNEL_12V). Tidak ada
+// busy-wait: adsAsyncPoll() hanya membaca register hasil bila konversi selesai.
+bool  adsAsyncBegin();
+bool  adsAsyncReady();
+
+// Task yang diberi notifikasi (xTaskNotifyGive) saat konversi selesai:
+// ALERT/RDY bila terpasang, selain itu esp_timer ADS_CONV_US sesudah start.
+// Tanpa ini adsAsyncPoll() hanya dipanggil per tick → laju jatuh ke ~500 SPS.
+void  adsAsyncSetWakeTask(TaskHandle_t task);
+
+// Jalankan state machine; true bila ada hasil baru (channel ADS & nilai mentah)
+bool  adsAsyncPoll(uint32_t nowUs, uint8_t& channel, int16_t& raw);
+
+float adsAsyncToVolts(int16_t raw);
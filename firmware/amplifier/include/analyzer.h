@@ -19,3 +19,4 @@ uint8_t analyzerGetVu();
 const char *analyzerGetMode();
 uint16_t analyzerGetUpdateMs();
 bool analyzerEnabled();
+bool analyzerI2sReady();  // driver I2S/ADC terpasang (health check boot OTA)
@@ -0,0 +1,35 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_partition.h>
+
+// Audit image firmware: SHA-256 partisi app dihitung bertahap di background
+// (AUDIT_HASH_CHUNK byte per auditTick) dan pembacaan mentah per rentang.
+
+// Slot: "running", "other" (slot OTA berikutnya), atau label partisi ("ota_0")
+const esp_partition_t* auditResolveSlot(const char* name);
+
+// Panjang yang di-hash per slot
+enum class AuditLen : uint8_t {
+  Image = 0,  // panjang image ESP dari header segmen (= sha256 file .bin)
+  Full,       // seluruh partisi
+  Bytes       // jumlah byte eksplisit
+};
+
+// Antre hash untuk 1..2 partisi; false bila masih sibuk atau argumen invalid
+bool auditHashStart(const esp_partition_t* const* parts, uint8_t count, AuditLen mode, uint32_t bytes);
+bool auditBusy();
+void auditTick(uint32_t now);
+
+// Hasil per slot, diambil comms untuk dikirim sebagai event "img"
+struct AuditResult {
+  const esp_partition_t* part;
+  bool ok;
+  const char* err;     // bila !ok
+  uint32_t len;        // byte yang di-hash
+  uint8_t sha256[32];
+  bool last;           // hasil terakhir dari permintaan ini
+};
+bool auditTakeResult(AuditResult& out);
+
+// Baca mentah (forensik); false bila rentang di luar partisi
+bool auditRead(const esp_partition_t* part, uint32_t offset, uint8_t* out, size_t len);
@@ -0,0 +1,53 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Kalibrasi voltmeter per unit (pengganti konstanta divider per build).
+//
+//   V_real = gain · V_adc + offset
+//
+// Default gain = (R1+R2)/R2, offset = 0 (SMPS) / V12_OFFSET_V (12V). Hasil
+// kalibrasi disimpan di NVS "dev/cal" (satu blob per channel, dengan CRC32)
+// dan diterapkan di pipeline sensor dalam fixed-point Q16 atas nilai mentah
+// ADS1115. Urutan: calibStart() dengan referensi terpasang → sampel dirata-rata
+// di task akuisisi → calibTakeResult() di loop → (opsional titik ke-2) →
+// calibCommit().
+
+enum class CalCh : uint8_t { Smps, V12, Count };
+
+enum class CalSource : uint8_t { Default, Nvs };
+
+struct CalInfo {
+  float     gain;
+  float     offsetV;
+  CalSource source;
+  uint32_t  epoch;     // waktu kalibrasi (RTC), 0 = tidak diketahui
+  uint8_t   points;    // titik yang dipakai saat kalibrasi tersimpan
+  uint8_t   pending;   // titik sesi berjalan (belum di-commit)
+};
+
+struct CalResult {
+  CalCh       ch;
+  bool        ok;
+  const char* err;     // bila !ok
+  uint8_t     idx;     // indeks titik dalam sesi
+  float       refV;
+  float       adcV;    // rata-rata sisi ADC
+  uint16_t    spread;  // LSB min..max
+};
+
+void  calibInit();                            // muat NVS; sebelum task akuisisi
+float calibApply(CalCh ch, int16_t raw);      // task akuisisi: mentah → volt
+void  calibFeed(CalCh ch, int16_t raw);       // task akuisisi: sampel capture
+
+// Mulai capture titik referensi; false + err bila ditolak
+bool  calibStart(CalCh ch, float refV, const char*& err);
+bool  calibTakeResult(uint32_t now, CalResult& out);  // loop: capture selesai
+bool  calibCommit(CalCh ch, const char*& err);        // hitung, simpan, terapkan
+void  calibAbort(CalCh ch);                           // buang titik sesi
+void  calibReset(CalCh ch);                           // kembali default + hapus NVS
+
+void  calibGet(CalCh ch, CalInfo& out);
+const char* calibChStr(CalCh ch);
+bool  calibChParse(const char* s, CalCh& out);
+const char* calibSourceStr(CalSource s);
@@ -0,0 +1,71 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "sensors.h"
+
+// Capture pra-trigger untuk forensik brown-out: ring SMPS/12V (tiap konversi
+// ADS) + suhu heatsink di RAM .noinit sehingga bertahan soft reset/WDT/brownout.
+// Ring beku saat proteksi trip (plus CAPTURE_POST_RECORDS sesudahnya) dan tetap
+// beku sampai di-arm ulang; isinya diunduh sebagai image biner via cap_read.
+//
+// Image (little-endian) = CaptureHeader (32 byte) + record lama → baru:
+//   record = u16 tc  : bit 15..14 channel (0 SMPS, 1 12V, 2 heatsink),
+//                      bit 13..0  millis & 0x3FFF (unwrap mundur dari last_ms)
+//            i16 val : SMPS 10 mV/LSB, 12V 1 mV/LSB, heatsink 0.01 °C/LSB
+// crc32 = CRC32 (zlib) atas seluruh image dengan field crc32 = 0.
+
+enum class CaptureReason : uint8_t {
+  None = 0,
+  SmpsLow,       // smpsProtectTick: V < cutoff saat ON
+  SmpsHwFault,   // opto SMPS_HW_FAULT
+  Otp,           // over-temperature
+  Reset,         // reboot tak terduga saat ring masih berjalan
+  Manual         // perintah cap_trigger
+};
+
+enum class CaptureState : uint8_t {
+  Armed = 0,     // ring berjalan
+  Triggered,     // menunggu record pasca-trigger
+  Frozen         // siap diunduh
+};
+
+struct __attribute__((packed)) CaptureHeader {
+  uint32_t magic;      // CAPTURE_MAGIC
+  uint8_t  version;
+  uint8_t  state;      // CaptureState
+  uint8_t  reason;     // CaptureReason
+  uint8_t  resetReason;// esp_reset_reason() saat reason = Reset
+  uint32_t trigMs;     // millis saat trigger (boot asal)
+  uint32_t lastMs;     // millis record terbaru
+  uint16_t head;       // indeks tulis berikutnya di ring
+  uint16_t count;      // jumlah record valid
+  uint16_t trigIdx;    // indeks record (urutan image) saat trigger
+  uint16_t recSize;    // byte per record (4)
+  uint32_t reserved;
+  uint32_t crc32;
+};
+static_assert(sizeof(CaptureHeader) == 32, "CaptureHeader harus 32 byte");
+
+struct CaptureInfo {
+  CaptureState  state;
+  CaptureReason reason;
+  uint8_t  resetReason;
+  bool     prevBoot;   // dibekukan pada boot sebelumnya
+  uint32_t trigMs;
+  uint16_t records;
+  uint32_t bytes;      // ukuran image (header + record)
+  uint32_t crc32;
+};
+
+void captureInit();                                  // sebelum task sensor berjalan
+void capturePush(SensorCh ch, uint32_t ms, float value);  // konteks akuisisi saja
+void captureTick(uint32_t now);                      // konteks akuisisi saja
+void captureTrigger(CaptureReason reason);           // aman dari loop; trigger pertama menang
+void captureRearm();                                 // buang dump, jalankan ring lagi
+                                                     // (langsung Armed bagi pembaca)
+
+CaptureState captureState();
+bool captureInfo(CaptureInfo& out);
+bool captureRead(uint32_t offset, uint8_t* dst, uint32_t len);  // hanya saat Frozen
+const char* captureReasonStr(CaptureReason reason);
+const char* captureStateStr(CaptureState state);
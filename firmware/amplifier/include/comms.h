@@ -13,6 +13,16 @@ void commsForceTelemetry();
 // Notifikasi OTA guard (agar panel tahu amplifier sedang OTA)
 void commsSetOtaReady(bool ready);
 
+// Kirim ulang snapshot "features" (mis. status health OTA berubah)
+void commsSendFeatures();
+
+// Waktu (millis) frame JSON valid terakhir dari panel via UART2; 0 = belum ada
+uint32_t commsLinkLastFrameMs();
+
+// {"type":"link","evt":"probe"} ke UART2 saja; bridge membalas probe_ack
+// sehingga link terbukti hidup tanpa menunggu PC/panel mengirim perintah
+void commsSendLinkProbe();
+
 // Kirim log singkat (opsional)
 void commsLog(const char* level, const char* msg);
 
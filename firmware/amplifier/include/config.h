@@ -19,8 +19,19 @@
 
 
 // ============================================================================
-//  DS18B20 (heatsink sensor)
+//  DS18B20 (heatsink + sensor suhu lain di bus OneWire yang sama)
+//  - ROM di-cache saat init; konversi broadcast lalu scratchpad tiap sensor
+//    dibaca per potongan kecil (cek CRC8) di tick berikutnya
+//  - Urutan indeks = urutan search ROM (stabil untuk set sensor yang sama)
+//  - Catu eksternal (VDD); mode parasit tidak didukung
 #define DS18B20_PIN            27
+#define DS18B20_MAX_SENSORS    4
+#define DS18B20_RESOLUTION     12     // bit (9..12); konversi 94..750 ms
+#define DS18B20_PERIOD_MS      1000   // jarak antar siklus konversi
+#define DS18B20_SLICE_BYTES    3      // byte scratchpad dibaca per tick
+#define DS18B20_HEATSINK_MASK  0x01   // bit indeks sensor yang dihitung sebagai heatsink (maks → OTP/fan)
+#define DS18B20_FAIL_LIMIT     3      // gagal beruntun sebelum sensor dianggap invalid
+#define DS18B20_RESCAN_MS      10000  // enumerasi ulang ROM selama tak ada heatsink sehat (sensor dicolok/diganti)
 
 //  Firmware meta
 // ============================================================================
@@ -37,7 +48,7 @@
 #define FEAT_RTC_TEMP_TELEMETRY      1   // kirim rtc_c di telemetri
 #define FEAT_SMPS_PROTECT_ENABLE     1
 #define FEAT_SPK_PROTECT_ENABLE      1
-#define FEAT_FILTER_DS18B20_SOFT     0   // filter software opsional
+#define FEAT_FILTER_DS18B20_SOFT     0   // median-3 tambahan untuk DS18B20 (FILT_HEAT_*)
 
 #define ANALYZER_WS_ENABLE            1
 #define ANALYZER_DEFAULT_MODE         "fft"
@@ -49,8 +60,8 @@
 #define WS_GAIN_DAMPEN                2
 
 #define TELEM_REALTIME_ENABLE         1
-#define TELEM_HZ_REALTIME             30
-#define TELEM_SLOW_HZ                 1
+#define TELEM_HZ_REALTIME             30     // 0 = tiap tick (maks. TELEM_SUB_MAX_HZ); rt mati via TELEM_REALTIME_ENABLE
+#define TELEM_SLOW_HZ                 1      // 0 = tiap tick (maks. TELEM_SUB_MAX_HZ)
 
 #define BTN_POWER_PIN                13      // tombol power utama (input), aktif LOW
 #define BTN_BOOT_PIN                 0
@@ -82,6 +93,16 @@
 // LED aktivitas UART (indikasi TX/RX). Tetap di GPIO2 (hanya LED).
 #define LED_UART_PIN             2
 
+// Parser perintah masuk (per port: UART2 & USB punya buffer sendiri)
+#define COMMS_UART_RX_BUF        2048   // ring buffer driver RX per port (UART2 & USB)
+#define COMMS_RX_LINE_MAX        4096   // panjang maksimum satu baris JSON
+#define COMMS_RX_MAX_LINES_TICK  8      // batas baris diproses per port per commsTick()
+#define COMMS_JSON_ARENA_BYTES   8192   // pool statis JsonDocument perintah (tanpa heap)
+// Window pipelining (features.cmd_window) diturunkan dari kapasitas buffer:
+// min(COMMS_RX_MAX_LINES_TICK, (COMMS_UART_RX_BUF + COMMS_RX_LINE_MAX) / COMMS_CMD_LINE_BUDGET)
+#define COMMS_CMD_LINE_BUDGET    512    // byte maks. satu perintah ter-pipeline (termasuk id & newline)
+#define COMMS_REQ_ID_MAX_LEN     32     // panjang maksimum "id" string (angka: uint32)
+
 
 // ============================================================================
 //  Tombol fisik
@@ -96,17 +117,38 @@
 // ============================================================================
 #define I2C_SDA                  21
 #define I2C_SCL                  22
+// Fast-mode: satu sampel ADS = tulis config + baca hasil (±0.25 ms @ 400 kHz,
+// ±1 ms @ 100 kHz); page OLED 128 byte ±3 ms menahan bus lebih singkat
+#define I2C_CLOCK_HZ             400000
+
+// Arbitrase bus: satu pemegang per transaksi, prioritas Critical (ADC proteksi)
+// > Normal (RTC) > Display (OLED, dikirim per page 128x8 di antara transaksi lain).
+#define I2C_BUS_TIMEOUT_MS       50     // batas tunggu lock; lewat → transaksi dilewati
+#define I2C_STATS_WINDOW_MS      1000   // jendela hitung utilisasi bus
+
+// Health perangkat I2C (sensor_health.h): probe alamat berkala dari task
+// akuisisi; gagal beruntun → recovery bus (9 clock SCL + STOP) & init ulang.
+#define SENSOR_HEALTH_PROBE_MS   250    // interval probe ADS1115 & RTC
+#define SENSOR_HEALTH_FAIL_ERRS  3      // probe gagal beruntun → FAILED
+#define SENSOR_HEALTH_RECOVER_MS 5000   // jeda antar percobaan recovery
+#define SENSOR_STUCK_SAMPLES     (4 * ADS_SPS_PER_CH)   // ~4 s nilai mentah ADS identik → STUCK
+#define SENSOR_STUCK_MIN_LSB     16     // |mentah| di bawah ini (≈0 V) tidak dicek stuck
 
 
 // ============================================================================
 //  RTC DS3231
 //  - Panel yang mengatur sync waktu → Amplifier (rate-limit & hanya bila offset besar)
 //  - SQW 1 Hz dipakai untuk pacing telemetri saat STANDBY
+//  - Jam software (rtc_clock.h): DS3231 dibaca sekali saat boot, lalu detik
+//    maju tiap tepi SQW + interpolasi micros(); diverifikasi ulang berkala
 // ============================================================================
 #define RTC_I2C_ADDR             0x68
 #define RTC_SQW_PIN              35     // Input SQW 1 Hz
 #define RTC_SYNC_MIN_OFFS_SEC    2      // Tulis RTC hanya jika offset > 2s
 #define RTC_SYNC_MIN_INTERVAL_H  24     // Rate limit sync (jam): 24h
+#define RTC_VERIFY_MS            (10UL * 60UL * 1000UL)  // baca ulang DS3231 (SQW sehat)
+#define RTC_VERIFY_NOSQW_MS      60000UL // baca ulang lebih sering bila SQW hilang
+#define RTC_SQW_TIMEOUT_MS       2500    // tanpa tepi selama ini → SQW dianggap hilang
 
 
 // ============================================================================
@@ -120,15 +162,17 @@
 
 
 // ============================================================================
-//  Voltmeter: ADS1115 (EKSTERNAL) — TANPA smoothing
+//  Voltmeter: ADS1115 (EKSTERNAL) — instant + terfilter (lihat FILT_*)
 //  
 //  Channel 0 (A0): SMPS 65V
 //  - Divider R1 ke Vin (atas) dan R2 ke GND (bawah)
-//  - Gunakan nilai REAL hasil pengukuran agar akurat
 //
 //  Channel 1 (A1): 12V Rail
-//  - Divider R1_12V dan R2_12V (nilai ACTUAL resistor fisik)
-//  - Kalibrasi via software offset (V12_OFFSET_V)
+//  - Divider R1_12V dan R2_12V + offset V12_OFFSET_V
+//
+//  Nilai divider/offset di bawah hanya DEFAULT (unit belum dikalibrasi).
+//  Per unit, gain/offset diukur lewat perintah "cal" (referensi tegangan
+//  diketahui) dan disimpan di NVS "dev/cal" → satu image untuk semua unit.
 // ============================================================================
 #define ADS_I2C_ADDR             0x48
 
@@ -142,13 +186,77 @@
 #define R1_12V_OHMS              29630.0f   // 29.63 kΩ (ACTUAL resistor, jangan diubah)
 #define R2_12V_OHMS              9870.0f    // 9.87 kΩ (ACTUAL resistor, jangan diubah)
 
-// Software calibration offset untuk 12V
-// Measured: 12.20V → Actual: 12.17V
-#define V12_OFFSET_V             (-0.010f)    // Software calibration offset
+// Offset default 12V (dipakai bila belum ada kalibrasi NVS)
+#define V12_OFFSET_V             (-0.010f)
+
+// Kalibrasi (calib.h): rata-rata CAL_AVG_SAMPLES konversi mentah per titik;
+// 1 titik = koreksi gain (offset default), 2 titik = gain + offset
+#define CAL_AVG_SAMPLES          256
+#define CAL_MAX_SPREAD_LSB       80     // min..max mentah selama capture (~10 mV ADC)
+#define CAL_TIMEOUT_MS           3000   // capture gagal bila ADS berhenti
+#define CAL_MIN_ADC_V            0.10f  // tegangan ADC minimum satu titik
+#define CAL_MIN_SPAN_ADC_V       0.20f  // jarak minimum dua titik (sisi ADC)
+#define CAL_GAIN_TOL             0.10f  // gain hasil maks. ±10% dari default
+#define CAL_OFFSET_MAX_V         1.0f   // |offset| hasil maksimum
 
 // Bawah ambang ini dianggap "tidak ada daya" (noise floor)
 #define VOLT_MIN_VALID_V         0.0f
 
+// Sampling asinkron: konversi single-shot bergiliran A0/A1, hasil diambil
+// saat ALERT/RDY turun (atau timer ADS_CONV_US bila pin tidak dipasang); task
+// akuisisi dibangunkan tepat saat itu, bukan per tick. Data rate 860 SPS
+// (noise ekstra diredam rantai FILT_*), tetapi single-shot + I2C per sampel
+// membuat laju efektif di bawahnya: ADS_SPS_EFFECTIVE total, dibagi 2 channel.
+#define ADS_DATA_RATE            RATE_ADS1115_860SPS
+#define ADS_CONV_US              1300   // 1/860 = 1163 µs; osilator internal -10% → 1279 µs
+#define ADS_I2C_US               250    // tulis config + baca hasil @ I2C_CLOCK_HZ
+#define ADS_ALERT_PIN            -1     // GPIO ALERT/RDY (open-drain), -1 = timer
+#define ADS_SPS_EFFECTIVE        (1000000 / (ADS_CONV_US + ADS_I2C_US))   // ≈645 total
+#define ADS_SPS_PER_CH           (ADS_SPS_EFFECTIVE / 2)                  // ≈322 per channel
+
+// Task akuisisi sensor (ADS1115, DS18B20, suhu RTC) dengan periode tetap.
+// Sampel bertimestamp masuk ring per channel (SENSOR_RING_LEN, pangkat 2).
+#ifndef SENSORS_TASK_ENABLE
+#define SENSORS_TASK_ENABLE      1      // 0 = akuisisi inline di sensorsTick()
+#endif
+#define SENSORS_TASK_PERIOD_MS   1      // DS18B20/health/RTC; ADS dibangunkan per konversi
+#define SENSORS_TASK_STACK       4096
+#define SENSORS_TASK_PRIO        3      // di atas loop Arduino (1)
+#define SENSORS_TASK_CORE        1
+#define SENSOR_RING_LEN          64
+
+// Rantai filter per channel (filters.h): median-of-N → moving average N →
+// IIR α (bobot sampel baru) ; envelope = blok min/max sampel mentah.
+// Proteksi memakai nilai terfilter; telemetri mengirim instant + terfilter.
+// SMPS/12V: ADS_SPS_PER_CH (≈322) sampel/s per channel → ~17 ms (SMPS) /
+// ~28 ms (12V) latensi median + moving average.
+#define FILT_SMPS_MEDIAN         5
+#define FILT_SMPS_AVG            8
+#define FILT_SMPS_IIR            1.0f   // 1 = bypass
+#define FILT_SMPS_ENV            ADS_SPS_PER_CH   // ≈1 s
+#define FILT_V12_MEDIAN          5
+#define FILT_V12_AVG             15
+#define FILT_V12_IIR             1.0f
+#define FILT_V12_ENV             ADS_SPS_PER_CH
+// DS18B20 (1 sampel/s): pengganti IIR 0.7/0.3 lama
+#define FILT_HEAT_MEDIAN         (FEAT_FILTER_DS18B20_SOFT ? 3 : 1)
+#define FILT_HEAT_AVG            1
+#define FILT_HEAT_IIR            0.3f
+#define FILT_HEAT_ENV            60
+#define FILT_RTC_MEDIAN          1
+#define FILT_RTC_AVG             1
+#define FILT_RTC_IIR             1.0f
+#define FILT_RTC_ENV             0
+
+// Capture pra-trigger (capture.h): SMPS/12V tiap konversi + suhu heatsink di
+// RAM .noinit, beku saat proteksi trip / reset tak terduga. 4 byte/record.
+#ifndef CAPTURE_ENABLE
+#define CAPTURE_ENABLE           1
+#endif
+#define CAPTURE_RECORDS          4096   // 16 KiB ≈ 6.3 s pra-trigger @ ADS_SPS_EFFECTIVE
+#define CAPTURE_POST_RECORDS     256    // record sesudah trigger (±0.4 s)
+#define CAPTURE_POST_MAX_MS      500    // beku paksa bila ADS berhenti
+
 
 // ============================================================================
 //  Proteksi SMPS 65V
@@ -227,6 +335,28 @@
 // Duty fallback bila FAILSAFE
 #define FAN_FALLBACK_DUTY        900
 
+// Proteksi termal
+#define OTP_TRIP_C               85.0f  // trip keras (heatsink terfilter)
+
+// Model termal (thermal.h): prediksi + feed-forward kipas + peringatan dini OTP
+#ifndef THERMAL_MODEL_ENABLE
+#define THERMAL_MODEL_ENABLE     1
+#endif
+#define THERMAL_STEP_S           20     // periode update/learning (kuantisasi DS18B20 ≈0.19 °C/menit)
+#define THERMAL_HORIZON_S        180    // jarak prediksi
+#define THERMAL_V_NOM            65.0f  // normalisasi V SMPS pada proksi daya
+#define THERMAL_AMBIENT_C        30.0f  // bila suhu RTC tidak tersedia
+#define THERMAL_LMS_MU           0.05f  // langkah NLMS
+#define THERMAL_MIN_UPDATES      30     // ≥ 10 menit data sebelum prediksi dipakai
+#define THERMAL_MAX_ERR_CPM      0.6f   // galat rata-rata maks (°C/menit) agar "ready"
+#define THERMAL_FF_RELIEF_C      5.0f   // kipas boleh "merasa" lebih dingin maks. sekian
+#define THERMAL_SAVE_MS          (30UL * 60UL * 1000UL)
+// θ awal (°C/menit): idle, beban penuh, rugi alami & rugi kipas per 10 °C ΔT
+#define THERMAL_DEFAULT_IDLE     0.5f
+#define THERMAL_DEFAULT_LOAD     6.0f
+#define THERMAL_DEFAULT_LOSS     0.2f
+#define THERMAL_DEFAULT_FAN      1.5f
+
 
 // ============================================================================
 //  Buzzer (LEDC)
@@ -288,13 +418,68 @@
 //  - TELEM_REALTIME_ENABLE mengatur kanal ~30 Hz (rt) untuk Analyzer/VU/link
 //  - TELEM_SLOW_HZ mengatur kanal lambat (hz1) berisi status lengkap & NVS snapshot
 //  - Struktur JSON: {type:"telemetry", rt:{...}, hz1:{...}}
+//  - Panel bisa memilih stream & rate sendiri via cmd "subscribe" (per sesi,
+//    reset ke default saat boot). Stream: spectrum, vu, link (rt) serta
+//    power, sensors, nvs (hz1).
 // ============================================================================
+#define TELEM_SUB_MAX_HZ              60     // rate maksimum per stream
+#define TELEM_SUB_MAX_INTERVAL_MS     60000  // rate minimum per stream (1/menit)
 
 // ============================================================================
 //  OTA via UART (Panel) — ukuran maksimum file .bin
 //  - Lakukan verifikasi ukuran & checksum sebelum switch partisi
 // ============================================================================
 #define OTA_MAX_BIN_SIZE         (1024*1024)  // 1 MiB batas aman
+
+// Mode biner (ota_begin {"mode":"bin"}): frame [A5][type][seq][len][data][crc32]
+// menggantikan base64-in-JSON. Kedua mode memakai window OTA_WINDOW chunk
+// in-flight dengan retransmit selektif (chunk ≤ OTA_BIN_FRAME_MAX di-reorder).
+#define OTA_BIN_FRAME_MAX        1024   // payload maksimum per frame / slot reorder
+#define OTA_WINDOW               4      // chunk in-flight maksimum (reorder = window-1 slot)
+#define OTA_BIN_ACK_EVERY        2      // ack kumulatif tiap N frame
+#define OTA_BIN_IDLE_MS          3000   // tanpa byte selama ini → port kembali ke JSON
+#define OTA_HS_WINDOW_MAX_BITS   12     // window heatshrink maks. (2^12 = 4 KiB RAM statis)
+// Data image dikumpulkan per sektor flash sebelum Update.write(). Dengan
+// OTA_WRITER_TASK=1 erase/program sektor dijalankan task terpisah (ping-pong
+// 2 buffer) sehingga parsing UART berikutnya tidak menunggu flash.
+#define OTA_SECTOR_BUF           4096   // = SPI_FLASH_SEC_SIZE
+#ifndef OTA_WRITER_TASK
+#define OTA_WRITER_TASK          1      // 0 = tulis sinkron di loop utama
+#endif
+#define OTA_WRITER_STACK         4096
+#define OTA_WRITER_PRIO          2
+#define OTA_WRITER_CORE          0
+#define OTA_WRITER_WAIT_MS       3000   // batas tunggu buffer bebas / flush terakhir
+// Image bertanda tangan ECDSA P-256 (trailer JSIG, lihat ota_sig.h). Kunci
+// publik di include/ota_pubkey.h. Begitu kunci di-provision, tanda tangan
+// wajib (image tanpa "sig" ditolak di ota_begin) — tidak bergantung klien.
+#include "ota_pubkey.h"
+#ifndef OTA_SIGN_REQUIRED
+#define OTA_SIGN_REQUIRED        (OTA_SIGN_PUBKEY_LEN > 0)
+#endif
+#if OTA_SIGN_REQUIRED && OTA_SIGN_PUBKEY_LEN == 0
+#error "OTA_SIGN_REQUIRED=1 tetapi include/ota_pubkey.h belum berisi kunci (ota_pack.py keygen)"
+#endif
+#define OTA_SIGN_TARGET          "jacktor-amp"  // target id di trailer (tolak image board lain)
+// Rollback otomatis: image baru boot dalam status PENDING_VERIFY dan baru
+// ditandai valid setelah health check lolos (sensor, I2S, link UART, tidak
+// reset selama OTA_HEALTH_MIN_MS). Reset/crash sebelum itu → bootloader
+// kembali ke slot lama; gagal sampai OTA_HEALTH_TIMEOUT_MS → rollback paksa.
+#ifndef OTA_ROLLBACK_ENABLE
+#define OTA_ROLLBACK_ENABLE      1
+#endif
+#define OTA_HEALTH_MIN_MS        30000
+#define OTA_HEALTH_TIMEOUT_MS    120000
+#define OTA_HEALTH_REQUIRE_LINK  1      // wajib ada frame JSON valid dari panel
+#define OTA_HEALTH_PROBE_MS      2000   // interval link probe selama PENDING (dibalas bridge)
+
+// Audit image (img_hash / img_read): hash SHA-256 slot app di background
+#define AUDIT_HASH_CHUNK         4096   // byte flash di-hash per auditTick (~1 ms)
+// Satu event img_read/cap_read = envelope JSON + data_b64 dalam SATU baris,
+// yang harus muat di buffer baris bridge (BRIDGE_MAX_FRAME 2048 termasuk '\n').
+#define COMMS_PEER_LINE_MAX      2048   // = BRIDGE_MAX_FRAME firmware/bridge
+#define AUDIT_READ_ENVELOPE      255    // type/evt/slot/offset/len/id + tanda kutip
+#define AUDIT_READ_MAX           1344   // byte maks. per img_read/cap_read (base64 1792 char)
 #ifndef OTA_ENABLE
 #define OTA_ENABLE               1
 #endif
@@ -303,7 +488,7 @@
 /*
 Checklist cepat ketika ganti hardware:
 - [ ] Pastikan tidak ada konflik pin (lihat semua #define PIN_*)
-- [ ] Ubah R1_OHMS / R2_OHMS sesuai hasil pengukuran
+- [ ] Kalibrasi voltmeter per unit via perintah "cal" (R1_OHMS/R2_OHMS = default)
 - [ ] Sesuaikan kurva kipas jika karakter kipas berbeda
 - [ ] Jika OLED/RTC/ADS alamatnya berbeda, ubah *_I2C_ADDR
 - [ ] Analyzer default diatur via ANALYZER_DEFAULT_* dan TELEM_HZ_REALTIME
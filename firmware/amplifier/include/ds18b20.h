@@ -0,0 +1,24 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Driver DS18B20 non-blocking berbasis ROM. Enumerasi bus hanya saat
+// ds18b20Begin() (boot, dan diulang sensors.cpp tiap DS18B20_RESCAN_MS selama
+// tidak ada sensor heatsink sehat); ds18b20Poll() menjalankan satu potongan pendek
+// per panggilan (reset / select / beberapa byte), sehingga jendela interrupt
+// mati OneWire tidak pernah lebih dari beberapa slot bit berturut-turut.
+
+struct Ds18b20Reading {
+  uint8_t idx;    // indeks sensor (urutan ROM)
+  bool    ok;     // presence + CRC8 valid
+  float   tempC;  // NAN bila !ok
+  bool    last;   // sensor terakhir pada siklus ini
+};
+
+uint8_t ds18b20Begin();                          // jumlah sensor yang ditemukan (blocking, ±15 ms/sensor)
+uint8_t ds18b20Count();
+const uint8_t* ds18b20Rom(uint8_t idx);          // 8 byte ROM atau nullptr
+uint32_t ds18b20Errors(uint8_t idx);             // total CRC/presence gagal
+
+// true bila satu pembacaan sensor selesai (berhasil atau gagal)
+bool ds18b20Poll(uint32_t nowMs, Ds18b20Reading& out);
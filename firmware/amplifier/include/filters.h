@@ -0,0 +1,81 @@
+#pragma once
+#include <Arduino.h>
+
+// Pustaka filter kecil untuk sampel sensor. Semua stage berukuran tetap
+// (tanpa heap) dan dikonfigurasi saat runtime; panjang > kFilterMaxTaps diklem.
+// Urutan rantai: median-of-N (tolak spike) → moving average → IIR satu kutub,
+// plus envelope min/max per blok atas sampel mentah (lebar noise/ripple).
+static constexpr uint8_t kFilterMaxTaps = 15;
+
+struct FilterConfig {
+  uint8_t  median;     // N median (ganjil), 1 = bypass
+  uint8_t  average;    // N moving average, 1 = bypass
+  float    iirAlpha;   // bobot sampel baru 0..1, 1 = bypass
+  uint16_t envelope;   // panjang blok min/max (sampel), 0 = mati
+};
+
+class MedianFilter {
+ public:
+  void  configure(uint8_t n);
+  void  reset();
+  float push(float x);
+
+ private:
+  float   buf_[kFilterMaxTaps] = {};
+  uint8_t n_ = 1, idx_ = 0, count_ = 0;
+};
+
+class MovingAverage {
+ public:
+  void  configure(uint8_t n);
+  void  reset();
+  float push(float x);
+
+ private:
+  float   buf_[kFilterMaxTaps] = {};
+  uint8_t n_ = 1, idx_ = 0, count_ = 0;
+};
+
+class OnePoleIir {
+ public:
+  void  configure(float alpha);
+  void  reset() { y_ = NAN; }
+  float push(float x);
+
+ private:
+  float alpha_ = 1.0f;
+  float y_ = NAN;
+};
+
+// Min/max per blok `n` sampel; hasil blok terakhir tersedia via lo()/hi()
+class MinMaxEnvelope {
+ public:
+  void  configure(uint16_t n);
+  void  reset();
+  bool  push(float x);   // true saat satu blok selesai
+  bool  valid() const { return valid_; }
+  float lo() const { return lo_; }
+  float hi() const { return hi_; }
+
+ private:
+  uint16_t n_ = 0, count_ = 0;
+  float curLo_ = 0.0f, curHi_ = 0.0f;
+  float lo_ = NAN, hi_ = NAN;
+  bool  valid_ = false;
+};
+
+class FilterChain {
+ public:
+  void  configure(const FilterConfig& cfg);
+  void  reset();
+  float push(float x);   // kembalikan keluaran terfilter
+  float value() const { return out_; }
+  const MinMaxEnvelope& envelope() const { return env_; }
+
+ private:
+  MedianFilter   median_;
+  MovingAverage  avg_;
+  OnePoleIir     iir_;
+  MinMaxEnvelope env_;
+  float out_ = NAN;
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Penjadwal transaksi I2C (RTC, ADS1115, OLED berbagi Wire).
+// Pemegang lock menahan bus selama satu transaksi pendek; pemohon berprioritas
+// rendah mengalah selama ada pemohon berprioritas lebih tinggi yang menunggu.
+enum class I2cPrio : uint8_t {
+  Critical = 0,   // pembacaan ADC proteksi
+  Normal,         // RTC & lainnya
+  Display,        // transfer OLED (per page)
+  Count
+};
+
+struct I2cBusStats {
+  float    utilPct;                                             // utilisasi jendela terakhir
+  uint32_t txCount;                                             // total transaksi sejak boot
+  uint32_t timeouts;                                            // lock gagal didapat
+  uint32_t waitMaxUs[static_cast<size_t>(I2cPrio::Count)];      // tunggu terlama per prioritas
+  uint32_t holdMaxUs;                                           // transaksi terlama
+  uint32_t recoveries;                                          // i2cBusRecover() dijalankan
+};
+
+void i2cBusInit();
+
+// true bila bus didapat; tiap acquire sukses wajib dipasangkan i2cBusRelease()
+bool i2cBusAcquire(I2cPrio prio, uint32_t timeoutMs = I2C_BUS_TIMEOUT_MS);
+void i2cBusRelease();
+
+// Ada pemohon Critical yang sedang menunggu (transfer panjang sebaiknya mengalah)
+bool i2cBusCriticalPending();
+
+void i2cBusGetStats(I2cBusStats& out);
+
+// Alamat menjawab ACK (lock diambil sendiri); false juga bila lock gagal
+bool i2cBusProbe(uint8_t addr, I2cPrio prio, bool& lockOk);
+
+// Slave yang menahan SDA: lepas dengan 9 clock SCL + STOP, lalu Wire.begin
+// ulang. Lock Critical diambil sendiri; true bila SDA bebas sesudahnya.
+bool i2cBusRecover();
+const char* i2cPrioStr(I2cPrio prio);
+
+// RAII: lock dilepas otomatis di akhir scope
+class I2cBusLock {
+ public:
+  explicit I2cBusLock(I2cPrio prio, uint32_t timeoutMs = I2C_BUS_TIMEOUT_MS)
+    : ok_(i2cBusAcquire(prio, timeoutMs)) {}
+  ~I2cBusLock() { if (ok_) i2cBusRelease(); }
+  I2cBusLock(const I2cBusLock&) = delete;
+  I2cBusLock& operator=(const I2cBusLock&) = delete;
+  bool ok() const { return ok_; }
+
+ private:
+  bool ok_;
+};
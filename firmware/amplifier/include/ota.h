@@ -13,14 +13,36 @@ enum class OtaStatus : uint8_t {
 void otaInit();
 void otaTick(uint32_t now);
 
+// Kompresi stream OTA (opsional)
+enum class OtaComp : uint8_t {
+  None = 0,
+  Heatshrink
+};
+
+// Opsi stream OTA. Urutan pipa: transport → dekompresi → patch delta → flash.
+struct OtaBeginOptions {
+  OtaComp comp;
+  uint8_t hsWindowBits;      // heatshrink W
+  uint8_t hsLookaheadBits;   // heatshrink L
+  bool delta;                // stream = patch terhadap partisi app yang berjalan
+  size_t streamSize;         // byte yang akan dikirim (0 = sama dengan ukuran image)
+  bool hasSha256;            // SHA-256 image final (wajib untuk delta)
+  uint8_t sha256[32];
+  bool hasSrcSha256;         // opsional: sumber delta harus cocok (esp_partition_get_sha256)
+  uint8_t srcSha256[32];
+  bool sig;                  // image final diakhiri trailer JSIG (ota_sig.h), diverifikasi sebelum boot switch
+};
+
 // Mulai sesi OTA.
 // - expectedSize : ukuran file .bin (wajib, >0, <= OTA_MAX_BIN_SIZE)
 // - expectedCrc32: CRC32 file penuh (0 = lewati cek CRC, selain 0 = wajib cocok)
+// - opt          : nullptr = stream mentah. Ukuran, CRC & SHA-256 selalu atas
+//                  image final (hasil dekompresi/patch, termasuk trailer tanda tangan).
 // Return: true jika sesi berhasil disiapkan, false bila gagal (lihat otaLastError()).
-bool otaBegin(size_t expectedSize, uint32_t expectedCrc32);
+bool otaBegin(size_t expectedSize, uint32_t expectedCrc32, const OtaBeginOptions* opt = nullptr);
 
-// Tulis blok data biner ke partisi OTA aktif.
-// Return: jumlah byte yang benar-benar ditulis; -1 jika error (cek otaLastError()).
+// Tulis blok data stream (mentah/terkompresi) ke partisi OTA aktif.
+// Return: jumlah byte stream yang dikonsumsi; -1 jika error (cek otaLastError()).
 int  otaWrite(const uint8_t* data, size_t len);
 
 // Akhiri sesi OTA.
@@ -31,9 +53,26 @@ bool otaEnd(bool doReboot);
 // Batalkan sesi OTA yang sedang berjalan (rollback & clear flag).
 void otaAbort();
 
+// Health check boot setelah OTA (app rollback IDF)
+enum class OtaHealth : uint8_t {
+  Disabled = 0,  // rollback tidak aktif / status partisi tidak tersedia
+  Valid,         // image sudah valid sejak boot (bukan boot pertama setelah OTA)
+  Pending,       // boot pertama image baru, health check berjalan
+  Passed         // health check lolos di boot ini, image ditandai valid
+};
+OtaHealth otaHealth();
+const char* otaHealthStr();       // "disabled" | "valid" | "pending" | "passed"
+const char* otaLastInvalidSlot();  // label slot terakhir yang ditolak/di-rollback, atau nullptr
+
 // Status & diagnostics
 OtaStatus otaStatus();
 const char* otaLastError();  // pesan terakhir (ringkas, untuk log/telemetry)
 
+// Progres sesi aktif: image tertulis ke flash vs byte stream yang diterima
+size_t otaWrittenBytes();
+size_t otaExpectedSize();
+size_t otaReceivedBytes();
+size_t otaStreamSize();
+
 // (Opsional) utility flush jika transport punya batas pacing
 void otaYieldOnce();
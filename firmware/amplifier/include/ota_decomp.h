@@ -0,0 +1,19 @@
+#pragma once
+#include <Arduino.h>
+
+// Dekompresor streaming heatshrink (LZSS) untuk image OTA terkompresi.
+// Format bit (MSB dulu): '1' + 8 bit literal, atau '0' + W bit (offset-1)
+// + L bit (panjang-1). Window 2^W byte statis (W ≤ OTA_HS_WINDOW_MAX_BITS),
+// input boleh terpotong di batas bit mana pun.
+
+// Sink output terdekompresi; return false untuk menghentikan stream
+typedef bool (*OtaDecompSink)(const uint8_t *data, size_t len);
+
+// Siapkan decoder. Return false bila parameter W/L tidak didukung.
+bool otaDecompBegin(uint8_t windowBits, uint8_t lookaheadBits, OtaDecompSink sink);
+
+// Umpan data terkompresi. Return false bila sink menolak output.
+bool otaDecompFeed(const uint8_t *in, size_t len);
+
+// Kirim sisa output yang masih di-buffer ke sink.
+bool otaDecompFlush();
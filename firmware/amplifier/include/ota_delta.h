@@ -0,0 +1,23 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_partition.h>
+
+// Patch delta (gaya bsdiff) terhadap partisi app yang sedang berjalan.
+// Stream patch:
+//   "JDP1"
+//   berulang: varint diffLen, varint extraLen, zigzag-varint seek,
+//             diffLen byte  (out = src[pos++] + diff, mod 256),
+//             extraLen byte (disalin apa adanya),
+//             pos += seek
+// Varint = LEB128 (7 bit per byte, LSB dulu). Data diff yang hampir
+// semuanya nol sebaiknya dikirim dengan kompresi heatshrink.
+#define OTA_DELTA_MAGIC "JDP1"
+
+typedef bool (*OtaDeltaSink)(const uint8_t *data, size_t len);
+
+bool otaDeltaBegin(const esp_partition_t *src, OtaDeltaSink sink);
+bool otaDeltaFeed(const uint8_t *in, size_t len);
+
+// true bila parser berhenti di batas perintah (patch tidak terpotong)
+bool otaDeltaComplete();
+const char *otaDeltaError();
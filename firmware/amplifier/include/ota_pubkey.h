@@ -0,0 +1,8 @@
+#pragma once
+#include <stdint.h>
+
+// Kunci publik ECDSA P-256 (DER SubjectPublicKeyInfo) untuk image OTA bertanda tangan.
+// Dibuat oleh: python tools/ota_pack.py keygen ota_sign_key.pem
+// Private key JANGAN di-commit. Panjang 0 = belum di-provision (image "sig" ditolak).
+#define OTA_SIGN_PUBKEY_LEN 0
+static const uint8_t kOtaSignPubKey[] = {0x00};
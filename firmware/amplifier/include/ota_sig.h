@@ -0,0 +1,23 @@
+#pragma once
+#include <Arduino.h>
+
+// Trailer tanda tangan image OTA (OTA_SIG_TRAILER_LEN byte, ditempel di akhir
+// image .bin; ikut dikirim/dikompresi/di-patch bersama image, tidak ditulis ke flash):
+//   [0]  "JSIG"
+//   [4]  versi (1), [5..7] cadangan (0)
+//   [8]  target id, NUL-padded (harus sama dengan OTA_SIGN_TARGET)
+//   [32] panjang signature DER
+//   [33] signature ECDSA P-256 (DER), sisa diisi 0
+// Yang ditandatangani: SHA-256(image || trailer[0..32)).
+#define OTA_SIG_MAGIC        "JSIG"
+#define OTA_SIG_VERSION      1
+#define OTA_SIG_TRAILER_LEN  128
+#define OTA_SIG_SIGNED_LEN   32    // header trailer yang ikut di-hash
+#define OTA_SIG_TARGET_MAX   24
+
+// Kunci publik sudah di-provision (include/ota_pubkey.h tidak kosong)
+bool otaSigAvailable();
+
+// digest = SHA-256(image || trailer[0..OTA_SIG_SIGNED_LEN)), dihitung pemanggil
+bool otaSigVerify(const uint8_t digest[32], const uint8_t trailer[OTA_SIG_TRAILER_LEN]);
+const char *otaSigError();
@@ -0,0 +1,60 @@
+#pragma once
+#include <Arduino.h>
+
+// Framing biner OTA (dipakai setelah ota_begin {"mode":"bin"}).
+// Layout frame (little-endian):
+//   [0xA5][type u8][seq u16][len u16][payload len byte][crc32 u32]
+// CRC32 (jacktorCrc32, sama dengan crc32 ota_begin) dihitung atas header + payload.
+#define OTA_FRAME_MAGIC     0xA5
+#define OTA_FRAME_HDR_LEN   6
+#define OTA_FRAME_OVERHEAD  (OTA_FRAME_HDR_LEN + 4)
+
+enum class OtaFrameType : uint8_t {
+  Data = 0x01,  // potongan image berurutan (seq naik, wrap di 16 bit)
+  Ctrl = 0x02   // payload = satu baris JSON perintah (mis. ota_end/ota_abort)
+};
+
+enum class OtaFrameStatus : uint8_t {
+  NeedMore = 0,  // frame belum lengkap di buffer
+  Frame,         // frame valid; consumed = panjang frame
+  BadCrc,        // header masuk akal tapi CRC salah; consumed = 1 (resync)
+  BadHeader      // bukan awal frame; consumed = byte yang dilewati sampai magic
+};
+
+struct OtaFrame {
+  OtaFrameType type;
+  uint16_t seq;
+  uint16_t len;
+  const uint8_t *payload;  // menunjuk ke dalam buffer input
+};
+
+// Dekode satu frame dari awal buf[0..len). Tidak menyalin payload.
+// maxPayload: frame dengan len lebih besar dianggap header rusak.
+OtaFrameStatus otaFrameDecode(const uint8_t *buf, size_t len, size_t maxPayload,
+                              OtaFrame &out, size_t &consumed);
+
+// ---- Penerimaan chunk ber-seq (selective repeat) ----
+// Dipakai jalur biner maupun JSON. Chunk seq == next langsung ditulis;
+// chunk di depan (≤ OTA_WINDOW-1 langkah) disimpan di reorder buffer lalu
+// ditulis begitu celahnya terisi. Duplikat diabaikan (idempotent).
+enum class OtaChunkResult : uint8_t {
+  Written = 0,   // seq == next (beserta chunk tertunda yang kini berurutan)
+  Buffered,      // di depan next, disimpan menunggu celah
+  Duplicate,     // sudah diterima sebelumnya
+  OutOfWindow,   // terlalu jauh di depan / terlalu besar untuk slot
+  WriteError     // otaWrite gagal (lihat otaLastError())
+};
+
+void otaSeqReset(uint32_t nextSeq);
+uint32_t otaSeqNext();
+OtaChunkResult otaSeqAccept(uint32_t seq, const uint8_t *data, size_t len);
+
+// Petakan seq 16 bit (frame biner) ke seq 32 bit terdekat dari next
+uint32_t otaSeqExpand16(uint16_t seq);
+
+// Bit i = chunk (next + 1 + i) sudah ada di reorder buffer
+uint32_t otaSeqBufferedMask();
+
+// Tulis seq yang belum diterima dalam rentang [next, seq tertinggi yang
+// terlihat]; minimal berisi next. Return jumlah yang ditulis.
+size_t otaSeqMissing(uint32_t *out, size_t max);
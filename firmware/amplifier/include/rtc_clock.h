@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Jam software berbasis DS3231. Waktu dibaca lewat I2C hanya saat boot,
+// saat verifikasi berkala (RTC_VERIFY_MS) dan saat set; di antaranya detik
+// maju pada tepi turun SQW 1 Hz (register detik DS3231 berganti di tepi ini)
+// dan sub-detik diinterpolasi dengan micros(). Bila SQW hilang, jam tetap
+// maju dari micros() dan diverifikasi ulang lebih sering.
+
+struct RtcClockStats {
+  bool     sqwOk;          // tepi SQW terakhir < RTC_SQW_TIMEOUT_MS
+  uint32_t verifies;       // pembacaan verifikasi DS3231
+  uint32_t corrections;    // verifikasi yang mengoreksi jam software
+  int32_t  lastDriftS;     // selisih (RTC − software) saat koreksi terakhir
+  bool     stuck;          // detik DS3231 tidak maju antar verifikasi
+};
+
+bool  rtcClockBegin();                    // setelah Wire.begin & i2cBusInit
+bool  rtcClockReady();
+bool  rtcClockRecover();                  // init ulang DS3231 (sensor_health), sinkron ulang
+void  rtcClockTick(uint32_t now);         // dari loop: verifikasi berkala (I2C)
+
+bool  rtcClockNow(uint32_t& epoch, uint16_t* msOut = nullptr);  // tanpa I2C
+bool  rtcClockSet(uint32_t epoch);        // tulis DS3231 + jam software
+bool  rtcClockSqwConsumeTick();           // true sekali per pulse 1 Hz
+float rtcClockReadTempC();                // suhu die DS3231 (I2C), NAN bila gagal
+void  rtcClockGetStats(RtcClockStats& out);
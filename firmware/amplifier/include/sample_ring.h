@@ -0,0 +1,46 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Sampel bertimestamp (millis) satu channel sensor
+struct SensorSample {
+  uint32_t ms;
+  float value;
+};
+
+// Ring buffer satu producer (task sensor) / banyak reader, tanpa lock.
+// Reader menyalin lalu memeriksa ulang `head` (pola seqlock): bila producer
+// sudah mulai menimpa slot yang disalin, salinan diulang.
+template <size_t N>
+class SampleRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N harus pangkat 2");
+
+ public:
+  void push(uint32_t ms, float value) {
+    const uint32_t h = head_.load(std::memory_order_relaxed);
+    buf_[h & (N - 1)] = {ms, value};
+    head_.store(h + 1, std::memory_order_release);
+  }
+
+  // Salin hingga `max` sampel terbaru (urut lama → baru); return jumlahnya
+  size_t copyRecent(SensorSample* out, size_t max) const {
+    for (;;) {
+      const uint32_t h = head_.load(std::memory_order_acquire);
+      size_t n = (h < max) ? h : max;
+      if (n > N - 1) n = N - 1;
+      for (size_t i = 0; i < n; ++i) out[i] = buf_[(h - n + i) & (N - 1)];
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // Slot tertua (h-n) baru ditimpa saat producer menulis seq h-n+N
+      if (head_.load(std::memory_order_relaxed) - h + n < N) return n;
+    }
+  }
+
+  bool latest(SensorSample& out) const { return copyRecent(&out, 1) == 1; }
+
+  // Total sampel yang pernah ditulis (untuk deteksi sampel baru)
+  uint32_t total() const { return head_.load(std::memory_order_acquire); }
+
+ private:
+  SensorSample buf_[N] = {};
+  std::atomic<uint32_t> head_{0};
+};
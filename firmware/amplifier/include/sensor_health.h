@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Health perangkat sensor di bus I2C. Dijalankan dari task akuisisi:
+//   - probe alamat tiap SENSOR_HEALTH_PROBE_MS (lock dengan prioritas perangkat)
+//   - SENSOR_HEALTH_FAIL_ERRS probe gagal beruntun → FAILED, lalu recovery
+//     bus (i2cBusRecover) + init ulang perangkat tiap SENSOR_HEALTH_RECOVER_MS
+//   - perangkat yang tidak ada saat boot diinit ulang begitu menjawab
+//   - stuck: mentah ADS identik SENSOR_STUCK_SAMPLES kali / detik RTC beku
+
+enum class SensorDev : uint8_t { Ads, Rtc, Count };
+
+enum class SensorHealth : uint8_t { Ok, Stuck, Failed };
+
+struct SensorDevHealth {
+  SensorHealth state;
+  uint32_t     errors;      // probe gagal sejak boot
+  uint32_t     recoveries;  // init ulang (dengan/tanpa recovery bus)
+  uint32_t     stuckEvents;
+  uint32_t     lastGoodMs;  // millis() probe sukses terakhir, 0 = belum pernah
+};
+
+void sensorHealthInit();
+void sensorHealthTick(uint32_t now);                 // task akuisisi
+void sensorHealthAdsSample(uint8_t adsCh, int16_t raw);
+bool sensorHealthOk(SensorDev dev);                  // data perangkat layak dipakai
+void sensorHealthGet(SensorDev dev, SensorDevHealth& out);
+const char* sensorDevStr(SensorDev dev);
+const char* sensorHealthStr(SensorHealth s);
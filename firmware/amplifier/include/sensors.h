@@ -1,15 +1,41 @@
 #pragma once
 #include <Arduino.h>
 #include "config.h"
+#include "sample_ring.h"
 
 // ---- Voltage & Temperature ----
 void  sensorsInit();
 void  sensorsTick(uint32_t now);
 
-float getVoltageInstant();   // Volt SMPS 65V (ADS1115 A0, tanpa smoothing)
-float getVoltage12V();       // Volt 12V rail (ADS1115 A1, tanpa smoothing)
-float getHeatsinkC();        // °C (DS18B20) atau NAN jika invalid
+// Tegangan = NAN selama ADS gagal/stuck (sensor_health) atau belum ada sampel;
+// 0 V hanya berarti benar-benar tidak ada daya.
+float getVoltageInstant();   // Volt SMPS 65V (ADS1115 A0, sampel terakhir, tanpa smoothing)
+float getVoltage12V();       // Volt 12V rail (ADS1115 A1, sampel terakhir, tanpa smoothing)
+float getVoltageFiltered();  // Volt SMPS terfilter (FILT_SMPS_*) — dipakai proteksi
+float getVoltage12VFiltered();
+bool  sensorsVoltageValid(); // ADS sehat & SMPS/12V sedang dipublikasikan
+float getHeatsinkC();        // °C (DS18B20) terfilter (FILT_HEAT_*) atau NAN jika invalid
+float getHeatsinkInstantC(); // °C DS18B20 valid terakhir tanpa filter, atau NAN
 float sensorsGetRtcTempC();  // °C RTC internal (DS3231) atau NAN
+bool  sensorsInitOk();       // ADS1115 & RTC menjawab saat sensorsInit()
+
+// ---- DS18B20 per sensor (indeks = urutan ROM) ----
+uint8_t sensorsTempCount();
+float   sensorsTempC(uint8_t idx);                        // °C mentah atau NAN (invalid)
+bool    sensorsTempRomHex(uint8_t idx, char* out, size_t n);  // 16 hex + NUL
+
+// ---- Riwayat sampel (ring per channel, diisi task sensor) ----
+enum class SensorCh : uint8_t {
+  Smps = 0,   // V, sudah dikonversi divider
+  V12,        // V
+  Heatsink,   // °C DS18B20 terpanas di DS18B20_HEATSINK_MASK (per siklus)
+  RtcTemp,    // °C DS3231
+  Count
+};
+bool   sensorsLatest(SensorCh ch, SensorSample& out);
+size_t sensorsHistory(SensorCh ch, SensorSample* out, size_t max);  // lama → baru
+float  sensorsFiltered(SensorCh ch);                       // keluaran rantai filter, NAN bila kosong
+bool   sensorsEnvelope(SensorCh ch, float& lo, float& hi);  // min/max blok terakhir (mentah)
 
 // ---- Analyzer (FFT 8/16/32/64 band) ----
 void  analyzerGetBytes(uint8_t* out, size_t n);  // 0..255 per band
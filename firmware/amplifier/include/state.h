@@ -44,6 +44,11 @@ void     stateSetBtAutoOffMs(uint32_t ms);
 uint32_t stateLastRtcSync();
 void     stateSetLastRtcSync(uint32_t t);
 
+// Batch tulis NVS: setter di antara begin/commit hanya mengubah RAM,
+// lalu commit menulis semua key yang berubah dengan satu nvs_commit.
+void     stateBatchBegin();
+bool     stateBatchCommit();
+
 // -------- Runtime flags (tidak dipersist) --------
 bool     powerIsOn();
 bool     powerIsStandby();
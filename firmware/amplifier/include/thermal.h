@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Model termal heatsink lumped (satu kapasitas panas), dipelajari online:
+//
+//   dT/dt [°C/menit] = θ0·on + θ1·P − θ2·ΔT/10 − θ3·fan·ΔT/10
+//
+//   on  : relay utama ON (rugi idle modul amp)
+//   P   : proksi daya keluaran = on · (VU/255)² · (V_smps / THERMAL_V_NOM)²
+//   ΔT  : T_heatsink − T_ambient (suhu die RTC, fallback THERMAL_AMBIENT_C);
+//         dibagi 10 agar skala fitur setara untuk NLMS
+//   fan : duty kipas 0..1
+//
+// θ diperbarui NLMS tiap THERMAL_STEP_S dan dipersist di NVS ("dev/th").
+// Prediksi = integrasi model THERMAL_HORIZON_S ke depan dengan input saat ini.
+
+struct ThermalInputs {
+  float    heatC;     // heatsink terfilter (NAN = invalid)
+  float    ambientC;  // NAN → THERMAL_AMBIENT_C
+  uint8_t  vu;        // 0..255
+  float    smpsV;
+  uint16_t fanDuty;   // 0..1023 duty aktual (untuk learning)
+  uint16_t fanBase;   // 0..1023 duty kurva statis (untuk prediksi, hindari umpan balik)
+  bool     on;
+};
+
+struct ThermalStatus {
+  bool     ready;       // cukup update & galat kecil → prediksi dipakai
+  float    predC;       // prediksi horizon dengan duty kurva statis
+  float    predMaxFanC; // prediksi horizon dengan kipas penuh
+  float    errCpm;      // EMA |galat| dT/dt (°C/menit)
+  float    theta[4];
+  uint32_t updates;
+};
+
+void thermalInit();                                    // muat θ dari NVS
+void thermalTick(uint32_t now, const ThermalInputs& in);
+
+// Suhu efektif untuk kurva kipas AUTO: pre-spin bila prediksi naik,
+// lebih pelan (maks. THERMAL_FF_RELIEF_C) bila prediksi turun.
+float thermalFanTempC(float heatC);
+
+// Prediksi menembus OTP walau kipas penuh (peringatan dini, bukan trip)
+bool  thermalOtpPredicted();
+
+void  thermalGetStatus(ThermalStatus& out);
+void  thermalFactoryReset();                           // θ default + hapus NVS
@@ -0,0 +1,151 @@
+#include "ads_async.h"
+#include "config.h"
+#include "i2c_bus.h"
+
+#include <Wire.h>
+#include <Adafruit_ADS1X15.h>
+#include <esp_timer.h>
+
+static Adafruit_ADS1115 ads;
+static bool ready = false;
+
+static const uint8_t kChannels[] = {ADS_CHANNEL_SMPS, ADS_CHANNEL_12V};
+static constexpr uint8_t kChannelCount = sizeof(kChannels) / sizeof(kChannels[0]);
+static const uint16_t kMux[4] = {
+  ADS1X15_REG_CONFIG_MUX_SINGLE_0, ADS1X15_REG_CONFIG_MUX_SINGLE_1,
+  ADS1X15_REG_CONFIG_MUX_SINGLE_2, ADS1X15_REG_CONFIG_MUX_SINGLE_3,
+};
+
+// Register ADS1115 (datasheet §8.6). Per konversi hanya config yang ditulis;
+// threshold RDY cukup sekali di adsAsyncBegin (startADCReading Adafruit
+// menulis ketiganya tiap kali → 3 transaksi I2C per sampel).
+static constexpr uint8_t  kRegConversion = 0x00;
+static constexpr uint8_t  kRegConfig     = 0x01;
+static constexpr uint8_t  kRegLoThresh   = 0x02;
+static constexpr uint8_t  kRegHiThresh   = 0x03;
+static constexpr uint16_t kCfgOsSingle   = 0x8000;
+static constexpr uint16_t kCfgModeSingle = 0x0100;
+// Komparator tradisional, aktif-low, non-latch, assert setelah 1 konversi
+static constexpr uint16_t kCfgCompRdy    = 0x0000;
+
+static uint8_t chIdx = 0;
+static bool converting = false;
+static uint32_t startUs = 0;
+static volatile bool rdyFlag = false;
+
+// Bangunkan task akuisisi tepat saat konversi selesai (sub-tick)
+static TaskHandle_t wakeTask = nullptr;
+static esp_timer_handle_t wakeTimer = nullptr;
+
+static void onWakeTimer(void*) {
+  if (wakeTask) xTaskNotifyGive(wakeTask);
+}
+
+#if ADS_ALERT_PIN >= 0
+static void IRAM_ATTR onAdsReady() {
+  rdyFlag = true;
+  if (wakeTask) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(wakeTask, &woken);
+    if (woken) portYIELD_FROM_ISR();
+  }
+}
+#endif
+
+static bool writeReg(uint8_t reg, uint16_t value) {
+  Wire.beginTransmission(ADS_I2C_ADDR);
+  Wire.write(reg);
+  Wire.write(static_cast<uint8_t>(value >> 8));
+  Wire.write(static_cast<uint8_t>(value & 0xFF));
+  return Wire.endTransmission() == 0;
+}
+
+static bool readConversion(int16_t& raw) {
+  Wire.beginTransmission(ADS_I2C_ADDR);
+  Wire.write(kRegConversion);
+  if (Wire.endTransmission(false) != 0) return false;
+  if (Wire.requestFrom(static_cast<uint8_t>(ADS_I2C_ADDR), static_cast<size_t>(2)) != 2) return false;
+  const uint8_t hi = static_cast<uint8_t>(Wire.read());
+  const uint8_t lo = static_cast<uint8_t>(Wire.read());
+  raw = static_cast<int16_t>((hi << 8) | lo);
+  return true;
+}
+
+// Dipanggil dengan lock bus (I2cPrio::Critical) sudah dipegang
+static void startConversion() {
+  rdyFlag = false;
+  const uint16_t cfg = kCfgOsSingle | kMux[kChannels[chIdx] & 3] |
+                       static_cast<uint16_t>(ads.getGain()) | kCfgModeSingle |
+                       static_cast<uint16_t>(ADS_DATA_RATE) | kCfgCompRdy;
+  converting = writeReg(kRegConfig, cfg);
+  startUs = micros();   // konversi mulai di STOP transaksi config
+  if (converting && wakeTimer) {
+    // Dengan ALERT/RDY timer hanya cadangan bila interrupt hilang
+    esp_timer_stop(wakeTimer);
+    esp_timer_start_once(wakeTimer, ADS_ALERT_PIN >= 0 ? 2 * ADS_CONV_US : ADS_CONV_US);
+  }
+}
+
+bool adsAsyncBegin() {
+  I2cBusLock lock(I2cPrio::Critical);
+  if (!lock.ok()) return ready = false;
+  ready = ads.begin(ADS_I2C_ADDR, &Wire);
+  converting = false;
+  chIdx = 0;
+  if (!ready) return false;
+  ads.setGain(GAIN_ONE);
+  ads.setDataRate(ADS_DATA_RATE);
+  // Hi = 0x8000, Lo = 0x0000 → pin ALERT/RDY jadi sinyal "conversion ready"
+  writeReg(kRegHiThresh, 0x8000);
+  writeReg(kRegLoThresh, 0x0000);
+#if ADS_ALERT_PIN >= 0
+  pinMode(ADS_ALERT_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(ADS_ALERT_PIN), onAdsReady, FALLING);
+#endif
+  startConversion();
+  return true;
+}
+
+bool adsAsyncReady() { return ready; }
+
+void adsAsyncSetWakeTask(TaskHandle_t task) {
+  if (!wakeTimer) {
+    esp_timer_create_args_t args = {};
+    args.callback = onWakeTimer;
+    args.name = "ads_rdy";
+    if (esp_timer_create(&args, &wakeTimer) != ESP_OK) wakeTimer = nullptr;
+  }
+  wakeTask = task;
+}
+
+bool adsAsyncPoll(uint32_t nowUs, uint8_t& channel, int16_t& raw) {
+  if (!ready) return false;
+  if (!converting) {
+    I2cBusLock lock(I2cPrio::Critical);
+    if (lock.ok()) startConversion();
+    return false;
+  }
+
+  const uint32_t elapsed = nowUs - startUs;
+#if ADS_ALERT_PIN >= 0
+  // Interrupt hilang (pin lepas/noise): jatuh ke batas waktu 2x konversi
+  if (!rdyFlag && elapsed < 2 * ADS_CONV_US) return false;
+#else
+  if (elapsed < ADS_CONV_US) return false;
+#endif
+
+  // Critical: pemohon Display (page OLED) mengalah selama kita menunggu
+  I2cBusLock lock(I2cPrio::Critical);
+  if (!lock.ok()) return false;   // coba lagi di periode berikutnya
+
+  channel = kChannels[chIdx];
+  const bool got = readConversion(raw);
+  converting = false;
+  chIdx = (chIdx + 1) % kChannelCount;
+  startConversion();  // konversi channel berikutnya langsung berjalan
+  return got;
+}
+
+float adsAsyncToVolts(int16_t raw) {
+  return ads.computeVolts(raw);
+}
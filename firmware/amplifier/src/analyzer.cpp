@@ -328,6 +328,7 @@ uint8_t analyzerGetVu() { return vuLevel; }
 const char *analyzerGetMode() { return mode; }
 uint16_t analyzerGetUpdateMs() { return updateMs; }
 bool analyzerEnabled() { return enabled; }
+bool analyzerI2sReady() { return i2sReady; }
 
 #else
 
@@ -346,5 +347,6 @@ uint8_t analyzerGetVu() { return 0; }
 const char *analyzerGetMode() { return "off"; }
 uint16_t analyzerGetUpdateMs() { return 0; }
 bool analyzerEnabled() { return false; }
+bool analyzerI2sReady() { return true; }  // I2S tidak dipakai, tidak ikut health check
 
 #endif
\ No newline at end of file
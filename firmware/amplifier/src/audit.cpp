@@ -0,0 +1,150 @@
+#include "audit.h"
+#include "config.h"
+#include "ota.h"
+#include "sha256_compat.h"
+
+#include <esp_ota_ops.h>
+#include <cstring>
+
+static const esp_partition_t* jobParts[2];
+static uint8_t jobCount = 0;
+static uint8_t jobIdx = 0;
+static AuditLen jobMode = AuditLen::Image;
+static uint32_t jobBytes = 0;
+
+static bool hashing = false;   // slot jobIdx sedang di-hash
+static uint32_t hashPos = 0;
+static uint32_t hashLen = 0;
+static mbedtls_sha256_context shaCtx;
+static uint8_t readBuf[1024];
+
+static AuditResult results[2];
+static uint8_t resultHead = 0;
+static uint8_t resultCount = 0;
+
+static bool busy() { return jobIdx < jobCount || hashing; }
+
+const esp_partition_t* auditResolveSlot(const char* name) {
+  if (!name || strcmp(name, "running") == 0) return esp_ota_get_running_partition();
+  if (strcmp(name, "other") == 0) return esp_ota_get_next_update_partition(nullptr);
+  return esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, name);
+}
+
+// Panjang image ESP: header 24 byte, N segmen (header 8 byte + data),
+// padding hingga kelipatan 16 termasuk byte checksum, +32 bila hash_appended.
+static bool imageLength(const esp_partition_t* part, uint32_t& out) {
+  uint8_t hdr[24];
+  if (esp_partition_read(part, 0, hdr, sizeof(hdr)) != ESP_OK || hdr[0] != 0xE9) return false;
+  uint32_t pos = sizeof(hdr);
+  for (uint8_t i = 0; i < hdr[1]; ++i) {
+    uint32_t seg[2];  // load_addr, data_len
+    if (pos + sizeof(seg) > part->size ||
+        esp_partition_read(part, pos, seg, sizeof(seg)) != ESP_OK) return false;
+    pos += sizeof(seg) + seg[1];
+    if (pos > part->size) return false;
+  }
+  pos = (pos + 16) & ~15u;
+  if (hdr[23] == 1) pos += 32;
+  if (pos > part->size) return false;
+  out = pos;
+  return true;
+}
+
+static void pushResult(const esp_partition_t* part, bool ok, const char* err) {
+  if (resultCount >= 2) return;  // comms mengambil tiap tick; tidak terjadi
+  AuditResult& r = results[(resultHead + resultCount) % 2];
+  r.part = part;
+  r.ok = ok;
+  r.err = err;
+  r.len = ok ? hashLen : 0;
+  if (ok) SHA256_FINISH(&shaCtx, r.sha256);
+  r.last = (jobIdx + 1 >= jobCount);
+  resultCount++;
+}
+
+static void finishSlot(bool ok, const char* err) {
+  if (hashing) {
+    pushResult(jobParts[jobIdx], ok, err);
+    mbedtls_sha256_free(&shaCtx);
+  } else {
+    pushResult(jobParts[jobIdx], false, err);
+  }
+  hashing = false;
+  jobIdx++;
+}
+
+bool auditHashStart(const esp_partition_t* const* parts, uint8_t count, AuditLen mode, uint32_t bytes) {
+  if (busy() || resultCount || count == 0 || count > 2) return false;
+  if (mode == AuditLen::Bytes && bytes == 0) return false;
+  for (uint8_t i = 0; i < count; ++i) {
+    if (!parts[i]) return false;
+    jobParts[i] = parts[i];
+  }
+  jobCount = count;
+  jobIdx = 0;
+  jobMode = mode;
+  jobBytes = bytes;
+  hashing = false;
+  return true;
+}
+
+bool auditBusy() { return busy(); }
+
+void auditTick(uint32_t now) {
+  (void)now;
+  if (!busy() || resultCount >= 2) return;
+  // Slot OTA sedang ditulis: hash-nya tidak bermakna & bersaing akses flash
+  if (otaStatus() == OtaStatus::InProgress) {
+    finishSlot(false, "ota_active");
+    return;
+  }
+
+  const esp_partition_t* part = jobParts[jobIdx];
+  if (!hashing) {
+    uint32_t len = part->size;
+    if (jobMode == AuditLen::Image && !imageLength(part, len)) {
+      finishSlot(false, "no_image");
+      return;
+    }
+    if (jobMode == AuditLen::Bytes) {
+      if (jobBytes > part->size) {
+        finishSlot(false, "range");
+        return;
+      }
+      len = jobBytes;
+    }
+    hashLen = len;
+    hashPos = 0;
+    mbedtls_sha256_init(&shaCtx);
+    SHA256_STARTS(&shaCtx, 0);
+    hashing = true;
+  }
+
+  uint32_t budget = AUDIT_HASH_CHUNK;
+  while (budget && hashPos < hashLen) {
+    uint32_t n = hashLen - hashPos;
+    if (n > sizeof(readBuf)) n = sizeof(readBuf);
+    if (n > budget) n = budget;
+    if (esp_partition_read(part, hashPos, readBuf, n) != ESP_OK) {
+      finishSlot(false, "read");
+      return;
+    }
+    SHA256_UPDATE(&shaCtx, readBuf, n);
+    hashPos += n;
+    budget -= n;
+  }
+  if (hashPos >= hashLen) finishSlot(true, nullptr);
+}
+
+bool auditTakeResult(AuditResult& out) {
+  if (!resultCount) return false;
+  out = results[resultHead];
+  resultHead = (resultHead + 1) % 2;
+  resultCount--;
+  return true;
+}
+
+bool auditRead(const esp_partition_t* part, uint32_t offset, uint8_t* out, size_t len) {
+  if (!part || !out || offset > part->size || len > part->size - offset) return false;
+  return esp_partition_read(part, offset, out, len) == ESP_OK;
+}
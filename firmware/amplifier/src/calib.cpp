@@ -0,0 +1,282 @@
+#include "calib.h"
+#include "sensors.h"
+
+#include <atomic>
+#include <math.h>
+#include <nvs.h>
+#include <jacktor_crc.h>
+
+static constexpr const char *kNvsNs = "dev/cal";
+static constexpr uint16_t kNvsVersion = 1;
+static constexpr size_t kChCount = static_cast<size_t>(CalCh::Count);
+
+// ADS1115 GAIN_ONE (ads_async.cpp): ±4.096 V penuh → 125 µV per LSB
+static constexpr float kAdsLsbV = 4.096f / 32768.0f;
+
+// Q16: mV per LSB & offset mV; hasil dibagi 65536·1000 → volt
+static constexpr float kQ16 = 65536.0f;
+static constexpr float kQ16ToV = 1.0f / (65536.0f * 1000.0f);
+
+struct CalNvs {
+  uint16_t version;
+  uint8_t  points;
+  uint8_t  reserved;
+  float    gain;
+  float    offsetV;
+  uint32_t epoch;
+  uint32_t crc;       // CRC32 atas field sebelumnya
+};
+
+struct CalPoint {
+  float adcV;
+  float refV;
+};
+
+struct CalChannel {
+  const char *name;
+  float defGain;
+  float defOffsetV;
+
+  // Koefisien aktif (dibaca task akuisisi)
+  std::atomic<int32_t> mvPerLsbQ16;
+  std::atomic<int32_t> offsetMvQ16;
+
+  float gain;
+  float offsetV;
+  CalSource source;
+  uint32_t epoch;
+  uint8_t points;
+
+  CalPoint session[2];
+  uint8_t pending;
+};
+
+static CalChannel chans[kChCount] = {
+  {"smps", (R1_OHMS + R2_OHMS) / R2_OHMS, 0.0f},
+  {"v12",  (R1_12V_OHMS + R2_12V_OHMS) / R2_12V_OHMS, V12_OFFSET_V},
+};
+
+// Capture: satu channel sekaligus. Loop menyiapkan akumulator lalu set
+// Capturing; task akuisisi hanya menulis akumulator selama Capturing dan
+// men-set Done setelah CAL_AVG_SAMPLES.
+enum class CapState : uint8_t { Idle, Capturing, Done };
+static std::atomic<uint8_t> capState{static_cast<uint8_t>(CapState::Idle)};
+static CalCh capCh = CalCh::Smps;
+static float capRefV = 0.0f;
+static uint32_t capStartMs = 0;
+static int64_t capSum = 0;
+static uint32_t capN = 0;
+static int16_t capMin = 0, capMax = 0;
+
+static CalChannel &chan(CalCh ch) { return chans[static_cast<size_t>(ch)]; }
+
+static void applyCoeffs(CalChannel &c, float gain, float offsetV) {
+  c.gain = gain;
+  c.offsetV = offsetV;
+  c.mvPerLsbQ16.store(static_cast<int32_t>(lroundf(gain * kAdsLsbV * 1000.0f * kQ16)));
+  c.offsetMvQ16.store(static_cast<int32_t>(lroundf(offsetV * 1000.0f * kQ16)));
+}
+
+static void setDefault(CalChannel &c) {
+  applyCoeffs(c, c.defGain, c.defOffsetV);
+  c.source = CalSource::Default;
+  c.epoch = 0;
+  c.points = 0;
+}
+
+static uint32_t blobCrc(const CalNvs &b) {
+  return jacktorCrc32(0, &b, offsetof(CalNvs, crc));
+}
+
+static bool plausible(const CalChannel &c, float gain, float offsetV) {
+  return isfinite(gain) && isfinite(offsetV) &&
+         fabsf(gain / c.defGain - 1.0f) <= CAL_GAIN_TOL &&
+         fabsf(offsetV) <= CAL_OFFSET_MAX_V;
+}
+
+void calibInit() {
+  for (auto &c : chans) {
+    setDefault(c);
+    c.pending = 0;
+  }
+  capState.store(static_cast<uint8_t>(CapState::Idle));
+
+  nvs_handle handle;
+  if (nvs_open(kNvsNs, NVS_READONLY, &handle) != ESP_OK) return;
+  for (auto &c : chans) {
+    CalNvs b;
+    size_t len = sizeof(b);
+    const bool got = nvs_get_blob(handle, c.name, &b, &len) == ESP_OK && len == sizeof(b);
+    // Blob rusak/di luar toleransi → tetap default (lebih aman dari nilai liar)
+    if (!got || b.version != kNvsVersion || b.crc != blobCrc(b)) continue;
+    if (!plausible(c, b.gain, b.offsetV)) continue;
+    applyCoeffs(c, b.gain, b.offsetV);
+    c.source = CalSource::Nvs;
+    c.epoch = b.epoch;
+    c.points = b.points;
+  }
+  nvs_close(handle);
+}
+
+float calibApply(CalCh ch, int16_t raw) {
+  if (ch >= CalCh::Count) return NAN;
+  const CalChannel &c = chan(ch);
+  const int64_t acc = static_cast<int64_t>(raw) * c.mvPerLsbQ16.load(std::memory_order_relaxed) +
+                      c.offsetMvQ16.load(std::memory_order_relaxed);
+  return static_cast<float>(acc) * kQ16ToV;
+}
+
+void calibFeed(CalCh ch, int16_t raw) {
+  if (capState.load(std::memory_order_acquire) != static_cast<uint8_t>(CapState::Capturing)) return;
+  if (ch != capCh) return;
+  if (capN == 0) {
+    capMin = capMax = raw;
+  } else {
+    if (raw < capMin) capMin = raw;
+    if (raw > capMax) capMax = raw;
+  }
+  capSum += raw;
+  if (++capN >= CAL_AVG_SAMPLES) {
+    capState.store(static_cast<uint8_t>(CapState::Done), std::memory_order_release);
+  }
+}
+
+bool calibStart(CalCh ch, float refV, const char *&err) {
+  if (ch >= CalCh::Count) { err = "ch_invalid"; return false; }
+  if (!isfinite(refV) || refV <= 0.0f) { err = "ref_invalid"; return false; }
+  if (capState.load() != static_cast<uint8_t>(CapState::Idle)) { err = "busy"; return false; }
+  if (chan(ch).pending >= 2) { err = "points_full"; return false; }
+
+  capCh = ch;
+  capRefV = refV;
+  capStartMs = millis();
+  capSum = 0;
+  capN = 0;
+  capState.store(static_cast<uint8_t>(CapState::Capturing), std::memory_order_release);
+  return true;
+}
+
+bool calibTakeResult(uint32_t now, CalResult &out) {
+  const uint8_t st = capState.load(std::memory_order_acquire);
+  if (st == static_cast<uint8_t>(CapState::Idle)) return false;
+
+  out.ch = capCh;
+  out.refV = capRefV;
+  out.idx = chan(capCh).pending;
+  out.adcV = NAN;
+  out.spread = 0;
+
+  if (st == static_cast<uint8_t>(CapState::Capturing)) {
+    if (now - capStartMs < CAL_TIMEOUT_MS) return false;
+    capState.store(static_cast<uint8_t>(CapState::Idle));
+    out.ok = false;
+    out.err = "timeout";
+    return true;
+  }
+
+  capState.store(static_cast<uint8_t>(CapState::Idle));
+  out.adcV = static_cast<float>(capSum) / static_cast<float>(capN) * kAdsLsbV;
+  out.spread = static_cast<uint16_t>(capMax - capMin);
+  out.ok = false;
+  if (out.spread > CAL_MAX_SPREAD_LSB) {
+    out.err = "unstable";
+  } else if (out.adcV < CAL_MIN_ADC_V) {
+    out.err = "adc_low";
+  } else {
+    CalChannel &c = chan(capCh);
+    c.session[c.pending++] = {out.adcV, out.refV};
+    out.ok = true;
+    out.err = nullptr;
+  }
+  return true;
+}
+
+bool calibCommit(CalCh ch, const char *&err) {
+  if (ch >= CalCh::Count) { err = "ch_invalid"; return false; }
+  CalChannel &c = chan(ch);
+  if (c.pending == 0) { err = "no_points"; return false; }
+
+  float gain, offsetV;
+  if (c.pending == 1) {
+    // Satu titik: offset default dipertahankan, hanya gain dikoreksi
+    offsetV = c.defOffsetV;
+    gain = (c.session[0].refV - offsetV) / c.session[0].adcV;
+  } else {
+    const float dAdc = c.session[1].adcV - c.session[0].adcV;
+    if (fabsf(dAdc) < CAL_MIN_SPAN_ADC_V) { err = "span_small"; return false; }
+    gain = (c.session[1].refV - c.session[0].refV) / dAdc;
+    offsetV = c.session[0].refV - gain * c.session[0].adcV;
+  }
+  if (!plausible(c, gain, offsetV)) { err = "out_of_range"; return false; }
+
+  CalNvs b = {};
+  b.version = kNvsVersion;
+  b.points = c.pending;
+  b.gain = gain;
+  b.offsetV = offsetV;
+  uint32_t epoch = 0;
+  b.epoch = sensorsGetUnixTime(epoch) ? epoch : 0;
+  b.crc = blobCrc(b);
+
+  nvs_handle handle;
+  if (nvs_open(kNvsNs, NVS_READWRITE, &handle) != ESP_OK) { err = "nvs"; return false; }
+  const bool saved = nvs_set_blob(handle, c.name, &b, sizeof(b)) == ESP_OK &&
+                     nvs_commit(handle) == ESP_OK;
+  nvs_close(handle);
+  if (!saved) { err = "nvs"; return false; }
+
+  applyCoeffs(c, gain, offsetV);
+  c.source = CalSource::Nvs;
+  c.epoch = b.epoch;
+  c.points = b.points;
+  c.pending = 0;
+  return true;
+}
+
+void calibAbort(CalCh ch) {
+  if (ch >= CalCh::Count) return;
+  if (capCh == ch) capState.store(static_cast<uint8_t>(CapState::Idle));
+  chan(ch).pending = 0;
+}
+
+void calibReset(CalCh ch) {
+  if (ch >= CalCh::Count) return;
+  calibAbort(ch);
+  CalChannel &c = chan(ch);
+  setDefault(c);
+  nvs_handle handle;
+  if (nvs_open(kNvsNs, NVS_READWRITE, &handle) == ESP_OK) {
+    nvs_erase_key(handle, c.name);
+    nvs_commit(handle);
+    nvs_close(handle);
+  }
+}
+
+void calibGet(CalCh ch, CalInfo &out) {
+  const CalChannel &c = chan(ch);
+  out.gain = c.gain;
+  out.offsetV = c.offsetV;
+  out.source = c.source;
+  out.epoch = c.epoch;
+  out.points = c.points;
+  out.pending = c.pending;
+}
+
+const char *calibChStr(CalCh ch) {
+  return ch < CalCh::Count ? chan(ch).name : "?";
+}
+
+bool calibChParse(const char *s, CalCh &out) {
+  if (!s) return false;
+  for (size_t i = 0; i < kChCount; ++i) {
+    if (strcmp(s, chans[i].name) == 0) {
+      out = static_cast<CalCh>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *calibSourceStr(CalSource s) {
+  return s == CalSource::Nvs ? "nvs" : "default";
+}
@@ -0,0 +1,279 @@
+#include "capture.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <jacktor_crc.h>
+
+static constexpr uint32_t kMagic = 0x5041434A;   // "JCAP"
+static constexpr uint8_t  kVersion = 1;
+
+struct __attribute__((packed)) CaptureRecord {
+  uint16_t tc;
+  int16_t  val;
+};
+static_assert(sizeof(CaptureRecord) == 4, "CaptureRecord harus 4 byte");
+static_assert(CAPTURE_RECORDS <= 0xFFFF, "CAPTURE_RECORDS harus muat u16");
+
+// .noinit: tidak di-nol-kan startup, isi bertahan selama chip tidak kehilangan daya
+static __NOINIT_ATTR CaptureHeader hdr;
+static __NOINIT_ATTR CaptureRecord recs[CAPTURE_RECORDS];
+
+static std::atomic<uint8_t> state{static_cast<uint8_t>(CaptureState::Armed)};
+static std::atomic<uint8_t> pendingReason{0};
+static std::atomic<bool> rearmReq{false};
+static uint16_t postLeft = 0;
+static bool prevBoot = false;
+
+// State ring apa adanya (konteks akuisisi); pembaca luar memakai captureState()
+static inline CaptureState rawState() {
+  return static_cast<CaptureState>(state.load());
+}
+
+static inline uint16_t oldestIdx() {
+  return static_cast<uint16_t>((hdr.head + CAPTURE_RECORDS - hdr.count) % CAPTURE_RECORDS);
+}
+
+static uint32_t imageBytes() {
+  return sizeof(CaptureHeader) + static_cast<uint32_t>(hdr.count) * sizeof(CaptureRecord);
+}
+
+// Salin image linear (header + record lama → baru) mulai offset
+static void copyImage(uint32_t offset, uint8_t *dst, uint32_t len, const CaptureHeader &h) {
+  while (len > 0) {
+    uint32_t n;
+    if (offset < sizeof(CaptureHeader)) {
+      n = std::min<uint32_t>(len, sizeof(CaptureHeader) - offset);
+      memcpy(dst, reinterpret_cast<const uint8_t*>(&h) + offset, n);
+    } else {
+      const uint32_t rel = offset - sizeof(CaptureHeader);
+      const uint32_t rec = rel / sizeof(CaptureRecord);
+      const uint32_t inRec = rel % sizeof(CaptureRecord);
+      const uint32_t slot = (oldestIdx() + rec) % CAPTURE_RECORDS;
+      // Potong di batas ring agar memcpy tetap kontigu
+      n = std::min<uint32_t>(len, (CAPTURE_RECORDS - slot) * sizeof(CaptureRecord) - inRec);
+      memcpy(dst, reinterpret_cast<const uint8_t*>(&recs[slot]) + inRec, n);
+    }
+    dst += n;
+    offset += n;
+    len -= n;
+  }
+}
+
+static uint32_t computeCrc() {
+  CaptureHeader h = hdr;
+  h.crc32 = 0;
+  uint32_t crc = jacktorCrc32(0, &h, sizeof(h));
+  uint8_t buf[256];
+  const uint32_t total = imageBytes();
+  for (uint32_t off = sizeof(CaptureHeader); off < total; off += sizeof(buf)) {
+    const uint32_t n = std::min<uint32_t>(sizeof(buf), total - off);
+    copyImage(off, buf, n, h);
+    crc = jacktorCrc32(crc, buf, n);
+  }
+  return crc;
+}
+
+static void freeze() {
+  hdr.state = static_cast<uint8_t>(CaptureState::Frozen);
+  hdr.crc32 = computeCrc();
+  state.store(static_cast<uint8_t>(CaptureState::Frozen));
+}
+
+static void arm() {
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = kMagic;
+  hdr.version = kVersion;
+  hdr.state = static_cast<uint8_t>(CaptureState::Armed);
+  hdr.recSize = sizeof(CaptureRecord);
+  postLeft = 0;
+  prevBoot = false;
+  pendingReason.store(0);
+  state.store(static_cast<uint8_t>(CaptureState::Armed));
+}
+
+static bool headerSane() {
+  return hdr.magic == kMagic && hdr.version == kVersion &&
+         hdr.recSize == sizeof(CaptureRecord) &&
+         hdr.head < CAPTURE_RECORDS && hdr.count <= CAPTURE_RECORDS &&
+         hdr.state <= static_cast<uint8_t>(CaptureState::Frozen);
+}
+
+// Reset tak terduga yang tidak menghapus DRAM & layak dicatat sebagai kejadian.
+// ESP_RST_SW sengaja tidak termasuk: restart disengaja (reboot setelah
+// ota_end, perintah reset, factory reset) tidak boleh membekukan ring.
+static bool resetKeepsRam(esp_reset_reason_t r) {
+  switch (r) {
+    case ESP_RST_PANIC: case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT: case ESP_RST_WDT: case ESP_RST_BROWNOUT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void captureInit() {
+#if CAPTURE_ENABLE
+  const esp_reset_reason_t rst = esp_reset_reason();
+  if (headerSane() && rst != ESP_RST_POWERON) {
+    if (hdr.state == static_cast<uint8_t>(CaptureState::Frozen) && hdr.crc32 == computeCrc()) {
+      prevBoot = true;
+      state.store(static_cast<uint8_t>(CaptureState::Frozen));
+      return;
+    }
+    if (hdr.state != static_cast<uint8_t>(CaptureState::Frozen) && hdr.count > 0 && resetKeepsRam(rst)) {
+      // Ring masih berjalan saat chip reset (mis. brownout sebelum proteksi sempat trip)
+      if (hdr.state == static_cast<uint8_t>(CaptureState::Armed)) {
+        hdr.reason = static_cast<uint8_t>(CaptureReason::Reset);
+        hdr.trigMs = hdr.lastMs;
+        hdr.trigIdx = hdr.count - 1;
+      }
+      hdr.resetReason = static_cast<uint8_t>(rst);
+      freeze();
+      prevBoot = true;
+      return;
+    }
+  }
+  arm();
+#else
+  memset(&hdr, 0, sizeof(hdr));
+#endif
+}
+
+static int16_t encode(SensorCh ch, float value) {
+  float scaled;
+  switch (ch) {
+    case SensorCh::Smps:     scaled = value * 100.0f;  break;
+    case SensorCh::V12:      scaled = value * 1000.0f; break;
+    case SensorCh::Heatsink: scaled = value * 100.0f;  break;
+    default: return 0;
+  }
+  if (isnan(scaled)) return INT16_MIN;
+  if (scaled > 32767.0f) return INT16_MAX;
+  if (scaled < -32767.0f) return -32767;
+  return static_cast<int16_t>(lroundf(scaled));
+}
+
+static void beginTrigger(uint32_t ms) {
+  const uint8_t reason = pendingReason.load();
+  if (!reason) return;
+  hdr.reason = reason;
+  hdr.trigMs = ms;
+  hdr.trigIdx = hdr.count ? hdr.count - 1 : 0;
+  hdr.state = static_cast<uint8_t>(CaptureState::Triggered);
+  postLeft = CAPTURE_POST_RECORDS;
+  state.store(static_cast<uint8_t>(CaptureState::Triggered));
+}
+
+void capturePush(SensorCh ch, uint32_t ms, float value) {
+#if CAPTURE_ENABLE
+  if (ch != SensorCh::Smps && ch != SensorCh::V12 && ch != SensorCh::Heatsink) return;
+  const CaptureState st = rawState();
+  if (st == CaptureState::Frozen) return;
+  if (st == CaptureState::Armed) beginTrigger(ms);
+
+  CaptureRecord &r = recs[hdr.head];
+  r.tc = static_cast<uint16_t>((static_cast<uint16_t>(ch) << 14) | (ms & 0x3FFF));
+  r.val = encode(ch, value);
+  hdr.head = (hdr.head + 1) % CAPTURE_RECORDS;
+  if (hdr.count < CAPTURE_RECORDS) {
+    ++hdr.count;
+  } else if (hdr.state == static_cast<uint8_t>(CaptureState::Triggered) && hdr.trigIdx > 0) {
+    --hdr.trigIdx;   // record tertua tertimpa → posisi trigger bergeser
+  }
+  hdr.lastMs = ms;
+
+  if (hdr.state == static_cast<uint8_t>(CaptureState::Triggered) && postLeft > 0 && --postLeft == 0) {
+    freeze();
+  }
+#else
+  (void)ch; (void)ms; (void)value;
+#endif
+}
+
+void captureTick(uint32_t now) {
+#if CAPTURE_ENABLE
+  if (rearmReq.load()) {
+    arm();
+    rearmReq.store(false);   // sesudah arm(): pembaca tidak pernah melihat Frozen lama
+  }
+  const CaptureState st = rawState();
+  if (st == CaptureState::Armed) {
+    beginTrigger(now);
+  } else if (st == CaptureState::Triggered && now - hdr.trigMs >= CAPTURE_POST_MAX_MS) {
+    freeze();   // ADS diam/mati: jangan tunggu record pasca-trigger selamanya
+  }
+#else
+  (void)now;
+#endif
+}
+
+void captureTrigger(CaptureReason reason) {
+  uint8_t expected = 0;
+  pendingReason.compare_exchange_strong(expected, static_cast<uint8_t>(reason));
+}
+
+void captureRearm() {
+  // Ring & header hanya ditulis konteks akuisisi; arm() dijalankan di sana
+  rearmReq.store(true);
+}
+
+// Re-arm yang belum dijalankan task dianggap sudah Armed: dump lama tidak
+// boleh dibaca lagi karena ring bisa dikosongkan kapan saja
+CaptureState captureState() {
+  if (rearmReq.load()) return CaptureState::Armed;
+  return rawState();
+}
+
+bool captureInfo(CaptureInfo &out) {
+  const CaptureState st = captureState();
+  out.state = st;
+  out.prevBoot = prevBoot;
+  if (st != CaptureState::Frozen) {
+    out.reason = static_cast<CaptureReason>(pendingReason.load());
+    out.resetReason = 0;
+    out.trigMs = 0;
+    out.records = 0;
+    out.bytes = 0;
+    out.crc32 = 0;
+    return false;
+  }
+  out.reason = static_cast<CaptureReason>(hdr.reason);
+  out.resetReason = hdr.resetReason;
+  out.trigMs = hdr.trigMs;
+  out.records = hdr.count;
+  out.bytes = imageBytes();
+  out.crc32 = hdr.crc32;
+  return true;
+}
+
+bool captureRead(uint32_t offset, uint8_t *dst, uint32_t len) {
+  if (captureState() != CaptureState::Frozen || !dst) return false;
+  const uint32_t total = imageBytes();
+  if (offset >= total || len > total - offset) return false;
+  copyImage(offset, dst, len, hdr);
+  return true;
+}
+
+const char* captureReasonStr(CaptureReason reason) {
+  switch (reason) {
+    case CaptureReason::None:        return "none";
+    case CaptureReason::SmpsLow:     return "smps_low";
+    case CaptureReason::SmpsHwFault: return "smps_hw_fault";
+    case CaptureReason::Otp:         return "otp";
+    case CaptureReason::Reset:       return "reset";
+    case CaptureReason::Manual:      return "manual";
+    default:                         return "?";
+  }
+}
+
+const char* captureStateStr(CaptureState st) {
+  switch (st) {
+    case CaptureState::Armed:     return "armed";
+    case CaptureState::Triggered: return "triggered";
+    case CaptureState::Frozen:    return "frozen";
+    default:                      return "?";
+  }
+}
@@ -6,27 +6,177 @@
 #include "analyzer.h"
 #include "buzzer.h"
 #include "ota.h"
+#include "ota_stream.h"
+#include "ota_sig.h"
+#include "audit.h"
+#include "i2c_bus.h"
+#include "rtc_clock.h"
+#include "calib.h"
+#include "sensor_health.h"
+#include "capture.h"
+#include "thermal.h"
 #include "main.h"
 
 #include <ArduinoJson.h>
+#include <jacktor_crc.h>
 #include <mbedtls/base64.h>
+#include <esp_ota_ops.h>
 #include <algorithm>
 #include <cctype>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
-#include <vector>
 
 extern HardwareSerial espSerial;
 static HardwareSerial &linkSerial = espSerial;  // UART2 (RX16/TX17) - Panel telemetry
 static HardwareSerial &debugSerial = Serial;     // USB CDC - Debug logs only
 
-static String rxLine;
+// Buffer baris per port: byte dibaca bulk, baris dicari dengan memchr lalu
+// di-parse langsung dari buffer. Sisa baris parsial digeser ke depan.
+struct RxPort {
+  Stream *io;
+  char buf[COMMS_RX_LINE_MAX];
+  size_t len;
+  bool discarding;  // baris melebihi buffer: buang sampai newline berikutnya
+};
+
+// Perintah in-flight yang dijamin muat di buffer driver + buffer baris tanpa
+// hilang, dan habis diproses dalam satu commsTick()
+static constexpr size_t kCmdWindowBuf = (COMMS_UART_RX_BUF + COMMS_RX_LINE_MAX) / COMMS_CMD_LINE_BUDGET;
+static constexpr size_t kCmdWindow =
+    kCmdWindowBuf < COMMS_RX_MAX_LINES_TICK ? kCmdWindowBuf : COMMS_RX_MAX_LINES_TICK;
+static_assert(kCmdWindow >= 1, "buffer RX tidak muat satu perintah");
+
+static RxPort rxLink = {&linkSerial, {}, 0, false};
+static RxPort rxUsb = {&debugSerial, {}, 0, false};
+static RxPort *curRxPort = nullptr;  // port asal baris yang sedang diproses
+
+// Sesi OTA biner: port yang sedang membawa frame (nullptr = semua port JSON).
+// Urutan chunk & reorder ditangani otaSeq*; di sini hanya ack kumulatif tiap
+// OTA_BIN_ACK_EVERY frame dan NAK selektif untuk celah yang baru terlihat.
+struct OtaBinSession {
+  RxPort *port;
+  uint16_t sinceAck;
+  uint32_t nakFloor;  // seq < nakFloor sudah pernah dilaporkan hilang
+  bool crcNakSent;    // NAK karena CRC rusak: sekali sampai ada frame valid
+  uint32_t lastMs;
+};
+
+static OtaBinSession otaBin = {nullptr, 0, 0, false, 0};
+static bool otaSeqAnchored = false;  // jalur JSON: seq ota_write pertama jadi basis
+
+static_assert(OTA_BIN_FRAME_MAX + OTA_FRAME_OVERHEAD <= COMMS_RX_LINE_MAX,
+              "frame OTA biner harus muat di buffer RX");
+static_assert(OTA_WINDOW * (OTA_BIN_FRAME_MAX + OTA_FRAME_OVERHEAD) <= COMMS_RX_LINE_MAX + COMMS_UART_RX_BUF,
+              "window OTA biner melebihi kapasitas buffer RX + UART");
+
+// Allocator bump-pointer di atas buffer statis untuk JsonDocument perintah.
+// Di-reset setiap baris, jadi parsing tidak pernah menyentuh heap.
+class RxJsonArena : public ArduinoJson::Allocator {
+ public:
+  void reset() { used_ = 0; last_ = kNone; }
+
+  void *allocate(size_t size) override {
+    const size_t total = align(sizeof(Header) + size);
+    if (total > sizeof(buf_) - used_) return nullptr;
+    Header *hdr = reinterpret_cast<Header *>(buf_ + used_);
+    hdr->size = (uint32_t)size;
+    last_ = used_;
+    used_ += total;
+    return hdr + 1;
+  }
+
+  void deallocate(void *) override {}
+
+  void *reallocate(void *ptr, size_t newSize) override {
+    if (!ptr) return allocate(newSize);
+    Header *hdr = reinterpret_cast<Header *>(ptr) - 1;
+    const size_t off = reinterpret_cast<uint8_t *>(hdr) - buf_;
+    if (off == last_) {
+      // Blok terakhir: tumbuh/menyusut di tempat
+      const size_t total = align(sizeof(Header) + newSize);
+      if (total > sizeof(buf_) - off) return nullptr;
+      hdr->size = (uint32_t)newSize;
+      used_ = off + total;
+      return ptr;
+    }
+    if (newSize <= hdr->size) {
+      hdr->size = (uint32_t)newSize;
+      return ptr;
+    }
+    void *moved = allocate(newSize);
+    if (moved) memcpy(moved, ptr, hdr->size);
+    return moved;
+  }
+
+ private:
+  struct Header {
+    uint32_t size;
+    uint32_t reserved;  // jaga alignment 8 byte
+  };
+  static constexpr size_t kNone = SIZE_MAX;
+  static size_t align(size_t n) { return (n + 7u) & ~(size_t)7u; }
+
+  alignas(8) uint8_t buf_[COMMS_JSON_ARENA_BYTES];
+  size_t used_ = 0;
+  size_t last_ = kNone;
+};
+
+static RxJsonArena rxArena;
+static uint8_t otaDecodeBuf[(COMMS_RX_LINE_MAX * 3) / 4 + 4];
+
 static uint32_t lastRxBlink = 0, lastTxBlink = 0;
-static uint32_t lastRtMs = 0, lastHz1Ms = 0;
+static uint32_t linkFrameMs = 0;  // frame JSON valid terakhir dari rxLink
 static bool otaReady = true, forceTel = false;
 
+// ---- Telemetry subscription (per sesi, tidak dipersist) ----
+// Stream spectrum/vu/link dikirim di frame "rt" (hanya saat ON),
+// stream power/sensors/nvs di frame "hz1".
+enum class TelStream : uint8_t {
+  Spectrum = 0,
+  Vu,
+  Link,
+  Power,
+  Sensors,
+  Nvs,
+  Count
+};
+
+static constexpr size_t kTelStreamCount = static_cast<size_t>(TelStream::Count);
+
+static const char *const kTelStreamNames[kTelStreamCount] = {
+  "spectrum", "vu", "link", "power", "sensors", "nvs"
+};
+
+struct TelSub {
+  uint32_t intervalMs;  // 0 = stream mati
+  uint32_t lastMs;
+};
+
+// Satu sesi per port: subscribe dari USB debug tidak mengubah stream panel
+enum class TelPort : uint8_t { Link = 0, Usb, Count };
+static constexpr size_t kTelPortCount = static_cast<size_t>(TelPort::Count);
+
+struct TelSession {
+  TelSub subs[kTelStreamCount];
+  bool bandsHex;  // format bands: false=array angka, true=string hex
+};
+
+static TelSession telSess[kTelPortCount];
+static const TelSession *telCtx = &telSess[0];  // sesi frame yang sedang dibangun
+
+static constexpr uint8_t kPortLink = 1u << static_cast<uint8_t>(TelPort::Link);
+static constexpr uint8_t kPortUsb = 1u << static_cast<uint8_t>(TelPort::Usb);
+static constexpr uint8_t kPortAll = kPortLink | kPortUsb;
+
+static constexpr uint8_t telBit(TelStream s) { return (uint8_t)(1u << static_cast<uint8_t>(s)); }
+
+static constexpr uint8_t kTelRtMask =
+    telBit(TelStream::Spectrum) | telBit(TelStream::Vu) | telBit(TelStream::Link);
+static constexpr uint8_t kTelHz1Mask =
+    telBit(TelStream::Power) | telBit(TelStream::Sensors) | telBit(TelStream::Nvs);
+
 static inline uint32_t ms() { return millis(); }
 
 static inline void ledRxPulse() { digitalWrite(LED_UART_PIN, HIGH); lastRxBlink = ms(); }
@@ -35,16 +185,23 @@ static inline void ledActivityTick(uint32_t now) {
   if (now - lastRxBlink > 60 && now - lastTxBlink > 60) digitalWrite(LED_UART_PIN, LOW);
 }
 
-// Send telemetry to UART2 AND USB Serial
+// Kirim ke port terpilih (kPortLink/kPortUsb)
 template <typename TDoc>
-static void sendTelemetry(const TDoc &doc) {
+static void sendTelemetryTo(uint8_t ports, const TDoc &doc) {
+  if (!ports) return;
   String out;
   serializeJson(doc, out);
-  linkSerial.println(out);   // UART2 (Panel)
-  debugSerial.println(out);  // USB Serial
+  if (ports & kPortLink) linkSerial.println(out);   // UART2 (Panel)
+  if (ports & kPortUsb) debugSerial.println(out);   // USB Serial
   ledTxPulse();
 }
 
+// Send telemetry to UART2 AND USB Serial
+template <typename TDoc>
+static void sendTelemetry(const TDoc &doc) {
+  sendTelemetryTo(kPortAll, doc);
+}
+
 // Send debug log to USB Serial ONLY
 static void sendDebugLog(const char *msg) {
   if (!msg) return;
@@ -88,11 +245,111 @@ static bool variantIsNumber(const JsonVariant &v) {
          v.is<float>() || v.is<double>();
 }
 
-#define HANDLE_IF_PRESENT(key, handler) \
-  do { \
-    JsonVariant value = cmd[key]; \
-    if (!value.isNull()) handler(value); \
-  } while (0)
+// intervalMs <= 0 berarti stream mati (subscribe "x":0); bawaan config
+// TELEM_*_HZ = 0 tetap berarti "tiap tick" → lihat telDefaultInterval()
+static uint32_t telClampInterval(double intervalMs) {
+  if (intervalMs <= 0.0) return 0;
+  const double minMs = 1000.0 / TELEM_SUB_MAX_HZ;
+  if (intervalMs < minMs) intervalMs = minMs;
+  if (intervalMs > TELEM_SUB_MAX_INTERVAL_MS) intervalMs = TELEM_SUB_MAX_INTERVAL_MS;
+  return (uint32_t)std::lround(intervalMs);
+}
+
+// Makna lama dipertahankan: hz 0 = kirim tiap tick (dijepit TELEM_SUB_MAX_HZ)
+static uint32_t telDefaultInterval(uint32_t hz) {
+  return telClampInterval(hz > 0 ? 1000.0 / hz : 1000.0 / TELEM_SUB_MAX_HZ);
+}
+
+static void telSubResetDefaults(TelSession &sess) {
+  const uint32_t now = ms();
+  const uint32_t rtMs = TELEM_REALTIME_ENABLE ? telDefaultInterval(TELEM_HZ_REALTIME) : 0;
+  const uint32_t slowMs = telDefaultInterval(TELEM_SLOW_HZ);
+  for (size_t i = 0; i < kTelStreamCount; ++i) {
+    const bool rt = (kTelRtMask & (1u << i)) != 0;
+    sess.subs[i].intervalMs = rt ? rtMs : slowMs;
+    sess.subs[i].lastMs = now;
+  }
+  sess.bandsHex = false;
+}
+
+static inline bool telEnabled(TelStream s) {
+  return telCtx->subs[static_cast<size_t>(s)].intervalMs != 0;
+}
+
+static uint8_t telDueMask(const TelSession &sess, uint32_t now, bool sqwTick) {
+  uint8_t due = 0;
+  for (size_t i = 0; i < kTelStreamCount; ++i) {
+    const TelSub &sub = sess.subs[i];
+    if (sub.intervalMs == 0) continue;
+    // Stream 1 Hz ikut di-align ke pulse SQW RTC (perilaku lama hz1)
+    if (now - sub.lastMs >= sub.intervalMs || (sqwTick && sub.intervalMs == 1000)) {
+      due |= (uint8_t)(1u << i);
+    }
+  }
+  return due;
+}
+
+static uint8_t telEnabledMask(const TelSession &sess) {
+  uint8_t mask = 0;
+  for (size_t i = 0; i < kTelStreamCount; ++i) {
+    if (sess.subs[i].intervalMs != 0) mask |= (uint8_t)(1u << i);
+  }
+  return mask;
+}
+
+static void telMarkSent(TelSession &sess, uint8_t mask, uint32_t now) {
+  for (size_t i = 0; i < kTelStreamCount; ++i) {
+    if (mask & (1u << i)) sess.subs[i].lastMs = now;
+  }
+}
+
+// Rate stream: angka (Hz, 0=mati) atau objek {hz} / {ms}
+static bool telParseRate(JsonVariant v, uint32_t &intervalOut) {
+  if (variantIsNumber(v)) {
+    double hz = v.as<double>();
+    if (hz < 0.0) return false;
+    intervalOut = (hz > 0.0) ? telClampInterval(1000.0 / hz) : 0;
+    return true;
+  }
+  if (v.is<JsonObject>()) {
+    JsonObject o = v.as<JsonObject>();
+    JsonVariant msVal = o["ms"];
+    JsonVariant hzVal = o["hz"];
+    if (variantIsNumber(msVal)) {
+      double interval = msVal.as<double>();
+      if (interval < 0.0) return false;
+      intervalOut = (interval > 0.0) ? telClampInterval(interval) : 0;
+      return true;
+    }
+    if (variantIsNumber(hzVal)) return telParseRate(hzVal, intervalOut);
+  }
+  return false;
+}
+
+static void writeSubscription(JsonObject obj, const TelSession &sess) {
+  for (size_t i = 0; i < kTelStreamCount; ++i) {
+    const uint32_t interval = sess.subs[i].intervalMs;
+    obj[kTelStreamNames[i]] = interval ? (1000.0f / (float)interval) : 0.0f;
+  }
+  obj["fmt"] = sess.bandsHex ? "hex" : "json";
+}
+
+static void writeBands(JsonObject obj, const uint8_t *bands, uint8_t len) {
+  if (telCtx->bandsHex) {
+    static const char kHex[] = "0123456789abcdef";
+    char buf[2 * 64 + 1];
+    if (len > 64) len = 64;
+    for (uint8_t i = 0; i < len; ++i) {
+      buf[2 * i] = kHex[bands[i] >> 4];
+      buf[2 * i + 1] = kHex[bands[i] & 0x0F];
+    }
+    buf[2 * len] = '\0';
+    obj["bands_hex"] = buf;
+    return;
+  }
+  JsonArray arr = obj["bands"].to<JsonArray>();
+  for (uint8_t i = 0; i < len; ++i) arr.add(static_cast<uint16_t>(bands[i]));
+}
 
 static void writeTimeISO(JsonObject obj) {
   char buf[24];
@@ -138,18 +395,65 @@ static void writeFeatures(JsonObject root) {
   feats["rtc_temp"] = static_cast<bool>(FEAT_RTC_TEMP_TELEMETRY);
   feats["smps_protect"] = static_cast<bool>(FEAT_SMPS_PROTECT_ENABLE);
   feats["ds18b20_softfilter"] = static_cast<bool>(FEAT_FILTER_DS18B20_SOFT);
+  JsonArray dsRoms = feats["ds18b20"].to<JsonArray>();
+  char romHex[17];
+  for (uint8_t i = 0; i < sensorsTempCount(); ++i) {
+    if (sensorsTempRomHex(i, romHex, sizeof(romHex))) dsRoms.add(romHex);
+  }
+  feats["ds18b20_heatsink_mask"] = DS18B20_HEATSINK_MASK;
   feats["safe_mode"] = static_cast<bool>(SAFE_MODE_SOFT);
+  feats["cmd_window"] = kCmdWindow;
+  feats["cmd_line_max"] = COMMS_CMD_LINE_BUDGET;
+  feats["rx_buf"] = COMMS_RX_LINE_MAX;
+  feats["ota_bin"] = true;
+  feats["ota_comp"] = "heatshrink";
+  feats["ota_hs_wmax"] = OTA_HS_WINDOW_MAX_BITS;
+  feats["ota_delta"] = true;
+  feats["ota_sector"] = OTA_SECTOR_BUF;
+  feats["ota_writer"] = OTA_WRITER_TASK ? "task" : "sync";
+  feats["ota_sign"] = otaSigAvailable();
+  feats["ota_sign_required"] = static_cast<bool>(OTA_SIGN_REQUIRED);
+  feats["ota_health"] = otaHealthStr();
+  feats["i2c_sched"] = true;
+  feats["rtc_soft_clock"] = true;
+  feats["sensor_health"] = true;
+  feats["capture"] = CAPTURE_ENABLE ? CAPTURE_RECORDS : 0;
+  feats["thermal_model"] = static_cast<bool>(THERMAL_MODEL_ENABLE);
+  feats["thermal_horizon_s"] = THERMAL_HORIZON_S;
+  JsonObject cal = feats["cal"].to<JsonObject>();
+  for (size_t i = 0; i < static_cast<size_t>(CalCh::Count); ++i) {
+    const CalCh ch = static_cast<CalCh>(i);
+    CalInfo ci;
+    calibGet(ch, ci);
+    cal[calibChStr(ch)] = calibSourceStr(ci.source);
+  }
+  const char *invalidSlot = otaLastInvalidSlot();
+  if (invalidSlot) feats["ota_invalid_slot"] = invalidSlot;
+  else feats["ota_invalid_slot"] = nullptr;
+  JsonArray streams = feats["telem_streams"].to<JsonArray>();
+  for (size_t i = 0; i < kTelStreamCount; ++i) streams.add(kTelStreamNames[i]);
 }
 
 static void writeErrors(JsonArray arr) {
-  float v = getVoltageInstant();
-  if (!stateSmpsBypass()) {
+  float v = getVoltageFiltered();
+  // NAN = ADC tidak terukur: sudah dilaporkan ADC_FAIL/ADC_STUCK di bawah
+  if (!stateSmpsBypass() && !isnan(v)) {
     if (v == 0.0f) arr.add("NO_POWER");
     else if (v < stateSmpsCutoffV()) arr.add("LOW_VOLTAGE");
   }
   if (isnan(getHeatsinkC())) arr.add("SENSOR_FAIL");
+  for (size_t i = 0; i < static_cast<size_t>(SensorDev::Count); ++i) {
+    const SensorDev dev = static_cast<SensorDev>(i);
+    SensorDevHealth h;
+    sensorHealthGet(dev, h);
+    if (h.state == SensorHealth::Ok) continue;
+    const bool ads = dev == SensorDev::Ads;
+    if (h.state == SensorHealth::Failed) arr.add(ads ? "ADC_FAIL" : "RTC_FAIL");
+    else arr.add(ads ? "ADC_STUCK" : "RTC_STUCK");
+  }
   if (powerSpkProtectFault()) arr.add("SPEAKER_PROTECT_FAIL");
   if (powerOtpFault()) arr.add("OVER_TEMP_FAULT");
+  else if (thermalOtpPredicted()) arr.add("OVER_TEMP_PREDICTED");
   if (powerSmpsHwFaultLatched()) arr.add("SMPS_HW_FAULT");
 }
 
@@ -164,10 +468,9 @@ static void writeAnalyzer(JsonObject data) {
   an["bands_len"] = bandsLen;
   an["update_ms"] = analyzerGetUpdateMs();
   an["vu"] = vu;
-  if (mode && strcmp(mode, "fft") == 0) {
-    JsonArray arr = an["bands"].to<JsonArray>();
-    for (uint8_t i = 0; i < bandsLen; ++i) arr.add(static_cast<uint16_t>(bands[i]));
-  }
+  if (mode && strcmp(mode, "fft") == 0) writeBands(an, bands, bandsLen);
+
+  if (telCtx->bandsHex) return;  // format ringkas: tanpa array legacy "an"
 
   JsonArray legacy = data["an"].to<JsonArray>();
   for (uint8_t i = 0; i < ANA_BANDS; ++i) {
@@ -211,7 +514,7 @@ static void sendFeaturesSnapshot() {
   sendTelemetry(root);
 }
 
-static void sendRealtimeTelemetry(uint32_t now) {
+static void sendRealtimeTelemetry(uint32_t now, uint8_t mask, uint8_t ports) {
   if (!TELEM_REALTIME_ENABLE) return;
 
   JsonDocument doc;
@@ -219,24 +522,27 @@ static void sendRealtimeTelemetry(uint32_t now) {
   root["type"] = "telemetry";
 
   JsonObject rt = root["rt"].to<JsonObject>();
+  const bool spectrum = (mask & telBit(TelStream::Spectrum)) != 0;
   const char *mode = analyzerGetMode();
   uint8_t bandsLen = analyzerGetBandsLen();
-  rt["mode"] = mode;
-  rt["bands_len"] = bandsLen;
-  rt["vu"] = analyzerGetVu();
-  rt["update_ms"] = analyzerGetUpdateMs();
-  if (mode && strcmp(mode, "fft") == 0) {
-    JsonArray arr = rt["bands"].to<JsonArray>();
-    const uint8_t *bands = analyzerGetBands();
-    for (uint8_t i = 0; i < bandsLen; ++i) arr.add(static_cast<uint16_t>(bands[i]));
+  if (spectrum) {
+    rt["mode"] = mode;
+    rt["bands_len"] = bandsLen;
+  }
+  if (mask & telBit(TelStream::Vu)) rt["vu"] = analyzerGetVu();
+  if (spectrum) {
+    rt["update_ms"] = analyzerGetUpdateMs();
+    if (mode && strcmp(mode, "fft") == 0) writeBands(rt, analyzerGetBands(), bandsLen);
   }
 
-  JsonObject link = rt["link"].to<JsonObject>();
-  writeLinkRealtime(link, now);
-  rt["input"] = powerInputModeStr();
-  rt["bt_state"] = powerBtMode() ? "bt" : "aux";
+  if (mask & telBit(TelStream::Link)) {
+    JsonObject link = rt["link"].to<JsonObject>();
+    writeLinkRealtime(link, now);
+    rt["input"] = powerInputModeStr();
+    rt["bt_state"] = powerBtMode() ? "bt" : "aux";
+  }
 
-  sendTelemetry(root);
+  sendTelemetryTo(ports, root);
 }
 
 static void sendAnalyzerSnapshot(const char *evt) {
@@ -259,7 +565,7 @@ static void sendAnalyzerSnapshot(const char *evt) {
   sendTelemetry(root);
 }
 
-static void sendSlowTelemetry(uint32_t now) {
+static void sendSlowTelemetry(uint32_t now, uint8_t mask, uint8_t ports) {
   JsonDocument doc;
   JsonObject root = doc.to<JsonObject>();
   root["type"] = "telemetry";
@@ -269,38 +575,156 @@ static void sendSlowTelemetry(uint32_t now) {
   data["fw_ver"] = FW_VERSION;
   data["ota_ready"] = otaReady;
 
-  JsonObject smps = data["smps"].to<JsonObject>();
-  smps["v"] = getVoltageInstant();
-  smps["stage"] = powerSmpsTripLatched() ? "trip" : (powerIsOn() ? "armed" : "standby");
-  smps["cutoff"] = stateSmpsCutoffV();
+  const bool power = (mask & telBit(TelStream::Power)) != 0;
+  const bool sensors = (mask & telBit(TelStream::Sensors)) != 0;
+
+  if (power) {
+    JsonObject smps = data["smps"].to<JsonObject>();
+    setFloatOrNull(smps, "v", getVoltageInstant());
+    setFloatOrNull(smps, "v_f", getVoltageFiltered());
+    float lo, hi;
+    if (sensorsEnvelope(SensorCh::Smps, lo, hi)) {
+      smps["v_min"] = lo;
+      smps["v_max"] = hi;
+    }
+    smps["stage"] = powerSmpsTripLatched() ? "trip" : (powerIsOn() ? "armed" : "standby");
+    smps["cutoff"] = stateSmpsCutoffV();
 
-  data["sleep_timer"] = powerGetSleepRemainingMinutes();
-  smps["recover"] = stateSmpsRecoveryV();
+    data["sleep_timer"] = powerGetSleepRemainingMinutes();
+    smps["recover"] = stateSmpsRecoveryV();
+  }
 
-  data["v12"] = getVoltage12V();
+  if (sensors) {
+    setFloatOrNull(data, "v12", getVoltage12V());
+    setFloatOrNull(data, "v12_f", getVoltage12VFiltered());
+
+    setFloatOrNull(data, "heat_c", getHeatsinkC());
+    setFloatOrNull(data, "heat_raw", getHeatsinkInstantC());
+    ThermalStatus th;
+    thermalGetStatus(th);
+    JsonObject thermal = data["thermal"].to<JsonObject>();
+    thermal["ready"] = th.ready;
+    setFloatOrNull(thermal, "pred_c", th.predC);
+    setFloatOrNull(thermal, "pred_max_fan_c", th.predMaxFanC);
+    thermal["err"] = roundf(th.errCpm * 100.0f) / 100.0f;
+    thermal["n"] = th.updates;
+
+    const uint8_t nTemps = sensorsTempCount();
+    if (nTemps > 0) {
+      JsonArray temps = data["temps"].to<JsonArray>();
+      for (uint8_t i = 0; i < nTemps; ++i) {
+        const float t = sensorsTempC(i);
+        if (isnan(t)) temps.add(nullptr);
+        else temps.add(t);
+      }
+    }
+    setFloatOrNull(data, "rtc_c", sensorsGetRtcTempC());
+
+    I2cBusStats bus;
+    i2cBusGetStats(bus);
+    JsonObject i2c = data["i2c"].to<JsonObject>();
+    i2c["util"] = roundf(bus.utilPct * 10.0f) / 10.0f;
+    i2c["tx"] = bus.txCount;
+    i2c["timeouts"] = bus.timeouts;
+    i2c["hold_max_us"] = bus.holdMaxUs;
+    i2c["recoveries"] = bus.recoveries;
+    JsonObject waitMax = i2c["wait_max_us"].to<JsonObject>();
+    for (size_t i = 0; i < static_cast<size_t>(I2cPrio::Count); ++i) {
+      waitMax[i2cPrioStr(static_cast<I2cPrio>(i))] = bus.waitMaxUs[i];
+    }
 
-  setFloatOrNull(data, "heat_c", getHeatsinkC());
-  setFloatOrNull(data, "rtc_c", sensorsGetRtcTempC());
+    RtcClockStats clk;
+    rtcClockGetStats(clk);
+    JsonObject rtcObj = data["rtc"].to<JsonObject>();
+    rtcObj["sqw"] = clk.sqwOk;
+    rtcObj["verifies"] = clk.verifies;
+    rtcObj["corr"] = clk.corrections;
+    rtcObj["drift_s"] = clk.lastDriftS;
+
+    const uint32_t nowMs = millis();
+    JsonObject health = data["health"].to<JsonObject>();
+    for (size_t i = 0; i < static_cast<size_t>(SensorDev::Count); ++i) {
+      const SensorDev dev = static_cast<SensorDev>(i);
+      SensorDevHealth h;
+      sensorHealthGet(dev, h);
+      JsonObject d = health[sensorDevStr(dev)].to<JsonObject>();
+      d["state"] = sensorHealthStr(h.state);
+      d["err"] = h.errors;
+      d["rec"] = h.recoveries;
+      d["stuck"] = h.stuckEvents;
+      if (h.lastGoodMs) d["age_ms"] = nowMs - h.lastGoodMs;
+      else d["age_ms"] = nullptr;
+    }
+  }
 
-  JsonObject inputs = data["inputs"].to<JsonObject>();
-  inputs["bt"] = powerBtMode();
-  inputs["speaker"] = powerGetSpeakerSelectBig() ? "big" : "small";
+  if (power) {
+    JsonObject inputs = data["inputs"].to<JsonObject>();
+    inputs["bt"] = powerBtMode();
+    inputs["speaker"] = powerGetSpeakerSelectBig() ? "big" : "small";
 
-  JsonObject states = data["states"].to<JsonObject>();
-  states["on"] = powerIsOn();
-  states["standby"] = powerIsStandby();
+    JsonObject states = data["states"].to<JsonObject>();
+    states["on"] = powerIsOn();
+    states["standby"] = powerIsStandby();
 
-  JsonArray errs = data["errors"].to<JsonArray>();
-  writeErrors(errs);
+    JsonArray errs = data["errors"].to<JsonArray>();
+    writeErrors(errs);
+  }
 
-  writeAnalyzer(data);
-  writeBuzzer(data);
-  writeNvsSnapshot(data);
+  // Snapshot analyzer ikut hz1 selama stream spectrum aktif (perilaku lama)
+  if (telEnabled(TelStream::Spectrum)) writeAnalyzer(data);
+  if (mask & telBit(TelStream::Nvs)) {
+    writeBuzzer(data);
+    writeNvsSnapshot(data);
+  }
   // Features removed from periodic telemetry - sent once at boot
 
-  sendTelemetry(root);
+  sendTelemetryTo(ports, root);
+}
+
+// id request yang sedang diproses (opsional, dari root "id"); di-echo ke
+// setiap ack/error/event OTA supaya panel bisa mem-pipeline perintah.
+static JsonVariantConst curReqId;
+
+static bool reqIdValid(JsonVariantConst id) {
+  if (id.is<uint32_t>()) return true;
+  if (!id.is<const char*>()) return false;
+  const char *s = id.as<const char*>();
+  return s && strlen(s) <= COMMS_REQ_ID_MAX_LEN;
 }
 
+static void tagReqId(JsonObject root) {
+  if (!curReqId.isNull()) root["id"] = curReqId;
+}
+
+// id perintah yang hasilnya menyusul (OTA, img_hash, cal point) disalin
+// karena arena tidak bertahan; event yang tidak lahir dari frame ber-id
+// (bin_ack/bin_nak/bin_exit, hash dari auditTick, ...) tetap bisa
+// dicocokkan host dengan permintaannya.
+struct SavedReqId {
+  bool set;
+  bool num;
+  uint32_t n;
+  char s[COMMS_REQ_ID_MAX_LEN + 1];
+};
+
+static void reqIdSave(SavedReqId &r) {
+  r.set = !curReqId.isNull();
+  r.num = curReqId.is<uint32_t>();
+  if (!r.set) return;
+  if (r.num) r.n = curReqId.as<uint32_t>();
+  else snprintf(r.s, sizeof(r.s), "%s", curReqId.as<const char*>());
+}
+
+// id frame berjalan lebih diutamakan; selain itu id yang disimpan
+static void tagSavedReqId(const SavedReqId &r, JsonObject root) {
+  if (!curReqId.isNull()) root["id"] = curReqId;
+  else if (r.set && r.num) root["id"] = r.n;
+  else if (r.set) root["id"] = (const char *)r.s;
+}
+
+// ota_begin/ota_resume
+static SavedReqId otaReqId = {};
+
 static void playAckTone() {
   if (!powerSpkProtectFault() && !stateSafeModeSoft()) buzzerClick();
 }
@@ -313,6 +737,7 @@ static void sendAckOk(const char *key, const TValue &value, bool tone = true) {
   root["ok"] = true;
   root["changed"] = key;
   root["value"] = value;
+  tagReqId(root);
   sendTelemetry(root);
   // Bunyikan buzzer setiap perintah ter-handle sukses
   // (bukan di level parsing raw string agar tak ikut bunyi saat menerima data OTA)
@@ -326,6 +751,7 @@ static void sendAckErr(const char *key, const char *reason) {
   root["ok"] = false;
   root["error"] = reason ? reason : "invalid";
   if (key) root["changed"] = key;
+  tagReqId(root);
   sendTelemetry(root);
 }
 
@@ -382,6 +808,7 @@ static void sendOtaEvent(const char *evt) {
   JsonObject root = doc.to<JsonObject>();
   root["type"] = "ota";
   root["evt"] = evt;
+  tagSavedReqId(otaReqId, root);
   sendTelemetry(root);
 }
 
@@ -392,6 +819,7 @@ static void sendOtaEvent(const char *evt, const char *field, const TValue &value
   root["type"] = "ota";
   root["evt"] = evt;
   root[field] = value;
+  tagSavedReqId(otaReqId, root);
   sendTelemetry(root);
 }
 
@@ -401,6 +829,8 @@ static void sendOtaWriteOk(uint32_t seq) {
   root["type"] = "ota";
   root["evt"] = "write_ok";
   root["seq"] = seq;
+  root["next"] = otaSeqNext();
+  tagSavedReqId(otaReqId, root);
   sendTelemetry(root);
 }
 
@@ -410,7 +840,9 @@ static void sendOtaWriteErr(uint32_t seq, const char *err) {
   root["type"] = "ota";
   root["evt"] = "write_err";
   root["seq"] = seq;
+  root["next"] = otaSeqNext();
   root["err"] = err ? err : "error";
+  tagSavedReqId(otaReqId, root);
   sendTelemetry(root);
 }
 
@@ -420,6 +852,7 @@ static void sendOtaError(const char *err) {
   root["type"] = "ota";
   root["evt"] = "error";
   root["err"] = err ? err : "unknown";
+  tagSavedReqId(otaReqId, root);
   sendTelemetry(root);
 }
 
@@ -445,6 +878,21 @@ static bool parseIso8601ToEpoch(const char *iso, uint32_t &epochOut) {
   return true;
 }
 
+// Hex string tepat 2*len digit → byte (mis. SHA-256)
+static bool parseHexBytes(const char *hex, uint8_t *out, size_t len) {
+  if (!hex || strlen(hex) != len * 2) return false;
+  for (size_t i = 0; i < len * 2; ++i) {
+    const char ch = hex[i];
+    uint8_t nibble;
+    if (ch >= '0' && ch <= '9') nibble = (uint8_t)(ch - '0');
+    else if (ch >= 'a' && ch <= 'f') nibble = (uint8_t)(ch - 'a' + 10);
+    else if (ch >= 'A' && ch <= 'F') nibble = (uint8_t)(ch - 'A' + 10);
+    else return false;
+    out[i / 2] = (uint8_t)((i & 1) ? (out[i / 2] | nibble) : (nibble << 4));
+  }
+  return true;
+}
+
 static bool parseHex32(const char *hex, uint32_t &valueOut) {
   if (!hex) return false;
   uint32_t val = 0;
@@ -486,109 +934,134 @@ static void handleRtcSync(uint32_t targetEpoch) {
   forceTel = true;
 }
 
-// Force sync RTC (bypass rate limit)
-static void handleCmdPower(JsonVariant v) {
-  if (!v.is<bool>()) { sendAckErr("power", "invalid"); return; }
-  bool on = v.as<bool>();
-  powerSetMainRelay(on, PowerChangeReason::Command);
-  sendAckOk("power", on);
-  forceTel = true;
+// ---- Setter: parse (validasi tanpa efek samping) + apply (aksi & nilai ack) ----
+// Dipakai bersama oleh perintah tunggal maupun batch.
+struct CmdArg {
+  bool b;
+  uint32_t u;
+  float f;
+  FanMode fan;
+};
+
+typedef bool (*CmdParse)(JsonVariant v, CmdArg &out, const char *&err);
+typedef void (*CmdApply)(const CmdArg &arg, JsonVariant ackValue);
+
+// Cutoff/recovery efektif untuk validasi silang (batch memakai nilai barunya)
+static float valSmpsCutV = 0.0f, valSmpsRecV = 0.0f;
+
+static bool parseBool(JsonVariant v, CmdArg &out, const char *&err) {
+  if (!v.is<bool>()) { err = "invalid"; return false; }
+  out.b = v.as<bool>();
+  return true;
 }
 
-static void handleCmdSleepTimer(JsonVariant v) {
-  if (!v.is<uint32_t>()) { sendAckErr("sleep_timer", "invalid"); return; }
-  uint32_t minutes = v.as<uint32_t>();
-  powerSetSleepTimer(minutes);
-  sendAckOk("sleep_timer", minutes);
-  forceTel = true;
+static void applyPower(const CmdArg &a, JsonVariant ack) {
+  powerSetMainRelay(a.b, PowerChangeReason::Command);
+  ack.set(a.b);
 }
 
-static void handleCmdBt(JsonVariant v) {
-  if (!v.is<bool>()) { sendAckErr("bt", "invalid"); return; }
-  bool en = v.as<bool>();
-  powerSetBtEnabled(en);
-  sendAckOk("bt", en);
-  forceTel = true;
+static bool parseSleepTimer(JsonVariant v, CmdArg &out, const char *&err) {
+  if (!v.is<uint32_t>()) { err = "invalid"; return false; }
+  out.u = v.as<uint32_t>();
+  return true;
+}
+
+static void applySleepTimer(const CmdArg &a, JsonVariant ack) {
+  powerSetSleepTimer(a.u);
+  ack.set(a.u);
+}
+
+static void applyBt(const CmdArg &a, JsonVariant ack) {
+  powerSetBtEnabled(a.b);
+  ack.set(a.b);
 }
 
-static void handleCmdSpkSel(JsonVariant v) {
-  if (!v.is<const char*>()) { sendAckErr("spk_sel", "invalid"); return; }
+static bool parseSpkSel(JsonVariant v, CmdArg &out, const char *&err) {
+  err = "invalid";
+  if (!v.is<const char*>()) return false;
   const char *s = v.as<const char*>();
-  bool big;
-  if (equalsIgnoreCase(s, "big")) big = true;
-  else if (equalsIgnoreCase(s, "small")) big = false;
-  else { sendAckErr("spk_sel", "invalid"); return; }
-  powerSetSpeakerSelect(big);
-  sendAckOk("spk_sel", big ? "big" : "small");
-  forceTel = true;
+  if (equalsIgnoreCase(s, "big")) out.b = true;
+  else if (equalsIgnoreCase(s, "small")) out.b = false;
+  else return false;
+  return true;
 }
 
-static void handleCmdSpkPwr(JsonVariant v) {
-  if (!v.is<bool>()) { sendAckErr("spk_pwr", "invalid"); return; }
-  bool on = v.as<bool>();
-  powerSetSpeakerPower(on);
-  sendAckOk("spk_pwr", on);
-  forceTel = true;
+static void applySpkSel(const CmdArg &a, JsonVariant ack) {
+  powerSetSpeakerSelect(a.b);
+  ack.set(a.b ? "big" : "small");
 }
 
-static void handleCmdSmpsBypass(JsonVariant v) {
-  if (!v.is<bool>()) { sendAckErr("smps_bypass", "invalid"); return; }
-  bool en = v.as<bool>();
-  stateSetSmpsBypass(en);
-  sendAckOk("smps_bypass", en);
-  forceTel = true;
+static void applySpkPwr(const CmdArg &a, JsonVariant ack) {
+  powerSetSpeakerPower(a.b);
+  ack.set(a.b);
 }
 
-static void handleCmdSmpsCut(JsonVariant v) {
-  if (!variantIsNumber(v)) { sendAckErr("smps_cut", "invalid"); return; }
+static void applySmpsBypass(const CmdArg &a, JsonVariant ack) {
+  stateSetSmpsBypass(a.b);
+  ack.set(a.b);
+}
+
+static bool parseSmpsCut(JsonVariant v, CmdArg &out, const char *&err) {
+  if (!variantIsNumber(v)) { err = "invalid"; return false; }
   float cut = v.as<float>();
-  if (cut < 30.0f || cut > 70.0f || cut >= stateSmpsRecoveryV()) {
-    sendAckErr("smps_cut", "range"); return;
-  }
-  stateSetSmpsCutoffV(cut);
-  sendAckOk("smps_cut", cut);
-  forceTel = true;
+  if (cut < 30.0f || cut > 70.0f || cut >= valSmpsRecV) { err = "range"; return false; }
+  out.f = cut;
+  return true;
+}
+
+static void applySmpsCut(const CmdArg &a, JsonVariant ack) {
+  stateSetSmpsCutoffV(a.f);
+  ack.set(a.f);
 }
 
-static void handleCmdSmpsRec(JsonVariant v) {
-  if (!variantIsNumber(v)) { sendAckErr("smps_rec", "invalid"); return; }
+static bool parseSmpsRec(JsonVariant v, CmdArg &out, const char *&err) {
+  if (!variantIsNumber(v)) { err = "invalid"; return false; }
   float rec = v.as<float>();
-  if (rec < 30.0f || rec > 80.0f || rec <= stateSmpsCutoffV()) {
-    sendAckErr("smps_rec", "range"); return;
-  }
-  stateSetSmpsRecoveryV(rec);
-  sendAckOk("smps_rec", rec);
-  forceTel = true;
+  if (rec < 30.0f || rec > 80.0f || rec <= valSmpsCutV) { err = "range"; return false; }
+  out.f = rec;
+  return true;
+}
+
+static void applySmpsRec(const CmdArg &a, JsonVariant ack) {
+  stateSetSmpsRecoveryV(a.f);
+  ack.set(a.f);
 }
 
-static void handleCmdBtAutoOff(JsonVariant v) {
-  if (!variantIsNumber(v)) { sendAckErr("bt_autooff", "invalid"); return; }
+static bool parseBtAutoOff(JsonVariant v, CmdArg &out, const char *&err) {
+  if (!variantIsNumber(v)) { err = "invalid"; return false; }
   double valD = v.as<double>();
-  if (valD < 0.0 || valD > 3600000.0) { sendAckErr("bt_autooff", "range"); return; }
-  uint32_t val = (uint32_t)(valD + 0.5);
-  stateSetBtAutoOffMs(val);
-  sendAckOk("bt_autooff", val);
-  forceTel = true;
+  if (valD < 0.0 || valD > 3600000.0) { err = "range"; return false; }
+  out.u = (uint32_t)(valD + 0.5);
+  return true;
 }
 
-static void handleCmdFanMode(JsonVariant v) {
-  if (!v.is<const char*>()) { sendAckErr("fan_mode", "invalid"); return; }
-  FanMode mode;
-  if (!fanModeFromStr(v.as<const char*>(), mode)) {
-    sendAckErr("fan_mode", "invalid"); return;
-  }
-  stateSetFanMode(mode);
-  sendAckOk("fan_mode", fanModeToStr(mode));
-  forceTel = true;
+static void applyBtAutoOff(const CmdArg &a, JsonVariant ack) {
+  stateSetBtAutoOffMs(a.u);
+  ack.set(a.u);
+}
+
+static bool parseFanMode(JsonVariant v, CmdArg &out, const char *&err) {
+  err = "invalid";
+  if (!v.is<const char*>()) return false;
+  return fanModeFromStr(v.as<const char*>(), out.fan);
 }
 
-static void handleCmdFanDuty(JsonVariant v) {
-  if (!variantIsNumber(v)) { sendAckErr("fan_duty", "invalid"); return; }
+static void applyFanMode(const CmdArg &a, JsonVariant ack) {
+  stateSetFanMode(a.fan);
+  ack.set(fanModeToStr(a.fan));
+}
+
+static bool parseFanDuty(JsonVariant v, CmdArg &out, const char *&err) {
+  if (!variantIsNumber(v)) { err = "invalid"; return false; }
   int duty = (int)std::lround(v.as<double>());
-  if (duty < 0 || duty > 1023) { sendAckErr("fan_duty", "range"); return; }
-  stateSetFanCustomDuty((uint16_t)duty);
-  sendAckOk("fan_duty", duty);
-  forceTel = true;
+  if (duty < 0 || duty > 1023) { err = "range"; return false; }
+  out.u = (uint32_t)duty;
+  return true;
+}
+
+static void applyFanDuty(const CmdArg &a, JsonVariant ack) {
+  stateSetFanCustomDuty((uint16_t)a.u);
+  ack.set((int)a.u);
 }
 
 static void handleCmdRtcSet(JsonVariant v) {
@@ -634,6 +1107,33 @@ static void handleCmdFactoryReset(JsonVariant v) {
   appPerformFactoryReset("FACTORY RESET (UART)", "uart");
 }
 
+// Mulai baris berikutnya, port asal perintah membawa frame biner
+static void otaBinEnter() {
+  otaBin.port = curRxPort;
+  otaBin.sinceAck = 0;
+  otaBin.nakFloor = otaSeqNext();
+  otaBin.crcNakSent = false;
+  otaBin.lastMs = millis();
+}
+
+// begin_ok / resume_ok: parameter sesi untuk host
+static void sendOtaSessionEvent(const char *evt, bool bin) {
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "ota";
+  root["evt"] = evt;
+  root["mode"] = bin ? "bin" : "json";
+  root["offset"] = (uint32_t)otaReceivedBytes();
+  root["size"] = (uint32_t)otaExpectedSize();
+  root["stream_size"] = (uint32_t)otaStreamSize();
+  root["next_seq"] = otaSeqNext();
+  root["window"] = OTA_WINDOW;
+  root["frame_max"] = OTA_BIN_FRAME_MAX;
+  if (bin) root["ack_every"] = OTA_BIN_ACK_EVERY;
+  tagSavedReqId(otaReqId, root);
+  sendTelemetry(root);
+}
+
 static void handleCmdOtaBegin(JsonVariant v) {
   if (!v.is<JsonObject>()) {
     sendOtaEvent("begin_err", "err", "invalid");
@@ -651,7 +1151,50 @@ static void handleCmdOtaBegin(JsonVariant v) {
       return;
     }
   }
-  if (!otaBegin(size, crc)) {
+  const char *mode = o["mode"] | "json";
+  const bool bin = (strcmp(mode, "bin") == 0);
+  if (!bin && strcmp(mode, "json") != 0) {
+    sendOtaEvent("begin_err", "err", "mode_invalid");
+    sendOtaError("mode_invalid");
+    return;
+  }
+  if (bin && !curRxPort) {
+    sendOtaEvent("begin_err", "err", "mode_unavailable");
+    sendOtaError("mode_unavailable");
+    return;
+  }
+  // "comp":{"alg":"heatshrink","w":10,"l":5,"size":<byte terkompresi>}
+  // "delta":true + "stream_size" (tanpa comp), "sha256" wajib, "src_sha256" opsional
+  // "sig":true → 128 byte terakhir image adalah trailer tanda tangan (ota_sig.h)
+  OtaBeginOptions opt = {};
+  JsonObject c = o["comp"];
+  if (!c.isNull()) {
+    const char *alg = c["alg"] | "";
+    if (strcmp(alg, "heatshrink") != 0) {
+      sendOtaEvent("begin_err", "err", "comp_unsupported");
+      sendOtaError("comp_unsupported");
+      return;
+    }
+    opt.comp = OtaComp::Heatshrink;
+    opt.hsWindowBits = c["w"] | 0;
+    opt.hsLookaheadBits = c["l"] | 0;
+    opt.streamSize = c["size"] | 0;
+  } else {
+    opt.streamSize = o["stream_size"] | 0;
+  }
+  opt.delta = o["delta"] | false;
+  opt.sig = o["sig"] | false;
+  const char *shaHex = o["sha256"] | nullptr;
+  const char *srcShaHex = o["src_sha256"] | nullptr;
+  opt.hasSha256 = shaHex != nullptr;
+  opt.hasSrcSha256 = srcShaHex != nullptr;
+  if ((shaHex && !parseHexBytes(shaHex, opt.sha256, sizeof(opt.sha256))) ||
+      (srcShaHex && !parseHexBytes(srcShaHex, opt.srcSha256, sizeof(opt.srcSha256)))) {
+    sendOtaEvent("begin_err", "err", "sha_invalid");
+    sendOtaError("sha_invalid");
+    return;
+  }
+  if (!otaBegin(size, crc, &opt)) {
     const char *err = otaLastError();
     sendOtaEvent("begin_err", "err", err);
     sendOtaError(err);
@@ -659,7 +1202,11 @@ static void handleCmdOtaBegin(JsonVariant v) {
   }
   powerSetOtaActive(true);
   commsSetOtaReady(false);
-  sendOtaEvent("begin_ok");
+  otaSeqReset(0);
+  otaSeqAnchored = bin;  // biner selalu mulai seq 0
+  if (bin) otaBinEnter();
+  reqIdSave(otaReqId);
+  sendOtaSessionEvent("begin_ok", bin);
   forceTel = true;
 }
 
@@ -671,33 +1218,82 @@ static void handleCmdOtaWrite(JsonVariant v) {
   }
   JsonObject o = v.as<JsonObject>();
   uint32_t seq = o["seq"] | 0;
+  if (otaBin.port) {
+    sendOtaWriteErr(seq, "bin_mode");
+    return;
+  }
+  if (otaStatus() != OtaStatus::InProgress) {
+    sendOtaWriteErr(seq, "not_started");
+    sendOtaError("not_started");
+    return;
+  }
+  if (!otaSeqAnchored) {
+    otaSeqReset(seq);
+    otaSeqAnchored = true;
+  }
+  // Error per chunk (decode/CRC/celah) tidak membatalkan sesi: host cukup
+  // mengirim ulang chunk tersebut. Hanya kegagalan flash yang fatal.
   const char *dataB64 = o["data_b64"] | nullptr;
   if (!dataB64) {
     sendOtaWriteErr(seq, "invalid_data");
-    sendOtaError("invalid_data");
     return;
   }
   size_t inLen = strlen(dataB64);
-  std::vector<uint8_t> decoded((inLen * 3) / 4 + 4);
   size_t outLen = 0;
-  int rc = mbedtls_base64_decode(decoded.data(), decoded.size(), &outLen,
+  int rc = mbedtls_base64_decode(otaDecodeBuf, sizeof(otaDecodeBuf), &outLen,
                                  reinterpret_cast<const unsigned char*>(dataB64), inLen);
   if (rc != 0) {
     sendOtaWriteErr(seq, "b64_decode");
-    sendOtaError("b64_decode");
     return;
   }
-  int wrote = otaWrite(decoded.data(), outLen);
-  if (wrote < 0) {
-    const char *err = otaLastError();
-    sendOtaWriteErr(seq, err);
-    sendOtaError(err);
-    return;
+  const char *crcHex = o["crc32"] | nullptr;
+  if (crcHex) {
+    uint32_t crc = 0;
+    if (!parseHex32(crcHex, crc) || jacktorCrc32(0, otaDecodeBuf, outLen) != crc) {
+      sendOtaWriteErr(seq, "crc");
+      return;
+    }
+  }
+  switch (otaSeqAccept(seq, otaDecodeBuf, outLen)) {
+    case OtaChunkResult::Written:
+    case OtaChunkResult::Buffered:
+    case OtaChunkResult::Duplicate:
+      sendOtaWriteOk(seq);
+      break;
+    case OtaChunkResult::OutOfWindow:
+      sendOtaWriteErr(seq, "window");
+      break;
+    case OtaChunkResult::WriteError: {
+      const char *err = otaLastError();
+      sendOtaWriteErr(seq, err);
+      sendOtaError(err);
+      break;
+    }
   }
-  sendOtaWriteOk(seq);
   otaYieldOnce();
 }
 
+// Lanjutkan sesi setelah link putus: laporkan offset & seq berikutnya.
+// Chunk tertunda di reorder buffer dibuang; host mengirim ulang dari next_seq.
+static void handleCmdOtaResume(JsonVariant v) {
+  const char *mode = v["mode"] | "json";
+  const bool bin = (strcmp(mode, "bin") == 0);
+  if (otaStatus() != OtaStatus::InProgress) {
+    sendOtaEvent("resume_err", "err", "not_in_progress");
+    return;
+  }
+  if (bin && !curRxPort) {
+    sendOtaEvent("resume_err", "err", "mode_unavailable");
+    return;
+  }
+  otaSeqReset(otaSeqNext());
+  otaSeqAnchored = true;
+  if (otaBin.port && otaBin.port != curRxPort) otaBin.port = nullptr;
+  if (bin) otaBinEnter();
+  reqIdSave(otaReqId);
+  sendOtaSessionEvent("resume_ok", bin);
+}
+
 static void handleCmdOtaEnd(JsonVariant v) {
   if (!v.is<JsonObject>()) {
     sendOtaEvent("end_err", "err", "invalid");
@@ -720,6 +1316,289 @@ static void handleCmdOtaEnd(JsonVariant v) {
   forceTel = true;
 }
 
+// ---- Audit image firmware ----
+// {"img_hash":{"slot":"both","len":"image"}} → "hash_start", lalu satu event
+// "hash" per slot setelah auditTick selesai (tidak memblok loop).
+static void sendImgError(const char *evt, const char *slot, const char *err) {
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "img";
+  root["evt"] = evt;
+  if (slot) root["slot"] = slot;
+  root["err"] = err;
+  tagReqId(root);
+  sendTelemetry(root);
+}
+
+// id img_hash: event "hash" menyusul dari auditTick, di luar frame perintah
+static SavedReqId imgHashReqId = {};
+
+static void sendImgHashResult(const AuditResult &r) {
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "img";
+  root["evt"] = r.ok ? "hash" : "hash_err";
+  root["slot"] = r.part->label;
+  root["running"] = (r.part == esp_ota_get_running_partition());
+  if (r.ok) {
+    static const char kHex[] = "0123456789abcdef";
+    char hex[65];
+    for (size_t i = 0; i < sizeof(r.sha256); ++i) {
+      hex[2 * i] = kHex[r.sha256[i] >> 4];
+      hex[2 * i + 1] = kHex[r.sha256[i] & 0x0F];
+    }
+    hex[64] = '\0';
+    root["len"] = r.len;
+    root["sha256"] = hex;
+  } else {
+    root["err"] = r.err ? r.err : "error";
+  }
+  root["last"] = r.last;
+  tagSavedReqId(imgHashReqId, root);
+  sendTelemetry(root);
+}
+
+static void handleCmdImgHash(JsonVariant v) {
+  const char *slot = v["slot"] | "both";
+  AuditLen mode = AuditLen::Image;
+  uint32_t bytes = 0;
+  JsonVariant lenV = v["len"];
+  if (lenV.is<uint32_t>()) {
+    mode = AuditLen::Bytes;
+    bytes = lenV.as<uint32_t>();
+  } else {
+    const char *len = lenV | "image";
+    if (strcmp(len, "full") == 0) mode = AuditLen::Full;
+    else if (strcmp(len, "image") != 0) { sendImgError("hash_err", nullptr, "len_invalid"); return; }
+  }
+
+  const esp_partition_t *parts[2];
+  uint8_t count = 0;
+  if (strcmp(slot, "both") == 0) {
+    parts[count++] = auditResolveSlot("running");
+    parts[count++] = auditResolveSlot("other");
+  } else {
+    parts[count++] = auditResolveSlot(slot);
+  }
+  for (uint8_t i = 0; i < count; ++i) {
+    if (!parts[i]) { sendImgError("hash_err", slot, "slot_invalid"); return; }
+  }
+  if (auditBusy()) { sendImgError("hash_err", slot, "busy"); return; }
+  if (otaStatus() == OtaStatus::InProgress) { sendImgError("hash_err", slot, "ota_active"); return; }
+  if (!auditHashStart(parts, count, mode, bytes)) { sendImgError("hash_err", slot, "invalid"); return; }
+  reqIdSave(imgHashReqId);
+
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "img";
+  root["evt"] = "hash_start";
+  JsonArray slots = root["slots"].to<JsonArray>();
+  for (uint8_t i = 0; i < count; ++i) slots.add(parts[i]->label);
+  tagReqId(root);
+  sendTelemetry(root);
+}
+
+// {"img_read":{"slot":"running","offset":0,"len":1024}} → data_b64 (forensik)
+static uint8_t imgReadBuf[AUDIT_READ_MAX];
+static unsigned char imgReadB64[((AUDIT_READ_MAX + 2) / 3) * 4 + 1];
+static_assert(sizeof(imgReadB64) - 1 + AUDIT_READ_ENVELOPE < COMMS_PEER_LINE_MAX,
+              "AUDIT_READ_MAX: event read tidak muat satu frame bridge");
+
+static void handleCmdImgRead(JsonVariant v) {
+  const char *slot = v["slot"] | "running";
+  const esp_partition_t *part = auditResolveSlot(slot);
+  if (!part) { sendImgError("read_err", slot, "slot_invalid"); return; }
+  const uint32_t offset = v["offset"] | 0;
+  const uint32_t len = v["len"] | 0;
+  if (len == 0 || len > AUDIT_READ_MAX) { sendImgError("read_err", part->label, "len_invalid"); return; }
+  if (!auditRead(part, offset, imgReadBuf, len)) { sendImgError("read_err", part->label, "range"); return; }
+
+  size_t outLen = 0;
+  if (mbedtls_base64_encode(imgReadB64, sizeof(imgReadB64), &outLen, imgReadBuf, len) != 0) {
+    sendImgError("read_err", part->label, "encode");
+    return;
+  }
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "img";
+  root["evt"] = "read";
+  root["slot"] = part->label;
+  root["offset"] = offset;
+  root["len"] = len;
+  root["data_b64"] = reinterpret_cast<const char*>(imgReadB64);
+  tagReqId(root);
+  sendTelemetry(root);
+}
+
+// ---- Capture pra-trigger (forensik brown-out) ----
+// {"cap_info":true} → ringkasan; {"cap_read":{"offset":0,"len":1344}} → potongan
+// image biner (header + record, lihat capture.h) dalam base64; {"cap_arm":true}
+// membuang dump & menjalankan ring lagi; {"cap_trigger":true} membekukan manual.
+static void sendCapError(const char *evt, const char *err) {
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "cap";
+  root["evt"] = evt;
+  root["err"] = err;
+  tagReqId(root);
+  sendTelemetry(root);
+}
+
+static void sendCapInfo(const char *evt) {
+  CaptureInfo info;
+  captureInfo(info);
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "cap";
+  root["evt"] = evt;
+  root["state"] = captureStateStr(info.state);
+  root["reason"] = captureReasonStr(info.reason);
+  if (info.state == CaptureState::Frozen) {
+    root["prev_boot"] = info.prevBoot;
+    if (info.reason == CaptureReason::Reset) root["rst"] = info.resetReason;
+    root["trig_ms"] = info.trigMs;
+    root["records"] = info.records;
+    root["bytes"] = info.bytes;
+    char crcHex[9];
+    snprintf(crcHex, sizeof(crcHex), "%08lx", static_cast<unsigned long>(info.crc32));
+    root["crc32"] = crcHex;
+  }
+  tagReqId(root);
+  sendTelemetry(root);
+}
+
+static void handleCmdCapInfo(JsonVariant) {
+  sendCapInfo("info");
+}
+
+static void handleCmdCapRead(JsonVariant v) {
+  const uint32_t offset = v["offset"] | 0;
+  const uint32_t len = v["len"] | 0;
+  if (captureState() != CaptureState::Frozen) { sendCapError("read_err", "not_frozen"); return; }
+  if (len == 0 || len > AUDIT_READ_MAX) { sendCapError("read_err", "len_invalid"); return; }
+  // Buffer img_read dipakai bersama: keduanya sinkron di loop
+  if (!captureRead(offset, imgReadBuf, len)) { sendCapError("read_err", "range"); return; }
+
+  size_t outLen = 0;
+  if (mbedtls_base64_encode(imgReadB64, sizeof(imgReadB64), &outLen, imgReadBuf, len) != 0) {
+    sendCapError("read_err", "encode");
+    return;
+  }
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "cap";
+  root["evt"] = "read";
+  root["offset"] = offset;
+  root["len"] = len;
+  root["data_b64"] = reinterpret_cast<const char*>(imgReadB64);
+  tagReqId(root);
+  sendTelemetry(root);
+}
+
+static void handleCmdCapArm(JsonVariant v) {
+  if (v.is<bool>() && !v.as<bool>()) { sendCapError("arm_err", "invalid"); return; }
+  captureRearm();
+  sendCapInfo("arm_ok");
+}
+
+static void handleCmdCapTrigger(JsonVariant v) {
+  if (v.is<bool>() && !v.as<bool>()) { sendCapError("trigger_err", "invalid"); return; }
+  if (!CAPTURE_ENABLE) { sendCapError("trigger_err", "disabled"); return; }
+  if (captureState() != CaptureState::Armed) { sendCapError("trigger_err", "not_armed"); return; }
+  captureTrigger(CaptureReason::Manual);
+  sendCapInfo("trigger_ok");
+}
+
+static void writeCalChannel(JsonObject o, CalCh ch) {
+  CalInfo ci;
+  calibGet(ch, ci);
+  o["gain"] = ci.gain;
+  o["off"] = ci.offsetV;
+  o["src"] = calibSourceStr(ci.source);
+  o["points"] = ci.points;
+  o["epoch"] = ci.epoch;
+  o["pending"] = ci.pending;
+}
+
+static void sendCalEvent(const char *evt, CalCh ch, const char *err = nullptr) {
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "cal";
+  root["evt"] = evt;
+  root["ch"] = calibChStr(ch);
+  if (err) root["err"] = err;
+  else writeCalChannel(root, ch);
+  tagReqId(root);
+  sendTelemetry(root);
+}
+
+// id cal point: hasil capture menyusul dari loop (calibTakeResult)
+static SavedReqId calReqId = {};
+
+static void sendCalResult(const CalResult &res) {
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "cal";
+  root["evt"] = res.ok ? "point" : "point_err";
+  root["ch"] = calibChStr(res.ch);
+  root["idx"] = res.idx;
+  root["ref"] = res.refV;
+  setFloatOrNull(root, "adc_v", res.adcV);
+  root["spread"] = res.spread;
+  if (!res.ok) root["err"] = res.err;
+  tagSavedReqId(calReqId, root);
+  sendTelemetry(root);
+}
+
+// Kalibrasi voltmeter (calib.h), satu perintah dengan "op":
+//   {"cal":{"ch":"smps","ref":48.0}}         capture titik (op default "point")
+//   {"cal":{"ch":"smps","op":"commit"}}      hitung gain/offset, simpan NVS
+//   {"cal":{"ch":"smps","op":"abort|reset"}} buang sesi / kembali default
+//   {"cal":{"op":"info"}}                    koefisien semua channel
+static void handleCmdCal(JsonVariant v) {
+  if (!v.is<JsonObject>()) { sendAckErr("cal", "invalid"); return; }
+  JsonObject o = v.as<JsonObject>();
+  const char *op = o["op"] | "point";
+
+  if (strcmp(op, "info") == 0) {
+    JsonDocument doc;
+    JsonObject root = doc.to<JsonObject>();
+    root["type"] = "cal";
+    root["evt"] = "info";
+    for (size_t i = 0; i < static_cast<size_t>(CalCh::Count); ++i) {
+      const CalCh ch = static_cast<CalCh>(i);
+      writeCalChannel(root[calibChStr(ch)].to<JsonObject>(), ch);
+    }
+    tagReqId(root);
+    sendTelemetry(root);
+    return;
+  }
+
+  CalCh ch;
+  if (!calibChParse(o["ch"] | "", ch)) { sendAckErr("cal", "ch_invalid"); return; }
+
+  const char *err = nullptr;
+  if (strcmp(op, "point") == 0) {
+    if (!o["ref"].is<float>()) { sendAckErr("cal", "ref_invalid"); return; }
+    if (!calibStart(ch, o["ref"].as<float>(), err)) { sendCalEvent("point_err", ch, err); return; }
+    reqIdSave(calReqId);
+    sendCalEvent("capturing", ch);
+  } else if (strcmp(op, "commit") == 0) {
+    if (!calibCommit(ch, err)) { sendCalEvent("commit_err", ch, err); return; }
+    sendCalEvent("commit_ok", ch);
+    forceTel = true;
+  } else if (strcmp(op, "abort") == 0) {
+    calibAbort(ch);
+    sendCalEvent("abort_ok", ch);
+  } else if (strcmp(op, "reset") == 0) {
+    calibReset(ch);
+    sendCalEvent("reset_ok", ch);
+    forceTel = true;
+  } else {
+    sendAckErr("cal", "op_invalid");
+  }
+}
+
 static void handleCmdOtaAbort(JsonVariant v) {
   bool doAbort = v.is<bool>() ? v.as<bool>() : true;
   if (!doAbort) { sendOtaEvent("abort_ok"); return; }
@@ -728,6 +1607,276 @@ static void handleCmdOtaAbort(JsonVariant v) {
   forceTel = true;
 }
 
+// Pilih stream telemetri & rate per sesi (port asal perintah):
+//   {"subscribe":{"vu":30,"link":{"hz":2},"power":1,"fmt":"hex"}}
+// Stream yang tidak disebut dimatikan; "default" mengembalikan rate bawaan.
+static void handleCmdSubscribe(JsonVariant v) {
+  TelSession &sess = telSess[static_cast<size_t>(curRxPort == &rxUsb ? TelPort::Usb : TelPort::Link)];
+  if (v.is<const char*>()) {
+    if (!equalsIgnoreCase(v.as<const char*>(), "default")) {
+      sendAckErr("subscribe", "invalid"); return;
+    }
+    telSubResetDefaults(sess);
+  } else if (v.is<JsonObject>()) {
+    JsonObject o = v.as<JsonObject>();
+    uint32_t next[kTelStreamCount] = {};
+    for (size_t i = 0; i < kTelStreamCount; ++i) {
+      JsonVariant rate = o[kTelStreamNames[i]];
+      if (rate.isNull()) continue;
+      if (!telParseRate(rate, next[i])) { sendAckErr("subscribe", "invalid"); return; }
+    }
+    const char *fmt = o["fmt"] | "json";
+    bool hex;
+    if (equalsIgnoreCase(fmt, "json")) hex = false;
+    else if (equalsIgnoreCase(fmt, "hex")) hex = true;
+    else { sendAckErr("subscribe", "invalid_fmt"); return; }
+
+    const uint32_t now = ms();
+    for (size_t i = 0; i < kTelStreamCount; ++i) {
+      sess.subs[i].intervalMs = next[i];
+      sess.subs[i].lastMs = now - next[i];  // kirim segera di tick berikutnya
+    }
+    sess.bandsHex = hex;
+  } else {
+    sendAckErr("subscribe", "invalid"); return;
+  }
+
+  JsonDocument sub;
+  writeSubscription(sub.to<JsonObject>(), sess);
+  sendAckOk("subscribe", sub.as<JsonObject>());
+}
+
+// ---- Tabel perintah ----
+// Key "cmd" di-dispatch lewat perfect hash (FNV-1a + seed) yang dihitung
+// saat kompilasi. Tambah perintah cukup dengan menambah baris tabel.
+// Setter (parse+apply) bisa ikut batch; perintah khusus memakai handler.
+typedef void (*CmdHandler)(JsonVariant v);
+
+struct CmdEntry {
+  const char *key;
+  CmdHandler handler;  // perintah khusus (OTA, RTC, reset, ...) - tidak bisa di-batch
+  CmdParse parse;      // setter: validasi
+  CmdApply apply;      // setter: eksekusi + nilai ack
+  const char *arg;     // tipe argumen: bool | uint | number | string | object
+  const char *hint;    // nilai/rentang yang diterima (untuk "capabilities")
+};
+
+static void handleCmdCapabilities(JsonVariant v);
+
+static constexpr CmdEntry kCmdTable[] = {
+  {"power",         nullptr, parseBool,       applyPower,      "bool",   ""},
+  {"sleep_timer",   nullptr, parseSleepTimer, applySleepTimer, "uint",   "menit, 0=off"},
+  {"bt",            nullptr, parseBool,       applyBt,         "bool",   ""},
+  {"spk_sel",       nullptr, parseSpkSel,     applySpkSel,     "string", "big|small"},
+  {"spk_pwr",       nullptr, parseBool,       applySpkPwr,     "bool",   ""},
+  {"smps_bypass",   nullptr, parseBool,       applySmpsBypass, "bool",   ""},
+  {"smps_cut",      nullptr, parseSmpsCut,    applySmpsCut,    "number", "30..70, < smps_rec"},
+  {"smps_rec",      nullptr, parseSmpsRec,    applySmpsRec,    "number", "30..80, > smps_cut"},
+  {"bt_autooff",    nullptr, parseBtAutoOff,  applyBtAutoOff,  "number", "0..3600000 ms"},
+  {"fan_mode",      nullptr, parseFanMode,    applyFanMode,    "string", "auto|custom|failsafe"},
+  {"fan_duty",      nullptr, parseFanDuty,    applyFanDuty,    "number", "0..1023"},
+  {"rtc_set",       handleCmdRtcSet,       nullptr, nullptr, "string", "YYYY-MM-DDTHH:MM:SS"},
+  {"rtc_set_epoch", handleCmdRtcSetEpoch,  nullptr, nullptr, "uint",   "epoch UTC"},
+  {"ota_begin",     handleCmdOtaBegin,     nullptr, nullptr, "object", "{size,crc32,sha256,mode,comp,delta,sig}"},
+  {"ota_write",     handleCmdOtaWrite,     nullptr, nullptr, "object", "{seq,data_b64,crc32}"},
+  {"ota_end",       handleCmdOtaEnd,       nullptr, nullptr, "object", "{reboot}"},
+  {"ota_abort",     handleCmdOtaAbort,     nullptr, nullptr, "bool",   ""},
+  {"ota_resume",    handleCmdOtaResume,    nullptr, nullptr, "object", "{mode:json|bin}"},
+  {"img_hash",      handleCmdImgHash,      nullptr, nullptr, "object", "{slot:running|other|both|label,len:image|full|n}"},
+  {"img_read",      handleCmdImgRead,      nullptr, nullptr, "object", "{slot,offset,len<=1344}"},
+  {"cap_info",      handleCmdCapInfo,      nullptr, nullptr, "bool",   "true"},
+  {"cap_read",      handleCmdCapRead,      nullptr, nullptr, "object", "{offset,len<=1344}"},
+  {"cap_arm",       handleCmdCapArm,       nullptr, nullptr, "bool",   "true"},
+  {"cap_trigger",   handleCmdCapTrigger,   nullptr, nullptr, "bool",   "true"},
+  {"cal",           handleCmdCal,          nullptr, nullptr, "object", "{ch:smps|v12,op:point|commit|abort|reset|info,ref}"},
+  {"buzz",          handleCmdBuzz,         nullptr, nullptr, "object", "{f,d,ms}"},
+  {"nvs_reset",     handleCmdNvsReset,     nullptr, nullptr, "bool",   "true"},
+  {"factory_reset", handleCmdFactoryReset, nullptr, nullptr, "bool",   "true"},
+  {"subscribe",     handleCmdSubscribe,    nullptr, nullptr, "object", "{stream:hz,fmt}|default"},
+  {"capabilities",  handleCmdCapabilities, nullptr, nullptr, "bool",   "true"},
+};
+
+static constexpr size_t kCmdCount = sizeof(kCmdTable) / sizeof(kCmdTable[0]);
+static constexpr size_t kCmdSlots = 64;  // pangkat 2, >= 2x jumlah perintah
+static_assert(kCmdCount <= 32, "present-mask handleJsonDoc() hanya 32 bit");
+static_assert(kCmdSlots >= 2 * kCmdCount && (kCmdSlots & (kCmdSlots - 1)) == 0,
+              "kCmdSlots harus pangkat 2 dan >= 2x jumlah perintah");
+
+static constexpr uint32_t cmdHash(const char *s, size_t len, uint32_t seed) {
+  uint32_t h = 2166136261u ^ seed;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= (uint8_t)s[i];
+    h *= 16777619u;
+  }
+  // Finalizer: bit bawah FNV hanya bergantung pada bit bawah seed
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  return h;
+}
+
+static constexpr size_t cmdKeyLen(const char *s) {
+  size_t n = 0;
+  while (s[n]) ++n;
+  return n;
+}
+
+static constexpr bool cmdKeyEquals(const char *a, const char *b) {
+  while (*a && *a == *b) { ++a; ++b; }
+  return *a == *b;
+}
+
+static constexpr size_t cmdIndex(const char *key) {
+  for (size_t i = 0; i < kCmdCount; ++i) {
+    if (cmdKeyEquals(kCmdTable[i].key, key)) return i;
+  }
+  return kCmdCount;
+}
+
+static constexpr size_t kCmdIdxSmpsCut = cmdIndex("smps_cut");
+static constexpr size_t kCmdIdxSmpsRec = cmdIndex("smps_rec");
+static_assert(kCmdIdxSmpsCut < kCmdCount && kCmdIdxSmpsRec < kCmdCount, "smps_cut/smps_rec hilang dari tabel");
+
+static constexpr bool cmdSeedIsPerfect(uint32_t seed) {
+  bool used[kCmdSlots] = {};
+  for (size_t i = 0; i < kCmdCount; ++i) {
+    const char *key = kCmdTable[i].key;
+    const size_t slot = cmdHash(key, cmdKeyLen(key), seed) & (kCmdSlots - 1);
+    if (used[slot]) return false;
+    used[slot] = true;
+  }
+  return true;
+}
+
+static constexpr uint32_t cmdFindSeed() {
+  for (uint32_t seed = 0; seed < 4096; ++seed) {
+    if (cmdSeedIsPerfect(seed)) return seed;
+  }
+  return UINT32_MAX;
+}
+
+static constexpr uint32_t kCmdSeed = cmdFindSeed();
+static_assert(kCmdSeed != UINT32_MAX, "tidak ada seed perfect hash untuk tabel perintah");
+
+struct CmdSlotTable {
+  uint8_t idx[kCmdSlots];
+};
+
+static constexpr CmdSlotTable cmdBuildSlots() {
+  CmdSlotTable t = {};
+  for (size_t i = 0; i < kCmdSlots; ++i) t.idx[i] = 0xFF;
+  for (size_t i = 0; i < kCmdCount; ++i) {
+    const char *key = kCmdTable[i].key;
+    t.idx[cmdHash(key, cmdKeyLen(key), kCmdSeed) & (kCmdSlots - 1)] = (uint8_t)i;
+  }
+  return t;
+}
+
+static constexpr CmdSlotTable kCmdSlotTable = cmdBuildSlots();
+
+static int cmdLookup(const char *key, size_t len) {
+  if (!key) return -1;
+  const uint8_t idx = kCmdSlotTable.idx[cmdHash(key, len, kCmdSeed) & (kCmdSlots - 1)];
+  if (idx == 0xFF) return -1;
+  const char *name = kCmdTable[idx].key;
+  if (strncmp(name, key, len) != 0 || name[len] != '\0') return -1;
+  return idx;
+}
+
+static void handleCmdCapabilities(JsonVariant v) {
+  if (v.is<bool>() && !v.as<bool>()) return;
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "capabilities";
+  root["fw_ver"] = FW_VERSION;
+  JsonArray types = root["types"].to<JsonArray>();
+  types.add("cmd");
+  types.add("analyzer");
+  JsonArray cmds = root["cmds"].to<JsonArray>();
+  for (const CmdEntry &e : kCmdTable) {
+    JsonObject c = cmds.add<JsonObject>();
+    c["key"] = e.key;
+    c["arg"] = e.arg;
+    if (e.hint[0] != '\0') c["hint"] = e.hint;
+    c["batch"] = (e.parse != nullptr);
+  }
+  tagReqId(root);
+  sendTelemetry(root);
+}
+
+static void runCmdSingle(const CmdEntry &e, JsonVariant v) {
+  if (e.handler) { e.handler(v); return; }
+
+  valSmpsCutV = stateSmpsCutoffV();
+  valSmpsRecV = stateSmpsRecoveryV();
+  CmdArg arg = {};
+  const char *err = "invalid";
+  if (!e.parse(v, arg, err)) { sendAckErr(e.key, err); return; }
+
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "ack";
+  root["ok"] = true;
+  root["changed"] = e.key;
+  e.apply(arg, root["value"].to<JsonVariant>());
+  tagReqId(root);
+  sendTelemetry(root);
+  playAckTone();
+  forceTel = true;
+}
+
+// Batch ({"type":"cmd","batch":true,"cmd":{...}}): semua key divalidasi
+// dulu; hanya bila semuanya valid baru diterapkan. Hasilnya satu commit
+// NVS, satu ack gabungan, satu klik, dan satu frame telemetri.
+static void runCmdBatch(uint32_t present, JsonVariant *values) {
+  valSmpsCutV = stateSmpsCutoffV();
+  valSmpsRecV = stateSmpsRecoveryV();
+  if ((present & (1u << kCmdIdxSmpsCut)) && variantIsNumber(values[kCmdIdxSmpsCut])) {
+    valSmpsCutV = values[kCmdIdxSmpsCut].as<float>();
+  }
+  if ((present & (1u << kCmdIdxSmpsRec)) && variantIsNumber(values[kCmdIdxSmpsRec])) {
+    valSmpsRecV = values[kCmdIdxSmpsRec].as<float>();
+  }
+
+  CmdArg args[kCmdCount] = {};
+  const char *errs[kCmdCount] = {};
+  bool allValid = true;
+  for (size_t i = 0; i < kCmdCount; ++i) {
+    if (!(present & (1u << i))) continue;
+    const CmdEntry &e = kCmdTable[i];
+    if (!e.parse) { errs[i] = "not_batchable"; allValid = false; continue; }
+    const char *err = "invalid";
+    if (!e.parse(values[i], args[i], err)) { errs[i] = err; allValid = false; }
+  }
+
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "ack";
+  root["batch"] = true;
+  root["applied"] = allValid;
+  JsonObject results = root["results"].to<JsonObject>();
+
+  bool committed = true;
+  if (allValid) stateBatchBegin();
+  for (size_t i = 0; i < kCmdCount; ++i) {
+    if (!(present & (1u << i))) continue;
+    JsonObject r = results[kCmdTable[i].key].to<JsonObject>();
+    r["ok"] = (errs[i] == nullptr);
+    if (errs[i]) r["error"] = errs[i];
+    else if (allValid) kCmdTable[i].apply(args[i], r["value"].to<JsonVariant>());
+  }
+  if (allValid) committed = stateBatchCommit();
+
+  root["ok"] = allValid && committed;
+  if (allValid && !committed) root["error"] = "nvs_commit";
+  tagReqId(root);
+  sendTelemetry(root);
+  if (allValid) {
+    playAckTone();
+    forceTel = true;
+  }
+}
+
 static void handleAnalyzerJson(JsonObject obj) {
   const char *cmd = obj["cmd"] | "get";
   if (strcmp(cmd, "set") == 0) {
@@ -745,48 +1894,219 @@ static void handleAnalyzerJson(JsonObject obj) {
   }
 }
 
-static void handleJsonLine(const String &line) {
-  JsonDocument doc;
-  DeserializationError err = deserializeJson(doc, line);
-  if (err) return;
+static void handleJsonDoc(JsonObject root);
 
-  const char *type = doc["type"] | "";
+static void handleJsonLine(const char *line, size_t len) {
+  rxArena.reset();
+  JsonDocument doc(&rxArena);
+  DeserializationError err = deserializeJson(doc, line, len);
+  if (err) {
+    if (err == DeserializationError::NoMemory) sendDebugLog("[COMMS] command too large for arena");
+    return;
+  }
+
+  if (curRxPort == &rxLink) linkFrameMs = millis() | 1;
+
+  JsonVariantConst id = doc["id"];
+  curReqId = reqIdValid(id) ? id : JsonVariantConst();
+  handleJsonDoc(doc.as<JsonObject>());
+  curReqId = JsonVariantConst();  // doc (dan arena) tidak valid lagi setelah ini
+}
+
+static void handleJsonDoc(JsonObject root) {
+  const char *type = root["type"] | "";
   if (strcmp(type, "analyzer") == 0) {
-    JsonObject root = doc.as<JsonObject>();
     handleAnalyzerJson(root);
     return;
   }
   if (strcmp(type, "cmd") != 0 && strcmp(type, "command") != 0) return;
 
-  JsonObject root = doc.as<JsonObject>();
   JsonObject cmd = root["cmd"];
   if (cmd.isNull()) return;
 
   // Bunyikan buzzer dipindahkan ke fungsi sendAckOk untuk menghindari spam saat OTA/Telemetry
 
-  HANDLE_IF_PRESENT("power", handleCmdPower);
-  HANDLE_IF_PRESENT("sleep_timer", handleCmdSleepTimer);
-  HANDLE_IF_PRESENT("bt", handleCmdBt);
-  HANDLE_IF_PRESENT("spk_sel", handleCmdSpkSel);
-  HANDLE_IF_PRESENT("spk_pwr", handleCmdSpkPwr);
-  HANDLE_IF_PRESENT("smps_bypass", handleCmdSmpsBypass);
-  HANDLE_IF_PRESENT("smps_cut", handleCmdSmpsCut);
-  HANDLE_IF_PRESENT("smps_rec", handleCmdSmpsRec);
-  HANDLE_IF_PRESENT("bt_autooff", handleCmdBtAutoOff);
-  HANDLE_IF_PRESENT("fan_mode", handleCmdFanMode);
-  HANDLE_IF_PRESENT("fan_duty", handleCmdFanDuty);
-  HANDLE_IF_PRESENT("rtc_set", handleCmdRtcSet);
-  HANDLE_IF_PRESENT("rtc_set_epoch", handleCmdRtcSetEpoch);
-  HANDLE_IF_PRESENT("ota_begin", handleCmdOtaBegin);
-  HANDLE_IF_PRESENT("ota_write", handleCmdOtaWrite);
-  HANDLE_IF_PRESENT("ota_end", handleCmdOtaEnd);
-  HANDLE_IF_PRESENT("ota_abort", handleCmdOtaAbort);
-  HANDLE_IF_PRESENT("buzz", handleCmdBuzz);
-  HANDLE_IF_PRESENT("nvs_reset", handleCmdNvsReset);
-  HANDLE_IF_PRESENT("factory_reset", handleCmdFactoryReset);
-}
-
-#undef HANDLE_IF_PRESENT
+  // Satu lintasan atas key yang ada, lalu jalankan sesuai urutan tabel
+  uint32_t present = 0;
+  JsonVariant values[kCmdCount];
+  for (JsonPair kv : cmd) {
+    JsonString key = kv.key();
+    const int idx = cmdLookup(key.c_str(), key.size());
+    // Nilai null diabaikan (perilaku lama): jangan jalankan setter dengan default
+    if (idx < 0 || kv.value().isNull()) continue;
+    present |= 1u << idx;
+    values[idx] = kv.value();
+  }
+  if (root["batch"] | false) {
+    runCmdBatch(present, values);
+    return;
+  }
+  for (size_t i = 0; present != 0; ++i, present >>= 1) {
+    if (present & 1u) runCmdSingle(kCmdTable[i], values[i]);
+  }
+}
+
+// ---- OTA biner ----
+static JsonObject otaBinEventRoot(JsonDocument &doc, const char *evt) {
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "ota";
+  root["evt"] = evt;
+  root["next"] = (uint16_t)otaSeqNext();
+  root["bytes"] = (uint32_t)otaReceivedBytes();
+  tagSavedReqId(otaReqId, root);
+  return root;
+}
+
+static void otaBinAck() {
+  otaBin.sinceAck = 0;
+  JsonDocument doc;
+  JsonObject root = otaBinEventRoot(doc, "bin_ack");
+  root["sack"] = otaSeqBufferedMask();  // bit i = next+1+i sudah diterima
+  sendTelemetry(root);
+}
+
+// NAK selektif: hanya seq hilang yang belum pernah dilaporkan (kecuali
+// force, mis. CRC rusak yang seq-nya tak diketahui).
+static void otaBinNak(const char *why, bool force) {
+  uint32_t missing[OTA_WINDOW];
+  const size_t n = otaSeqMissing(missing, OTA_WINDOW);
+  JsonDocument doc;
+  JsonObject root = otaBinEventRoot(doc, "bin_nak");
+  root["err"] = why;
+  JsonArray arr = root["missing"].to<JsonArray>();
+  for (size_t i = 0; i < n; ++i) {
+    if (!force && (int32_t)(missing[i] - otaBin.nakFloor) < 0) continue;
+    arr.add((uint16_t)missing[i]);
+    otaBin.nakFloor = missing[i] + 1;
+  }
+  if (arr.size() == 0) return;
+  sendTelemetry(root);
+}
+
+// Kembali ke mode baris JSON di port tersebut
+static void otaBinExit(const char *reason) {
+  if (!otaBin.port) return;
+  JsonDocument doc;
+  JsonObject root = otaBinEventRoot(doc, "bin_exit");
+  root["reason"] = reason;
+  sendTelemetry(root);
+  otaBin.port = nullptr;
+}
+
+static void otaBinHandleFrame(const OtaFrame &f) {
+  if (f.type == OtaFrameType::Ctrl) {
+    handleJsonLine(reinterpret_cast<const char *>(f.payload), f.len);
+    if (otaStatus() != OtaStatus::InProgress) otaBinExit("ctrl");
+    return;
+  }
+
+  otaBin.crcNakSent = false;
+  switch (otaSeqAccept(otaSeqExpand16(f.seq), f.payload, f.len)) {
+    case OtaChunkResult::Written:
+      break;
+    case OtaChunkResult::Buffered:
+      otaBinNak("gap", false);
+      return;
+    case OtaChunkResult::Duplicate:
+      otaBinAck();  // ack hilang: tegaskan posisi terakhir
+      return;
+    case OtaChunkResult::OutOfWindow:
+      otaBinNak("window", true);
+      return;
+    case OtaChunkResult::WriteError:
+      sendOtaError(otaLastError());
+      otaBinExit("error");
+      return;
+  }
+  if ((int32_t)(otaBin.nakFloor - otaSeqNext()) < 0) otaBin.nakFloor = otaSeqNext();
+  otaBin.sinceAck++;
+
+  const bool complete = otaReceivedBytes() >= otaStreamSize();
+  if (complete || otaBin.sinceAck >= OTA_BIN_ACK_EVERY) otaBinAck();
+  if (complete) otaBinExit("complete");  // host lanjut dengan ota_end JSON
+}
+
+// Konsumsi frame dari buffer port; berhenti bila keluar mode biner.
+static size_t otaBinConsume(RxPort &p) {
+  const uint8_t *buf = reinterpret_cast<const uint8_t *>(p.buf);
+  size_t pos = 0;
+  while (otaBin.port == &p && pos < p.len) {
+    OtaFrame f;
+    size_t used = 0;
+    const OtaFrameStatus st = otaFrameDecode(buf + pos, p.len - pos, OTA_BIN_FRAME_MAX, f, used);
+    if (st == OtaFrameStatus::NeedMore) break;
+    pos += used;
+    if (st == OtaFrameStatus::BadCrc && !otaBin.crcNakSent) {
+      otaBin.crcNakSent = true;
+      otaBinNak("crc", true);
+    }
+    else if (st == OtaFrameStatus::Frame) otaBinHandleFrame(f);
+  }
+  return pos;
+}
+
+// Akhir baris: '\n', '\r' (terminal/panel CR-only), atau CRLF
+static char *findLineEnd(char *buf, size_t n) {
+  char *nl = static_cast<char *>(memchr(buf, '\n', n));
+  char *cr = static_cast<char *>(memchr(buf, '\r', nl ? (size_t)(nl - buf) : n));
+  return cr ? cr : nl;
+}
+
+static void rxServicePort(RxPort &p) {
+  uint8_t handled = 0;
+  for (;;) {
+    // Baca bulk sebanyak yang tersedia & muat di buffer
+    bool gotBytes = false;
+    const int avail = p.io->available();
+    if (avail > 0 && p.len < sizeof(p.buf)) {
+      size_t room = sizeof(p.buf) - p.len;
+      size_t want = ((size_t)avail < room) ? (size_t)avail : room;
+      size_t got = p.io->readBytes(p.buf + p.len, want);
+      if (got > 0) {
+        p.len += got;
+        gotBytes = true;
+        ledRxPulse();
+        if (otaBin.port == &p) otaBin.lastMs = millis();
+      }
+    }
+
+    curRxPort = &p;
+    size_t start = 0;
+    if (otaBin.port == &p) start = otaBinConsume(p);
+
+    // Proses semua baris lengkap di buffer (mode JSON)
+    while (otaBin.port != &p && handled < COMMS_RX_MAX_LINES_TICK) {
+      char *eol = findLineEnd(p.buf + start, p.len - start);
+      if (!eol) break;
+      size_t lineLen = (size_t)(eol - (p.buf + start));
+      const char *line = p.buf + start;
+      start += lineLen + 1;
+      // CRLF: '\n' setelah '\r' ikut ditelan (bila belum tiba → baris kosong)
+      if (*eol == '\r' && start < p.len && p.buf[start] == '\n') ++start;
+      if (p.discarding) { p.discarding = false; continue; }
+      while (lineLen > 0 && line[lineLen - 1] == ' ') --lineLen;
+      while (lineLen > 0 && *line == ' ') { ++line; --lineLen; }
+      if (lineLen == 0) continue;
+      handleJsonLine(line, lineLen);
+      ++handled;
+    }
+
+    curRxPort = nullptr;
+
+    if (start > 0) {
+      memmove(p.buf, p.buf + start, p.len - start);
+      p.len -= start;
+    }
+    if (p.len == sizeof(p.buf) && otaBin.port != &p) {
+      // Tidak ada newline dalam satu buffer penuh: buang baris ini
+      p.len = 0;
+      p.discarding = true;
+      sendDebugLog("[COMMS] rx line overflow, dropped");
+    }
+
+    if (handled >= COMMS_RX_MAX_LINES_TICK || !gotBytes) break;
+  }
+}
 
 void commsInit() {
   pinMode(LED_UART_PIN, OUTPUT);
@@ -794,20 +2114,22 @@ void commsInit() {
 
   // USB CDC (debugSerial)
   // =====================
-  debugSerial.setRxBufferSize(2048);
+  debugSerial.setRxBufferSize(COMMS_UART_RX_BUF);
   debugSerial.setTxBufferSize(2048);
   debugSerial.begin(SERIAL_BAUD_USB);
   debugSerial.println("[DEBUG] USB Serial initialized (921600 baud, 2KB buffer)");
 
   // UART2 ke panel (linkSerial)
   // ===========================
-  linkSerial.setRxBufferSize(2048);
+  linkSerial.setRxBufferSize(COMMS_UART_RX_BUF);
   linkSerial.setTxBufferSize(2048);
   linkSerial.begin(SERIAL_BAUD_LINK, SERIAL_8N1, UART2_RX_PIN, UART2_TX_PIN);
 
-  rxLine.reserve(4096);
-  lastRtMs = 0;
-  lastHz1Ms = 0;
+  rxLink.len = 0;
+  rxLink.discarding = false;
+  rxUsb.len = 0;
+  rxUsb.discarding = false;
+  for (auto &sess : telSess) telSubResetDefaults(sess);
   otaReady = true;
   forceTel = true;
 
@@ -822,64 +2144,74 @@ void commsTick(uint32_t now, bool sqwTick) {
   ledActivityTick(now);
 
   // Read commands from UART2 (Panel) - primary source
-  while (linkSerial.available()) {
-    int c = linkSerial.read();
-    if (c < 0) break;
-    ledRxPulse();
-
-    if (c == '\n' || c == '\r') {
-      if (rxLine.length() > 0) {
-        handleJsonLine(rxLine);
-        rxLine = "";
-      }
-    } else {
-      if (rxLine.length() < 4000) rxLine += (char)c;
-      else rxLine = "";
-    }
-  }
-  
+  rxServicePort(rxLink);
+
   // Also read from USB Serial (for testing/debugging)
-  while (debugSerial.available()) {
-    int c = debugSerial.read();
-    if (c < 0) break;
-    ledRxPulse();
-
-    if (c == '\n' || c == '\r') {
-      if (rxLine.length() > 0) {
-        handleJsonLine(rxLine);
-        rxLine = "";
-      }
-    } else {
-      if (rxLine.length() < 4000) rxLine += (char)c;
-      else rxLine = "";
-    }
+  rxServicePort(rxUsb);
+
+  // Hasil hash audit dari auditTick()
+  AuditResult auditRes;
+  while (auditTakeResult(auditRes)) sendImgHashResult(auditRes);
+
+  // Capture baru beku (trip proteksi) → beri tahu panel sekali
+  static CaptureState lastCapState = CaptureState::Armed;
+  const CaptureState capState = captureState();
+  if (capState != lastCapState) {
+    if (capState == CaptureState::Frozen) sendCapInfo("frozen");
+    lastCapState = capState;
   }
 
-  // Send realtime telemetry (if system ON)
-  if (TELEM_REALTIME_ENABLE && powerIsOn()) {
-    uint32_t intervalRt = (TELEM_HZ_REALTIME > 0) ? (1000UL / TELEM_HZ_REALTIME) : 0;
-    if (intervalRt == 0 || now - lastRtMs >= intervalRt) {
-      sendRealtimeTelemetry(now);
-      lastRtMs = now;
-    }
-  }
+  // Capture titik kalibrasi selesai (atau timeout) di task akuisisi
+  CalResult calRes;
+  if (calibTakeResult(now, calRes)) sendCalResult(calRes);
 
-  // Send slow telemetry
-  bool shouldSendSlow = forceTel;
-  uint32_t slowInterval = (TELEM_SLOW_HZ > 0) ? (1000UL / TELEM_SLOW_HZ) : 0;
-  if (!shouldSendSlow) {
-    if (sqwTick) shouldSendSlow = true;
-    else if (slowInterval == 0 || now - lastHz1Ms >= slowInterval) shouldSendSlow = true;
+  // Sesi biner berakhir bila OTA selesai/batal dari port lain, atau host diam
+  if (otaBin.port) {
+    if (otaStatus() != OtaStatus::InProgress) otaBinExit("ota_idle");
+    else if (now - otaBin.lastMs > OTA_BIN_IDLE_MS) otaBinExit("timeout");
   }
 
-  if (shouldSendSlow) {
-    sendSlowTelemetry(now);
-    lastHz1Ms = now;
-    forceTel = false;
+  // Hanya stream yang jatuh tempo yang dibangun & dikirim, per sesi port
+  uint8_t rtDue[kTelPortCount], slowDue[kTelPortCount];
+  for (size_t p = 0; p < kTelPortCount; ++p) {
+    TelSession &sess = telSess[p];
+    const uint8_t due = telDueMask(sess, now, sqwTick);
+    rtDue[p] = (TELEM_REALTIME_ENABLE && powerIsOn()) ? (due & kTelRtMask) : 0;
+    // forceTel = semua stream hz1 yang aktif
+    slowDue[p] = forceTel ? (telEnabledMask(sess) & kTelHz1Mask) : (due & kTelHz1Mask);
+    telMarkSent(sess, rtDue[p] | slowDue[p], now);
+  }
+  forceTel = false;
+
+  // Sesi dengan langganan identik berbagi satu frame (kasus umum: default)
+  const bool same = telSess[0].bandsHex == telSess[1].bandsHex &&
+                    telEnabledMask(telSess[0]) == telEnabledMask(telSess[1]);
+  const bool rtShared = same && rtDue[0] == rtDue[1];
+  const bool slowShared = same && slowDue[0] == slowDue[1];
+  for (size_t p = 0; p < kTelPortCount; ++p) {
+    telCtx = &telSess[p];
+    const uint8_t self = (uint8_t)(1u << p);
+    if (rtDue[p] && !(rtShared && p > 0)) {
+      sendRealtimeTelemetry(now, rtDue[p], rtShared ? kPortAll : self);
+    }
+    if (slowDue[p] && !(slowShared && p > 0)) {
+      sendSlowTelemetry(now, slowDue[p], slowShared ? kPortAll : self);
+    }
   }
+  telCtx = &telSess[0];
 }
 
 void commsForceTelemetry() { forceTel = true; }
+void commsSendFeatures() { sendFeaturesSnapshot(); }
+uint32_t commsLinkLastFrameMs() { return linkFrameMs; }
+
+void commsSendLinkProbe() {
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  root["type"] = "link";
+  root["evt"] = "probe";
+  sendTelemetryTo(kPortLink, root);
+}
 
 void commsSetOtaReady(bool ready) {
   if (otaReady != ready) {
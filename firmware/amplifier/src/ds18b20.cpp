@@ -0,0 +1,173 @@
+#include "ds18b20.h"
+
+#include <OneWire.h>
+
+static constexpr uint8_t kFamilyDs18b20 = 0x28;
+static constexpr uint8_t kCmdConvert = 0x44;
+static constexpr uint8_t kCmdReadScratch = 0xBE;
+static constexpr uint8_t kCmdWriteScratch = 0x4E;
+static constexpr uint8_t kScratchLen = 9;
+
+static OneWire ow(DS18B20_PIN);
+
+static uint8_t roms[DS18B20_MAX_SENSORS][8];
+static uint32_t errors[DS18B20_MAX_SENSORS];
+static bool seenFirst[DS18B20_MAX_SENSORS];   // pembacaan pertama sesudah konversi valid
+static uint8_t count = 0;
+
+enum class Phase : uint8_t {
+  Idle,
+  ConvReset,
+  ConvCmd,
+  Converting,
+  ReadReset,
+  ReadSelect,
+  ReadData,
+};
+
+static Phase phase = Phase::Idle;
+static uint32_t cycleMs = 0;
+static uint32_t convMs = 0;
+static bool cycleStarted = false;
+static uint8_t cur = 0;
+static uint8_t scratch[kScratchLen];
+static uint8_t got = 0;
+
+static uint32_t convTimeMs() {
+  return 750UL >> (12 - DS18B20_RESOLUTION);
+}
+
+uint8_t ds18b20Begin() {
+  static_assert(DS18B20_RESOLUTION >= 9 && DS18B20_RESOLUTION <= 12, "DS18B20_RESOLUTION 9..12");
+  // Cari ke buffer lokal dulu: pembaca ds18b20Rom() tidak melihat daftar setengah jadi
+  uint8_t found[DS18B20_MAX_SENSORS][8];
+  uint8_t n = 0;
+  uint8_t addr[8];
+  ow.reset_search();
+  while (n < DS18B20_MAX_SENSORS && ow.search(addr)) {
+    if (addr[0] != kFamilyDs18b20) continue;
+    if (OneWire::crc8(addr, 7) != addr[7]) continue;
+    memcpy(found[n++], addr, sizeof(addr));
+  }
+  count = 0;
+  memcpy(roms, found, sizeof(found[0]) * n);
+  for (uint8_t i = 0; i < n; ++i) {
+    errors[i] = 0;
+    seenFirst[i] = false;
+  }
+  count = n;
+
+  if (count > 0 && ow.reset()) {
+    // Resolusi untuk semua sensor sekaligus (TH/TL tidak dipakai)
+    ow.skip();
+    ow.write(kCmdWriteScratch);
+    ow.write(0x4B);
+    ow.write(0x46);
+    ow.write(static_cast<uint8_t>(((DS18B20_RESOLUTION - 9) << 5) | 0x1F));
+  }
+
+  phase = Phase::Idle;
+  cycleStarted = false;
+  return count;
+}
+
+uint8_t ds18b20Count() { return count; }
+
+const uint8_t* ds18b20Rom(uint8_t idx) {
+  return idx < count ? roms[idx] : nullptr;
+}
+
+uint32_t ds18b20Errors(uint8_t idx) {
+  return idx < count ? errors[idx] : 0;
+}
+
+static void finishSensor(Ds18b20Reading &out, bool ok, float tempC) {
+  out.idx = cur;
+  out.ok = ok;
+  out.tempC = ok ? tempC : NAN;
+  out.last = (cur + 1 >= count);
+  if (!ok) ++errors[cur];
+  ++cur;
+  phase = out.last ? Phase::Idle : Phase::ReadReset;
+}
+
+bool ds18b20Poll(uint32_t nowMs, Ds18b20Reading &out) {
+  if (count == 0) return false;
+
+  switch (phase) {
+    case Phase::Idle:
+      if (!cycleStarted || nowMs - cycleMs >= DS18B20_PERIOD_MS) {
+        cycleStarted = true;
+        cycleMs = nowMs;
+        phase = Phase::ConvReset;
+      }
+      return false;
+
+    case Phase::ConvReset:
+      // Tanpa presence: seluruh siklus gagal, sensor dilaporkan satu per satu
+      if (!ow.reset()) {
+        cur = 0;
+        phase = Phase::ReadReset;
+        return false;
+      }
+      phase = Phase::ConvCmd;
+      return false;
+
+    case Phase::ConvCmd:
+      ow.skip();
+      ow.write(kCmdConvert);
+      convMs = nowMs;
+      phase = Phase::Converting;
+      return false;
+
+    case Phase::Converting:
+      if (nowMs - convMs < convTimeMs()) return false;
+      cur = 0;
+      phase = Phase::ReadReset;
+      return false;
+
+    case Phase::ReadReset:
+      if (!ow.reset()) {
+        finishSensor(out, false, NAN);
+        return true;
+      }
+      phase = Phase::ReadSelect;
+      return false;
+
+    case Phase::ReadSelect:
+      ow.select(roms[cur]);
+      ow.write(kCmdReadScratch);
+      got = 0;
+      phase = Phase::ReadData;
+      return false;
+
+    case Phase::ReadData: {
+      const uint8_t left = kScratchLen - got;
+      const uint8_t n = left < DS18B20_SLICE_BYTES ? left : DS18B20_SLICE_BYTES;
+      ow.read_bytes(scratch + got, n);
+      got += n;
+      if (got < kScratchLen) return false;
+
+      // Bus kosong terbaca 0xFF semua → CRC kebetulan bisa lolos, tolak eksplisit
+      bool allOnes = true;
+      for (uint8_t i = 0; i < kScratchLen; ++i) allOnes &= (scratch[i] == 0xFF);
+      if (allOnes || OneWire::crc8(scratch, 8) != scratch[8]) {
+        finishSensor(out, false, NAN);
+        return true;
+      }
+
+      const int16_t raw = static_cast<int16_t>((scratch[1] << 8) | scratch[0]);
+      const float t = raw / 16.0f;
+      // 85 °C tepat pada pembacaan pertama = nilai power-on, bukan hasil konversi
+      if (!seenFirst[cur] && raw == 0x0550) {
+        seenFirst[cur] = true;
+        finishSensor(out, false, NAN);
+        return true;
+      }
+      seenFirst[cur] = true;
+      finishSensor(out, true, t);
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,125 @@
+#include "filters.h"
+
+static uint8_t clampTaps(uint8_t n) {
+  if (n < 1) return 1;
+  return n > kFilterMaxTaps ? kFilterMaxTaps : n;
+}
+
+// ---------------- Median ----------------
+void MedianFilter::configure(uint8_t n) {
+  n = clampTaps(n);
+  if ((n & 1) == 0) --n;   // median genap tidak punya nilai tengah tunggal
+  n_ = n;
+  reset();
+}
+
+void MedianFilter::reset() {
+  idx_ = 0;
+  count_ = 0;
+}
+
+float MedianFilter::push(float x) {
+  if (n_ <= 1) return x;
+  buf_[idx_] = x;
+  idx_ = (idx_ + 1) % n_;
+  if (count_ < n_) ++count_;
+
+  // Insertion sort salinan kecil (≤ kFilterMaxTaps)
+  float s[kFilterMaxTaps];
+  for (uint8_t i = 0; i < count_; ++i) {
+    float v = buf_[i];
+    int8_t j = static_cast<int8_t>(i) - 1;
+    while (j >= 0 && s[j] > v) {
+      s[j + 1] = s[j];
+      --j;
+    }
+    s[j + 1] = v;
+  }
+  return s[count_ / 2];
+}
+
+// ---------------- Moving average ----------------
+void MovingAverage::configure(uint8_t n) {
+  n_ = clampTaps(n);
+  reset();
+}
+
+void MovingAverage::reset() {
+  idx_ = 0;
+  count_ = 0;
+}
+
+float MovingAverage::push(float x) {
+  if (n_ <= 1) return x;
+  buf_[idx_] = x;
+  idx_ = (idx_ + 1) % n_;
+  if (count_ < n_) ++count_;
+  // Jumlah ulang tiap sampel (maks. 15 elemen) → tanpa drift running sum
+  float sum = 0.0f;
+  for (uint8_t i = 0; i < count_; ++i) sum += buf_[i];
+  return sum / count_;
+}
+
+// ---------------- IIR satu kutub ----------------
+void OnePoleIir::configure(float alpha) {
+  if (!(alpha > 0.0f)) alpha = 1.0f;   // 0/NaN → bypass, bukan filter beku
+  alpha_ = alpha > 1.0f ? 1.0f : alpha;
+  reset();
+}
+
+float OnePoleIir::push(float x) {
+  if (isnan(y_) || alpha_ >= 1.0f) y_ = x;
+  else y_ += alpha_ * (x - y_);
+  return y_;
+}
+
+// ---------------- Envelope min/max ----------------
+void MinMaxEnvelope::configure(uint16_t n) {
+  n_ = n;
+  reset();
+}
+
+void MinMaxEnvelope::reset() {
+  count_ = 0;
+  lo_ = hi_ = NAN;
+  valid_ = false;
+}
+
+bool MinMaxEnvelope::push(float x) {
+  if (n_ == 0) return false;
+  if (count_ == 0) {
+    curLo_ = curHi_ = x;
+  } else {
+    if (x < curLo_) curLo_ = x;
+    if (x > curHi_) curHi_ = x;
+  }
+  if (++count_ < n_) return false;
+  lo_ = curLo_;
+  hi_ = curHi_;
+  valid_ = true;
+  count_ = 0;
+  return true;
+}
+
+// ---------------- Rantai ----------------
+void FilterChain::configure(const FilterConfig& cfg) {
+  median_.configure(cfg.median);
+  avg_.configure(cfg.average);
+  iir_.configure(cfg.iirAlpha);
+  env_.configure(cfg.envelope);
+  out_ = NAN;
+}
+
+void FilterChain::reset() {
+  median_.reset();
+  avg_.reset();
+  iir_.reset();
+  env_.reset();
+  out_ = NAN;
+}
+
+float FilterChain::push(float x) {
+  env_.push(x);   // envelope atas sampel mentah: spike yang ditolak tetap terlihat
+  out_ = iir_.push(avg_.push(median_.push(x)));
+  return out_;
+}
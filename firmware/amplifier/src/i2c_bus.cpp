@@ -0,0 +1,154 @@
+#include "i2c_bus.h"
+
+#include <atomic>
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+static constexpr size_t kPrioCount = static_cast<size_t>(I2cPrio::Count);
+
+// Mutex FreeRTOS (priority inheritance) menjaga bus; antrean prioritas dibuat
+// dengan penghitung pemohon per kelas: pemohon hanya mencoba mengambil mutex
+// bila tidak ada kelas lebih tinggi yang menunggu.
+static SemaphoreHandle_t busMutex = nullptr;
+static std::atomic<uint8_t> waiting[kPrioCount];
+static std::atomic<uint32_t> timeouts{0};
+static std::atomic<uint32_t> recoveries{0};
+
+// Statistik di bawah ini hanya ditulis oleh pemegang mutex
+static uint32_t holdStartUs = 0;
+static uint32_t txCount = 0;
+static uint32_t holdMaxUs = 0;
+static uint32_t waitMaxUs[kPrioCount] = {};
+static uint32_t windowStartUs = 0;
+static uint32_t windowBusyUs = 0;
+static float utilPct = 0.0f;
+
+static bool higherWaiting(size_t p) {
+  for (size_t i = 0; i < p; ++i) {
+    if (waiting[i].load(std::memory_order_relaxed)) return true;
+  }
+  return false;
+}
+
+void i2cBusInit() {
+  if (busMutex) return;
+  for (auto& w : waiting) w.store(0);
+  busMutex = xSemaphoreCreateMutex();
+  windowStartUs = micros();
+}
+
+bool i2cBusAcquire(I2cPrio prio, uint32_t timeoutMs) {
+  if (!busMutex) return true;  // sebelum init: masih satu thread (setup)
+
+  const size_t p = static_cast<size_t>(prio);
+  const uint32_t t0 = micros();
+  const uint32_t limitUs = timeoutMs * 1000UL;
+  bool ok = false;
+
+  waiting[p].fetch_add(1, std::memory_order_relaxed);
+  for (;;) {
+    if (!higherWaiting(p) && xSemaphoreTake(busMutex, 1) == pdTRUE) {
+      ok = true;
+      break;
+    }
+    if (micros() - t0 >= limitUs) break;
+    if (higherWaiting(p)) vTaskDelay(1);
+  }
+  waiting[p].fetch_sub(1, std::memory_order_relaxed);
+
+  if (!ok) {
+    timeouts.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  holdStartUs = micros();
+  const uint32_t waited = holdStartUs - t0;
+  if (waited > waitMaxUs[p]) waitMaxUs[p] = waited;
+  return true;
+}
+
+void i2cBusRelease() {
+  if (!busMutex) return;
+
+  const uint32_t now = micros();
+  const uint32_t held = now - holdStartUs;
+  ++txCount;
+  if (held > holdMaxUs) holdMaxUs = held;
+  windowBusyUs += held;
+
+  const uint32_t span = now - windowStartUs;
+  if (span >= I2C_STATS_WINDOW_MS * 1000UL) {
+    utilPct = 100.0f * static_cast<float>(windowBusyUs) / static_cast<float>(span);
+    windowBusyUs = 0;
+    windowStartUs = now;
+  }
+
+  xSemaphoreGive(busMutex);
+}
+
+bool i2cBusCriticalPending() {
+  return waiting[static_cast<size_t>(I2cPrio::Critical)].load(std::memory_order_relaxed) != 0;
+}
+
+void i2cBusGetStats(I2cBusStats& out) {
+  // Snapshot tanpa lock: nilai 32-bit dibaca atomik, cukup untuk telemetri
+  out.utilPct = utilPct;
+  out.txCount = txCount;
+  out.timeouts = timeouts.load(std::memory_order_relaxed);
+  out.holdMaxUs = holdMaxUs;
+  out.recoveries = recoveries.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < kPrioCount; ++i) out.waitMaxUs[i] = waitMaxUs[i];
+}
+
+bool i2cBusProbe(uint8_t addr, I2cPrio prio, bool& lockOk) {
+  I2cBusLock lock(prio);
+  lockOk = lock.ok();
+  if (!lockOk) return false;
+  Wire.beginTransmission(addr);
+  return Wire.endTransmission() == 0;
+}
+
+bool i2cBusRecover() {
+  I2cBusLock lock(I2cPrio::Critical);
+  if (!lock.ok()) return false;
+  recoveries.fetch_add(1, std::memory_order_relaxed);
+
+  Wire.end();
+  pinMode(I2C_SDA, INPUT_PULLUP);
+  pinMode(I2C_SCL, OUTPUT_OPEN_DRAIN);
+  digitalWrite(I2C_SCL, HIGH);
+  delayMicroseconds(5);
+
+  // Slave di tengah byte baca melepas SDA setelah sisa bit + NACK (maks. 9 clock)
+  for (uint8_t i = 0; i < 9 && digitalRead(I2C_SDA) == LOW; ++i) {
+    digitalWrite(I2C_SCL, LOW);
+    delayMicroseconds(5);
+    digitalWrite(I2C_SCL, HIGH);
+    delayMicroseconds(5);
+  }
+
+  // STOP: SDA naik saat SCL high
+  pinMode(I2C_SDA, OUTPUT_OPEN_DRAIN);
+  digitalWrite(I2C_SDA, LOW);
+  delayMicroseconds(5);
+  digitalWrite(I2C_SCL, HIGH);
+  delayMicroseconds(5);
+  digitalWrite(I2C_SDA, HIGH);
+  delayMicroseconds(5);
+  pinMode(I2C_SDA, INPUT_PULLUP);
+  const bool sdaFree = digitalRead(I2C_SDA) == HIGH;
+
+  Wire.begin(I2C_SDA, I2C_SCL, I2C_CLOCK_HZ);
+  return sdaFree;
+}
+
+const char* i2cPrioStr(I2cPrio prio) {
+  switch (prio) {
+    case I2cPrio::Critical: return "critical";
+    case I2cPrio::Normal:   return "normal";
+    case I2cPrio::Display:  return "display";
+    default:                return "?";
+  }
+}
@@ -14,6 +14,9 @@ HardwareSerial espSerial(2);
 #include "buzzer.h"
 #include "ui.h"
 #include "ota.h"
+#include "audit.h"
+#include "i2c_bus.h"
+#include "thermal.h"
 
 #if LOG_ENABLE
   #define LOGF(...)  do { Serial.printf(__VA_ARGS__); } while (0)
@@ -94,6 +97,7 @@ void appPerformFactoryReset(const char* subtitle, const char* src) {
   playFactoryResetTone();
   stateFactoryReset();
   buzzerFactoryReset();
+  thermalFactoryReset();
 
   if (powerInitDone) {
     powerSetMainRelay(false, PowerChangeReason::FactoryReset);
@@ -121,7 +125,8 @@ void appInit() {
   LOGF("\n[%s] %s v%s\n", "BOOT", FW_NAME, FW_VERSION);
 #endif
 
-  Wire.begin(I2C_SDA, I2C_SCL);
+  Wire.begin(I2C_SDA, I2C_SCL, I2C_CLOCK_HZ);
+  i2cBusInit();
   ensureMainRelayOffRaw();
   ensureSpeakerPinsOffRaw();
 
@@ -236,14 +241,17 @@ void appTick() {
 
   const bool protectFault = powerSpkProtectFault();
   const bool smpsBypass = stateSmpsBypass();
-  const float voltage = getVoltageInstant();
+  const float voltage = getVoltageFiltered();
   const bool inSoftstart = powerSmpsSoftstartActive();
 
   if (powerOn) {
     const bool smpsNoPower = (!smpsBypass && voltage == 0.0f);
     const bool smpsLowVolt = (!smpsBypass && voltage > 0.0f && voltage < stateSmpsCutoffV());
     const bool smpsFault = (!inSoftstart) && (smpsNoPower || smpsLowVolt);
-    const bool warnNow = isnan(getHeatsinkC());
+    // ADC tidak terukur (NAN) bukan "tidak ada daya": peringatan, bukan SMPS PROTECT
+    const bool adcUnknown = (!smpsBypass && isnan(voltage));
+    // Sensor suhu hilang, ADC tidak sehat, atau model memprediksi OTP walau kipas penuh
+    const bool warnNow = isnan(getHeatsinkC()) || adcUnknown || thermalOtpPredicted();
 
     if (protectFault && !lastSpkFault) {
       uiShowError("SPEAKER PROTECT");
@@ -324,6 +332,7 @@ void appTick() {
 #if OTA_ENABLE
   otaTick(now);
 #endif
+  auditTick(now);
 
   uiSetInputStatus(powerBtMode(), powerGetSpeakerSelectBig());
   if (smpsValid && !uiIsErrorActive()) {
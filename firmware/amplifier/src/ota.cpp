@@ -2,43 +2,225 @@
 #include "config.h"
 #include "comms.h"
 #include "power.h"
+#include "sensors.h"
+#include "analyzer.h"
+#include "ota_decomp.h"
+#include "ota_delta.h"
+#include "ota_sig.h"
+#include "sha256_compat.h"
 
 #include <Update.h>
+#include <jacktor_crc.h>
 #include <esp_partition.h>
 #include <esp_ota_ops.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 
 static OtaStatus status = OtaStatus::Idle;
 static String errMsg;
 static size_t expectedSize = 0;
 static uint32_t expectedCrc = 0;
 static size_t written = 0;
+static size_t received = 0;    // byte stream (terkompresi bila comp aktif)
+static size_t streamSize = 0;
+static bool compressed = false;
+static bool delta = false;
+static bool shaCheck = false;
+static uint8_t shaExpected[32];
+static mbedtls_sha256_context shaCtx;
+static bool signedImage = false;
+static size_t imageLen = 0;    // byte ke flash (expectedSize tanpa trailer tanda tangan)
+static mbedtls_sha256_context sigCtx;
+static uint8_t sigTrailer[OTA_SIG_TRAILER_LEN];
+
 static uint32_t crcRunning = 0;
 static bool rebootPending = false;
 static uint32_t rebootAt = 0;
 
-static uint32_t crc32_update(uint32_t crc, const uint8_t *buf, size_t len) {
-  static uint32_t table[256];
-  static bool init = false;
-  if (!init) {
-    for (uint32_t i=0; i<256; ++i) {
-      uint32_t c = i;
-      for (int j=0; j<8; ++j) {
-        if (c & 1) c = 0xEDB88320UL ^ (c >> 1);
-        else c = c >> 1;
-      }
-      table[i] = c;
+static void resetStreamState();
+
+static inline void setError(const char* msg) {
+  errMsg = msg ? msg : "OTA error";
+}
+
+// ---- Staging sektor ----
+// Image dikumpulkan per OTA_SECTOR_BUF sehingga Update.write() selalu
+// menerima sektor utuh (sisa terakhir di-flush oleh otaEnd). `written`
+// bertambah saat data masuk staging; error flash dilaporkan paling lambat
+// pada writeImage() berikutnya atau otaEnd().
+static_assert(OTA_SECTOR_BUF > 0 && OTA_SECTOR_BUF <= 0xFFFF, "OTA_SECTOR_BUF");
+#if OTA_WRITER_TASK
+static constexpr uint8_t kSectorBufs = 2;  // satu diisi loop, satu ditulis task
+#else
+static constexpr uint8_t kSectorBufs = 1;
+#endif
+static uint8_t sectorBuf[kSectorBufs][OTA_SECTOR_BUF];
+static size_t sectorFill = 0;
+static uint8_t sectorCur = 0;
+
+#if OTA_WRITER_TASK
+struct SectorJob {
+  uint8_t idx;
+  uint16_t len;
+};
+static TaskHandle_t writerTask = nullptr;
+static QueueHandle_t writerQueue = nullptr;
+static SemaphoreHandle_t writerFree = nullptr;  // buffer bebas selain yang sedang diisi
+static volatile bool writerFailed = false;
+static const char* volatile writerErr = nullptr;
+
+static void writerLoop(void*) {
+  SectorJob job;
+  for (;;) {
+    if (xQueueReceive(writerQueue, &job, portMAX_DELAY) != pdTRUE) continue;
+    // Setelah gagal, sektor berikutnya dibuang; sesi akan dibatalkan
+    if (!writerFailed && Update.write(sectorBuf[job.idx], job.len) != job.len) {
+      writerErr = Update.errorString();
+      writerFailed = true;
     }
-    init = true;
+    xSemaphoreGive(writerFree);
+  }
+}
+
+static void writerInit() {
+  if (writerTask) return;
+  writerQueue = xQueueCreate(kSectorBufs, sizeof(SectorJob));
+  writerFree = xSemaphoreCreateCounting(kSectorBufs - 1, kSectorBufs - 1);
+  xTaskCreatePinnedToCore(writerLoop, "ota_wr", OTA_WRITER_STACK, nullptr,
+                          OTA_WRITER_PRIO, &writerTask, OTA_WRITER_CORE);
+}
+
+// Tunggu semua sektor dalam antrean selesai ditulis
+static bool writerDrain() {
+  const TickType_t wait = pdMS_TO_TICKS(OTA_WRITER_WAIT_MS);
+  uint8_t got = 0;
+  while (got < kSectorBufs - 1 && xSemaphoreTake(writerFree, wait) == pdTRUE) got++;
+  for (uint8_t i = 0; i < got; i++) xSemaphoreGive(writerFree);
+  return got == kSectorBufs - 1;
+}
+#endif
+
+static bool submitSector(size_t len) {
+#if OTA_WRITER_TASK
+  const SectorJob job = {sectorCur, (uint16_t)len};
+  xQueueSend(writerQueue, &job, portMAX_DELAY);  // kapasitas = jumlah buffer, tak pernah penuh
+  // Backpressure: tunggu sektor sebelumnya selesai sebelum mengisi buffer lain
+  if (xSemaphoreTake(writerFree, pdMS_TO_TICKS(OTA_WRITER_WAIT_MS)) != pdTRUE) {
+    setError("Flash writer stalled");
+    return false;
   }
-  crc = ~crc;
-  for (size_t i=0; i<len; ++i) {
-    crc = table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+  sectorCur = (sectorCur + 1) % kSectorBufs;
+#else
+  if (Update.write(sectorBuf[0], len) != len) {
+    setError(Update.errorString());
+    return false;
   }
-  return ~crc;
+#endif
+  sectorFill = 0;
+  return true;
 }
 
-static inline void setError(const char* msg) {
-  errMsg = msg ? msg : "OTA error";
+// Tulis sisa staging lalu pastikan semua sektor sudah di flash
+static bool flushSectors() {
+  if (sectorFill && !submitSector(sectorFill)) return false;
+#if OTA_WRITER_TASK
+  if (!writerDrain()) {
+    setError("Flash writer stalled");
+    return false;
+  }
+  if (writerFailed) {
+    setError(writerErr);
+    return false;
+  }
+#endif
+  return true;
+}
+
+// Buang staging (abort/begin baru); Update tidak boleh disentuh selama task menulis
+static void discardSectors() {
+  sectorFill = 0;
+#if OTA_WRITER_TASK
+  writerDrain();
+  writerFailed = false;
+  writerErr = nullptr;
+#endif
+}
+
+// ---- Health check boot (app rollback) ----
+// initArduino() memanggil verifyRollbackLater(); true = core tidak langsung
+// menandai image valid, keputusan diambil healthTick() setelah sistem berjalan.
+#if OTA_ROLLBACK_ENABLE
+extern "C" bool verifyRollbackLater() { return true; }
+#endif
+
+static OtaHealth health = OtaHealth::Disabled;
+static const char* invalidSlot = nullptr;
+static uint32_t lastProbeMs = 0;
+
+static void healthInit() {
+  health = OtaHealth::Disabled;
+  const esp_partition_t* invalid = esp_ota_get_last_invalid_partition();
+  invalidSlot = invalid ? invalid->label : nullptr;
+#if OTA_ROLLBACK_ENABLE
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  esp_ota_img_states_t st;
+  if (running && esp_ota_get_state_partition(running, &st) == ESP_OK) {
+    health = (st == ESP_OTA_IMG_PENDING_VERIFY) ? OtaHealth::Pending : OtaHealth::Valid;
+  }
+#endif
+}
+
+// Reset/watchdog sebelum image ditandai valid sudah ditangani bootloader
+// (slot PENDING_VERIFY yang boot ulang dianggap gagal), jadi di sini cukup
+// menunggu OTA_HEALTH_MIN_MS uptime bersama syarat lainnya.
+static void healthTick(uint32_t now) {
+  if (health != OtaHealth::Pending) return;
+  const bool sensorsOk = sensorsInitOk();
+  const bool i2sOk = analyzerI2sReady();
+  const bool linkOk = !OTA_HEALTH_REQUIRE_LINK || commsLinkLastFrameMs() != 0;
+
+  // Cek aktif: bridge tidak mengirim apa pun tanpa PC/panel, jadi amp yang
+  // memancing balasan (probe_ack). Tanpa ini relay headless selalu rollback.
+  if (!linkOk && (lastProbeMs == 0 || now - lastProbeMs >= OTA_HEALTH_PROBE_MS)) {
+    lastProbeMs = now | 1;
+    commsSendLinkProbe();
+  }
+
+  if (now >= OTA_HEALTH_MIN_MS && sensorsOk && i2sOk && linkOk) {
+    if (esp_ota_mark_app_valid_cancel_rollback() != ESP_OK) {
+      commsLog("error", "OTA health: mark valid failed");
+    }
+    health = OtaHealth::Passed;
+    commsLog("info", "OTA health ok, image marked valid");
+    commsSendFeatures();
+    return;
+  }
+
+  if (now >= OTA_HEALTH_TIMEOUT_MS) {
+    char msg[80];
+    snprintf(msg, sizeof(msg), "OTA health failed (sensors=%d i2s=%d link=%d), rollback",
+             sensorsOk, i2sOk, linkOk);
+    commsLog("error", msg);
+    delay(50);
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+    // Hanya kembali bila tidak ada slot lama yang valid: tetap jalan di image ini
+    commsLog("error", "OTA health: no rollback slot");
+    health = OtaHealth::Disabled;
+  }
+}
+
+OtaHealth otaHealth() { return health; }
+const char* otaLastInvalidSlot() { return invalidSlot; }
+
+const char* otaHealthStr() {
+  switch (health) {
+    case OtaHealth::Valid:   return "valid";
+    case OtaHealth::Pending: return "pending";
+    case OtaHealth::Passed:  return "passed";
+    default:                 return "disabled";
+  }
 }
 
 void otaInit() {
@@ -47,14 +229,20 @@ void otaInit() {
   expectedSize = 0;
   expectedCrc = 0;
   written = 0;
+  resetStreamState();
   crcRunning = 0;
   rebootPending = false;
   rebootAt = 0;
+#if OTA_WRITER_TASK
+  writerInit();
+#endif
+  healthInit();
   commsSetOtaReady(true);
   powerSetOtaActive(false);
 }
 
 void otaTick(uint32_t now) {
+  healthTick(now);
   if (rebootPending && now >= rebootAt) {
     rebootPending = false;
     delay(50);
@@ -64,24 +252,144 @@ void otaTick(uint32_t now) {
 
 OtaStatus otaStatus() { return status; }
 const char* otaLastError() { return errMsg.c_str(); }
+size_t otaWrittenBytes() { return written; }
+size_t otaExpectedSize() { return expectedSize; }
+size_t otaReceivedBytes() { return received; }
+size_t otaStreamSize() { return streamSize; }
+
+// Tulis image (sudah mentah) ke staging sektor + CRC berjalan
+static bool writeImage(const uint8_t* data, size_t len) {
+  if (len > expectedSize - written) {
+    setError("Image larger than size");
+    return false;
+  }
+#if OTA_WRITER_TASK
+  if (writerFailed) {
+    setError(writerErr);
+    return false;
+  }
+#endif
+  if (expectedCrc) {
+    crcRunning = jacktorCrc32(crcRunning, data, len);
+  }
+  if (shaCheck) SHA256_UPDATE(&shaCtx, data, len);
+
+  // Byte sesudah imageLen adalah trailer tanda tangan: disimpan, tidak di-flash
+  size_t toFlash = (written < imageLen) ? imageLen - written : 0;
+  if (toFlash > len) toFlash = len;
+  if (signedImage) {
+    SHA256_UPDATE(&sigCtx, data, toFlash);
+    if (len > toFlash) memcpy(sigTrailer + (written + toFlash - imageLen), data + toFlash, len - toFlash);
+  }
+  written += len;
+  len = toFlash;
+
+  while (len) {
+    size_t n = OTA_SECTOR_BUF - sectorFill;
+    if (n > len) n = len;
+    memcpy(&sectorBuf[sectorCur][sectorFill], data, n);
+    sectorFill += n;
+    data += n;
+    len -= n;
+    if (sectorFill == OTA_SECTOR_BUF && !submitSector(OTA_SECTOR_BUF)) return false;
+  }
+  return true;
+}
+
+static bool feedPatch(const uint8_t* data, size_t len) {
+  if (otaDeltaFeed(data, len)) return true;
+  setError(otaDeltaError());
+  return false;
+}
 
-bool otaBegin(size_t sz, uint32_t crc32) {
+// Keluaran tahap dekompresi (atau stream mentah) masuk ke sini
+static OtaDecompSink plainSink() { return delta ? feedPatch : writeImage; }
+
+static void resetStreamState() {
+  if (shaCheck) mbedtls_sha256_free(&shaCtx);
+  if (signedImage) mbedtls_sha256_free(&sigCtx);
+  signedImage = false;
+  received = 0;
+  streamSize = 0;
+  compressed = false;
+  delta = false;
+  shaCheck = false;
+}
+
+bool otaBegin(size_t sz, uint32_t crc32, const OtaBeginOptions* opt) {
   if (status == OtaStatus::InProgress) {
     setError("OTA already in progress");
     return false;
   }
+  // IDF menolak esp_ota_begin selama image berjalan belum dikonfirmasi
+  if (health == OtaHealth::Pending) {
+    setError("Boot not verified");
+    return false;
+  }
   if (sz == 0 || sz > OTA_MAX_BIN_SIZE) {
     setError("Invalid size");
     return false;
   }
 
+  const bool useComp = opt && opt->comp != OtaComp::None;
+  const bool useDelta = opt && opt->delta;
+  const bool useSig = opt && opt->sig;
+  // Decoder disiapkan sebelum Update.begin: parameter w/l salah atau ukuran
+  // terkompresi hilang ditolak tanpa membuka sesi
+  if (useComp && (opt->comp != OtaComp::Heatshrink || opt->streamSize == 0 ||
+                  !otaDecompBegin(opt->hsWindowBits, opt->hsLookaheadBits,
+                                  useDelta ? feedPatch : writeImage))) {
+    setError("Invalid compression");
+    return false;
+  }
+
+  if (OTA_SIGN_REQUIRED && !useSig) {
+    setError("Signature required");
+    return false;
+  }
+  if (useSig && !otaSigAvailable()) {
+    setError("No signing key");
+    return false;
+  }
+  if (useSig && sz <= OTA_SIG_TRAILER_LEN) {
+    setError("Invalid size");
+    return false;
+  }
+
   const esp_partition_t* next = esp_ota_get_next_update_partition(nullptr);
   if (!next) {
     setError("No OTA partition");
     return false;
   }
 
-  if (!Update.begin(sz, U_FLASH, 0, HIGH)) {
+  if (useDelta) {
+    // Tanpa hash image final, hasil patch tidak bisa dipercaya
+    if (!opt->hasSha256 || opt->streamSize == 0) {
+      setError("Delta needs sha256 & size");
+      return false;
+    }
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    if (!running || running == next) {
+      setError("No delta source");
+      return false;
+    }
+    if (opt->hasSrcSha256) {
+      uint8_t srcSha[32];
+      if (esp_partition_get_sha256(running, srcSha) != ESP_OK ||
+          memcmp(srcSha, opt->srcSha256, sizeof(srcSha)) != 0) {
+        setError("Delta source mismatch");
+        return false;
+      }
+    }
+    if (!otaDeltaBegin(running, writeImage)) {
+      setError("Delta init failed");
+      return false;
+    }
+  }
+
+  discardSectors();
+  const size_t flashLen = useSig ? sz - OTA_SIG_TRAILER_LEN : sz;
+  if (!Update.begin(flashLen, U_FLASH, 0, HIGH)) {
     setError(Update.errorString());
     return false;
   }
@@ -89,9 +397,25 @@ bool otaBegin(size_t sz, uint32_t crc32) {
   commsSetOtaReady(false);
   powerSetOtaActive(true);
 
+  resetStreamState();
   expectedSize = sz;
   expectedCrc = crc32;
   written = 0;
+  compressed = useComp;
+  delta = useDelta;
+  streamSize = (opt && opt->streamSize) ? opt->streamSize : sz;
+  shaCheck = opt && opt->hasSha256;
+  if (shaCheck) {
+    memcpy(shaExpected, opt->sha256, sizeof(shaExpected));
+    mbedtls_sha256_init(&shaCtx);
+    SHA256_STARTS(&shaCtx, 0);
+  }
+  imageLen = flashLen;
+  signedImage = useSig;
+  if (signedImage) {
+    mbedtls_sha256_init(&sigCtx);
+    SHA256_STARTS(&sigCtx, 0);
+  }
   crcRunning = 0;
   status = OtaStatus::InProgress;
   errMsg = "";
@@ -108,20 +432,21 @@ int otaWrite(const uint8_t* data, size_t len) {
   }
   if (!data || len == 0) return 0;
 
-  size_t remain = (expectedSize > written) ? (expectedSize - written) : 0;
+  size_t remain = (streamSize > received) ? (streamSize - received) : 0;
   if (len > remain) len = remain;
 
-  size_t w = Update.write(const_cast<uint8_t*>(data), len);
-  if (w != len) {
-    setError(Update.errorString());
+  const bool ok = compressed ? otaDecompFeed(data, len) : plainSink()(data, len);
+  if (!ok) {
     status = OtaStatus::Failed;
     return -1;
   }
-  written += w;
-  if (expectedCrc) {
-    crcRunning = crc32_update(crcRunning, data, w);
+  received += len;
+  // Stream lengkap: dorong sisa output decoder supaya ukuran image final
+  if (compressed && received == streamSize && !otaDecompFlush()) {
+    status = OtaStatus::Failed;
+    return -1;
   }
-  return (int)w;
+  return (int)len;
 }
 
 bool otaEnd(bool doReboot) {
@@ -130,7 +455,15 @@ bool otaEnd(bool doReboot) {
     return false;
   }
 
-  if (written != expectedSize) {
+  if (!flushSectors()) {
+    status = OtaStatus::Failed;
+    Update.abort();
+    commsSetOtaReady(true);
+    powerSetOtaActive(false);
+    return false;
+  }
+
+  if (written != expectedSize || received != streamSize) {
     setError("Size mismatch");
     status = OtaStatus::Failed;
     Update.abort();
@@ -148,6 +481,43 @@ bool otaEnd(bool doReboot) {
     return false;
   }
 
+  if (delta && !otaDeltaComplete()) {
+    setError("Delta truncated");
+    status = OtaStatus::Failed;
+    Update.abort();
+    commsSetOtaReady(true);
+    powerSetOtaActive(false);
+    return false;
+  }
+
+  if (shaCheck) {
+    uint8_t sha[32];
+    SHA256_FINISH(&shaCtx, sha);
+    if (memcmp(sha, shaExpected, sizeof(sha)) != 0) {
+      setError("SHA256 mismatch");
+      status = OtaStatus::Failed;
+      Update.abort();
+      commsSetOtaReady(true);
+      powerSetOtaActive(false);
+      return false;
+    }
+  }
+
+  // Sebelum Update.end(): image tanpa tanda tangan valid tidak pernah jadi partisi boot
+  if (signedImage) {
+    uint8_t digest[32];
+    SHA256_UPDATE(&sigCtx, sigTrailer, OTA_SIG_SIGNED_LEN);
+    SHA256_FINISH(&sigCtx, digest);
+    if (!otaSigVerify(digest, sigTrailer)) {
+      setError(otaSigError());
+      status = OtaStatus::Failed;
+      Update.abort();
+      commsSetOtaReady(true);
+      powerSetOtaActive(false);
+      return false;
+    }
+  }
+
   if (!Update.end(true)) {
     setError(Update.errorString());
     status = OtaStatus::Failed;
@@ -173,6 +543,7 @@ bool otaEnd(bool doReboot) {
 }
 
 void otaAbort() {
+  discardSectors();
   if (status == OtaStatus::InProgress) {
     Update.abort();
   }
@@ -181,6 +552,7 @@ void otaAbort() {
   expectedSize = 0;
   expectedCrc = 0;
   written = 0;
+  resetStreamState();
   crcRunning = 0;
   rebootPending = false;
   rebootAt = 0;
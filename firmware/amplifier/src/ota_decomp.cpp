@@ -0,0 +1,87 @@
+#include "ota_decomp.h"
+#include "config.h"
+
+#include <cstring>
+
+enum class HsState : uint8_t { Tag, Literal, Index, Count };
+
+static uint8_t window[1u << OTA_HS_WINDOW_MAX_BITS];
+static uint8_t outBuf[256];
+static size_t outLen = 0;
+static uint16_t wMask = 0;
+static uint16_t head = 0;
+static uint8_t wBits = 0, lBits = 0;
+static uint32_t bitBuf = 0;
+static uint8_t bitCnt = 0;
+static uint16_t brIndex = 0;
+static HsState st = HsState::Tag;
+static OtaDecompSink sinkFn = nullptr;
+
+bool otaDecompBegin(uint8_t windowBits, uint8_t lookaheadBits, OtaDecompSink sink) {
+  if (!sink) return false;
+  if (windowBits < 4 || windowBits > OTA_HS_WINDOW_MAX_BITS) return false;
+  if (lookaheadBits < 3 || lookaheadBits >= windowBits) return false;
+  // Backref sebelum awal stream membaca nol, sama seperti decoder referensi
+  memset(window, 0, sizeof(window));
+  wBits = windowBits;
+  lBits = lookaheadBits;
+  wMask = (uint16_t)((1u << windowBits) - 1);
+  head = 0;
+  bitBuf = 0;
+  bitCnt = 0;
+  brIndex = 0;
+  st = HsState::Tag;
+  outLen = 0;
+  sinkFn = sink;
+  return true;
+}
+
+bool otaDecompFlush() {
+  if (outLen == 0) return true;
+  const bool ok = sinkFn && sinkFn(outBuf, outLen);
+  outLen = 0;
+  return ok;
+}
+
+static inline bool emit(uint8_t b) {
+  window[head] = b;
+  head = (uint16_t)((head + 1) & wMask);
+  outBuf[outLen++] = b;
+  return outLen < sizeof(outBuf) || otaDecompFlush();
+}
+
+bool otaDecompFeed(const uint8_t *in, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    bitBuf = (bitBuf << 8) | in[i];
+    bitCnt += 8;
+    for (;;) {
+      const uint8_t need = (st == HsState::Tag) ? 1
+                         : (st == HsState::Literal) ? 8
+                         : (st == HsState::Index) ? wBits : lBits;
+      if (bitCnt < need) break;
+      bitCnt -= need;
+      const uint16_t v = (uint16_t)((bitBuf >> bitCnt) & ((1u << need) - 1));
+
+      switch (st) {
+        case HsState::Tag:
+          st = v ? HsState::Literal : HsState::Index;
+          break;
+        case HsState::Literal:
+          if (!emit((uint8_t)v)) return false;
+          st = HsState::Tag;
+          break;
+        case HsState::Index:
+          brIndex = (uint16_t)(v + 1);
+          st = HsState::Count;
+          break;
+        case HsState::Count:
+          for (uint16_t n = 0; n <= v; ++n) {
+            if (!emit(window[(head - brIndex) & wMask])) return false;
+          }
+          st = HsState::Tag;
+          break;
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,127 @@
+#include "ota_delta.h"
+
+#include <cstring>
+
+enum class DeltaState : uint8_t { Magic, Ctrl, Diff, Extra, Failed };
+
+static const esp_partition_t *srcPart = nullptr;
+static OtaDeltaSink sinkFn = nullptr;
+static DeltaState st = DeltaState::Magic;
+static const char *errStr = "";
+
+static uint8_t magicLen = 0;
+static uint32_t ctrl[3];       // diffLen, extraLen, seek (zigzag)
+static uint8_t ctrlIdx = 0;
+static uint8_t ctrlShift = 0;
+static uint32_t remain = 0;
+static uint32_t srcPos = 0;
+static uint32_t extraLen = 0;
+static uint8_t srcBuf[256];
+
+static bool fail(const char *why) {
+  errStr = why;
+  st = DeltaState::Failed;
+  return false;
+}
+
+bool otaDeltaBegin(const esp_partition_t *src, OtaDeltaSink sink) {
+  if (!src || !sink) return false;
+  srcPart = src;
+  sinkFn = sink;
+  st = DeltaState::Magic;
+  errStr = "";
+  magicLen = 0;
+  ctrlIdx = 0;
+  ctrlShift = 0;
+  ctrl[0] = ctrl[1] = ctrl[2] = 0;
+  remain = 0;
+  srcPos = 0;
+  extraLen = 0;
+  return true;
+}
+
+bool otaDeltaComplete() { return st == DeltaState::Ctrl && ctrlIdx == 0 && ctrlShift == 0; }
+const char *otaDeltaError() { return errStr; }
+
+static inline int32_t unzigzag(uint32_t z) {
+  return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+// Setelah diff & extra selesai: terapkan seek lalu kembali ke kontrol
+static void endCommand() {
+  srcPos = (uint32_t)((int32_t)srcPos + unzigzag(ctrl[2]));
+  ctrl[0] = ctrl[1] = ctrl[2] = 0;
+  st = DeltaState::Ctrl;
+}
+
+// Mulai perintah baru setelah tiga varint kontrol lengkap
+static bool startCommand() {
+  if (ctrl[0] > srcPart->size || srcPos > srcPart->size - ctrl[0]) return fail("delta src range");
+  extraLen = ctrl[1];
+  if (ctrl[0]) { remain = ctrl[0]; st = DeltaState::Diff; }
+  else if (extraLen) { remain = extraLen; st = DeltaState::Extra; }
+  else endCommand();
+  return true;
+}
+
+static bool applyDiff(const uint8_t *in, size_t n) {
+  while (n > 0) {
+    size_t k = n < sizeof(srcBuf) ? n : sizeof(srcBuf);
+    if (esp_partition_read(srcPart, srcPos, srcBuf, k) != ESP_OK) return fail("delta src read");
+    for (size_t i = 0; i < k; ++i) srcBuf[i] = (uint8_t)(srcBuf[i] + in[i]);
+    if (!sinkFn(srcBuf, k)) return fail("delta write");
+    srcPos += k;
+    in += k;
+    n -= k;
+  }
+  return true;
+}
+
+bool otaDeltaFeed(const uint8_t *in, size_t len) {
+  while (len > 0) {
+    switch (st) {
+      case DeltaState::Failed:
+        return false;
+
+      case DeltaState::Magic:
+        if (*in != (uint8_t)OTA_DELTA_MAGIC[magicLen]) return fail("delta magic");
+        ++in; --len;
+        if (++magicLen == 4) st = DeltaState::Ctrl;
+        break;
+
+      case DeltaState::Ctrl: {
+        const uint8_t b = *in++;
+        --len;
+        if (ctrlShift > 28) return fail("delta varint");
+        ctrl[ctrlIdx] |= (uint32_t)(b & 0x7F) << ctrlShift;
+        if (b & 0x80) { ctrlShift += 7; break; }
+        ctrlShift = 0;
+        if (++ctrlIdx == 3) {
+          ctrlIdx = 0;
+          if (!startCommand()) return false;
+        }
+        break;
+      }
+
+      case DeltaState::Diff: {
+        const size_t k = len < remain ? len : remain;
+        if (!applyDiff(in, k)) return false;
+        in += k; len -= k; remain -= k;
+        if (remain == 0) {
+          if (extraLen) { remain = extraLen; st = DeltaState::Extra; }
+          else endCommand();
+        }
+        break;
+      }
+
+      case DeltaState::Extra: {
+        const size_t k = len < remain ? len : remain;
+        if (!sinkFn(in, k)) return fail("delta write");
+        in += k; len -= k; remain -= k;
+        if (remain == 0) endCommand();
+        break;
+      }
+    }
+  }
+  return true;
+}
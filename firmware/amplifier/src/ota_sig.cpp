@@ -0,0 +1,48 @@
+#include "ota_sig.h"
+#include "config.h"
+#include "ota_pubkey.h"
+
+#include <cstring>
+#include <mbedtls/pk.h>
+
+static_assert(sizeof(OTA_SIGN_TARGET) <= OTA_SIG_TARGET_MAX, "OTA_SIGN_TARGET terlalu panjang");
+
+static const char *errStr = "";
+
+static bool fail(const char *why) {
+  errStr = why;
+  return false;
+}
+
+bool otaSigAvailable() { return OTA_SIGN_PUBKEY_LEN > 0; }
+
+bool otaSigVerify(const uint8_t digest[32], const uint8_t trailer[OTA_SIG_TRAILER_LEN]) {
+  errStr = "";
+  if (!otaSigAvailable()) return fail("No signing key");
+  if (memcmp(trailer, OTA_SIG_MAGIC, 4) != 0) return fail("Signature missing");
+  if (trailer[4] != OTA_SIG_VERSION) return fail("Signature version");
+
+  char target[OTA_SIG_TARGET_MAX + 1];
+  memcpy(target, trailer + 8, OTA_SIG_TARGET_MAX);
+  target[OTA_SIG_TARGET_MAX] = '\0';
+  if (strcmp(target, OTA_SIGN_TARGET) != 0) return fail("Wrong target");
+
+  const size_t sigLen = trailer[OTA_SIG_SIGNED_LEN];
+  if (sigLen == 0 || sigLen > OTA_SIG_TRAILER_LEN - OTA_SIG_SIGNED_LEN - 1) {
+    return fail("Signature invalid");
+  }
+
+  mbedtls_pk_context pk;
+  mbedtls_pk_init(&pk);
+  int rc = mbedtls_pk_parse_public_key(&pk, kOtaSignPubKey, OTA_SIGN_PUBKEY_LEN);
+  if (rc != 0 || !mbedtls_pk_can_do(&pk, MBEDTLS_PK_ECDSA)) {
+    mbedtls_pk_free(&pk);
+    return fail("Signing key invalid");
+  }
+  rc = mbedtls_pk_verify(&pk, MBEDTLS_MD_SHA256, digest, 32,
+                         trailer + OTA_SIG_SIGNED_LEN + 1, sigLen);
+  mbedtls_pk_free(&pk);
+  return rc == 0 ? true : fail("Signature mismatch");
+}
+
+const char *otaSigError() { return errStr; }
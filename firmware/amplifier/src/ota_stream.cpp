@@ -0,0 +1,129 @@
+#include "ota_stream.h"
+#include "ota.h"
+#include "config.h"
+
+#include <jacktor_crc.h>
+
+#include <cstring>
+
+static inline uint16_t rdU16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t rdU32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+OtaFrameStatus otaFrameDecode(const uint8_t *buf, size_t len, size_t maxPayload,
+                              OtaFrame &out, size_t &consumed) {
+  consumed = 0;
+  if (len == 0) return OtaFrameStatus::NeedMore;
+
+  if (buf[0] != OTA_FRAME_MAGIC) {
+    // Lompat ke kandidat magic berikutnya
+    const void *m = memchr(buf, OTA_FRAME_MAGIC, len);
+    consumed = m ? (size_t)(static_cast<const uint8_t *>(m) - buf) : len;
+    return OtaFrameStatus::BadHeader;
+  }
+  if (len < OTA_FRAME_HDR_LEN) return OtaFrameStatus::NeedMore;
+
+  const uint8_t type = buf[1];
+  const uint16_t plen = rdU16(buf + 4);
+  if ((type != (uint8_t)OtaFrameType::Data && type != (uint8_t)OtaFrameType::Ctrl) ||
+      plen > maxPayload) {
+    consumed = 1;
+    return OtaFrameStatus::BadHeader;
+  }
+
+  const size_t total = OTA_FRAME_OVERHEAD + plen;
+  if (len < total) return OtaFrameStatus::NeedMore;
+
+  const uint32_t crc = jacktorCrc32(0, buf, OTA_FRAME_HDR_LEN + plen);
+  if (crc != rdU32(buf + OTA_FRAME_HDR_LEN + plen)) {
+    consumed = 1;
+    return OtaFrameStatus::BadCrc;
+  }
+
+  out.type = static_cast<OtaFrameType>(type);
+  out.seq = rdU16(buf + 2);
+  out.len = plen;
+  out.payload = buf + OTA_FRAME_HDR_LEN;
+  consumed = total;
+  return OtaFrameStatus::Frame;
+}
+
+// ---- Reorder buffer ----
+static constexpr size_t kSlots = OTA_WINDOW - 1;
+
+struct SeqSlot {
+  bool used;
+  uint16_t len;
+  uint8_t data[OTA_BIN_FRAME_MAX];
+};
+
+static SeqSlot slots[kSlots];
+static uint32_t seqNext = 0;
+static uint32_t seqHighest = 0;  // seq tertinggi yang pernah terlihat (+1)
+
+void otaSeqReset(uint32_t nextSeq) {
+  for (SeqSlot &sl : slots) sl.used = false;
+  seqNext = nextSeq;
+  seqHighest = nextSeq;
+}
+
+uint32_t otaSeqNext() { return seqNext; }
+
+uint32_t otaSeqExpand16(uint16_t seq) {
+  return seqNext + (uint32_t)(int32_t)(int16_t)(uint16_t)(seq - (uint16_t)seqNext);
+}
+
+// Slot untuk seq di depan next dialamatkan modulo (seq tetap unik di window)
+static inline SeqSlot &slotFor(uint32_t seq) { return slots[seq % kSlots]; }
+
+OtaChunkResult otaSeqAccept(uint32_t seq, const uint8_t *data, size_t len) {
+  const int32_t d = (int32_t)(seq - seqNext);
+  if (d < 0) return OtaChunkResult::Duplicate;
+  if ((uint32_t)d >= OTA_WINDOW) return OtaChunkResult::OutOfWindow;
+  if (seq + 1 - seqHighest < 0x80000000u) seqHighest = seq + 1;
+
+  if (d > 0) {
+    if (len > OTA_BIN_FRAME_MAX) return OtaChunkResult::OutOfWindow;
+    SeqSlot &sl = slotFor(seq);
+    if (sl.used) return OtaChunkResult::Duplicate;
+    memcpy(sl.data, data, len);
+    sl.len = (uint16_t)len;
+    sl.used = true;
+    return OtaChunkResult::Buffered;
+  }
+
+  if (otaWrite(data, len) < 0) return OtaChunkResult::WriteError;
+  ++seqNext;
+  // Kuras chunk tertunda yang kini berurutan
+  for (;;) {
+    SeqSlot &sl = slotFor(seqNext);
+    if (!sl.used || seqNext == seqHighest) break;
+    sl.used = false;
+    if (otaWrite(sl.data, sl.len) < 0) return OtaChunkResult::WriteError;
+    ++seqNext;
+  }
+  return OtaChunkResult::Written;
+}
+
+uint32_t otaSeqBufferedMask() {
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i + 1 < OTA_WINDOW; ++i) {
+    const uint32_t seq = seqNext + 1 + i;
+    if (seq - seqNext < seqHighest - seqNext && slotFor(seq).used) mask |= 1u << i;
+  }
+  return mask;
+}
+
+size_t otaSeqMissing(uint32_t *out, size_t max) {
+  size_t n = 0;
+  if (max == 0) return 0;
+  out[n++] = seqNext;
+  for (uint32_t seq = seqNext + 1; seq - seqNext < seqHighest - seqNext && n < max; ++seq) {
+    if (!slotFor(seq).used) out[n++] = seq;
+  }
+  return n;
+}
@@ -3,6 +3,8 @@
 #include "state.h"
 #include "sensors.h"
 #include "comms.h"
+#include "capture.h"
+#include "thermal.h"
 
 #ifndef LOGF
 #define LOGF(...) do {} while (0)
@@ -30,6 +32,8 @@ static uint32_t btLowSinceMs = 0, btLossSinceMs = 0;
 static bool smpsHwFaultLatched = false;
 
 static bool fanBootTestDone = false;
+static uint16_t fanDutyNow = 0;    // duty terakhir yang benar-benar ditulis
+static uint16_t fanBaseDuty = 0;   // duty kurva statis (tanpa feed-forward)
 static bool smpsFaultLatched = false, smpsCutActive = false;
 static uint32_t smpsFaultGraceUntilMs = 0;
 static uint32_t spkProtectArmUntilMs = 0;
@@ -90,6 +94,7 @@ static uint32_t ms() { return millis(); }
 
 static void fanWriteDuty(uint16_t duty) {
   if (duty > 1023) duty = 1023;
+  fanDutyNow = duty;
   ledc_set_duty(FAN_LEDC_MODE, FAN_LEDC_CH, duty);
   ledc_update_duty(FAN_LEDC_MODE, FAN_LEDC_CH);
 }
@@ -128,16 +133,20 @@ static void fanTick() {
 
   switch (m) {
     case FanMode::AUTO: {
+      // Feed-forward model termal: kurva dievaluasi pada suhu prediksi
       const float t = getHeatsinkC();
-      duty = fanCurveAuto(t);
+      fanBaseDuty = fanCurveAuto(t);
+      duty = fanCurveAuto(thermalFanTempC(t));
       break;
     }
     case FanMode::CUSTOM:
       duty = stateGetFanCustomDuty();
+      fanBaseDuty = duty;
       break;
     case FanMode::FAILSAFE:
     default:
       duty = FAN_FALLBACK_DUTY;
+      fanBaseDuty = duty;
       break;
   }
 
@@ -208,14 +217,18 @@ static void smpsProtectTick() {
     return;
   }
 
-  float v = getVoltageInstant();
+  float v = getVoltageFiltered();   // median+avg: satu sampel noise tidak memicu trip
   float cutoff = stateSmpsCutoffV();
   float recover = stateSmpsRecoveryV();
+  // ADC tidak sehat (NAN): tegangan tidak diketahui → tidak trip dan tidak
+  // recover; cut yang sudah berjalan tetap mengikuti grace timer
+  const bool vKnown = !isnan(v);
 
-  if (!smpsCutActive && relayOn && v > 0.0f && v < cutoff) {
+  if (!smpsCutActive && relayOn && vKnown && v > 0.0f && v < cutoff) {
     smpsCutActive = true;
     smpsFaultLatched = true;
     smpsFaultGraceUntilMs = millis() + 10000;
+    captureTrigger(CaptureReason::SmpsLow);
   }
 
   if (smpsCutActive) {
@@ -226,7 +239,7 @@ static void smpsProtectTick() {
       smpsFaultGraceUntilMs = 0;
     }
 
-    if (v >= recover) {
+    if (vKnown && v >= recover) {
       smpsCutActive = false;
       smpsFaultLatched = false;
       smpsFaultGraceUntilMs = 0;
@@ -238,6 +251,7 @@ static void smpsProtectTick() {
 void powerInit() {
   safeModeActive = stateSafeModeSoft();
   const uint32_t now = millis();
+  thermalInit();
 
   powerSmpsStartSoftstart(SMPS_SOFTSTART_MS);
   smpsCutActive = false;
@@ -335,8 +349,9 @@ void powerInit() {
 void powerTick(const uint32_t now) {
   // OTP (Over-Temperature Protection) Check
   float currentTemp = getHeatsinkC();
-  if (powerIsOn() && !isnan(currentTemp) && currentTemp >= 85.0f && !otpLatched) {
+  if (powerIsOn() && !isnan(currentTemp) && currentTemp >= OTP_TRIP_C && !otpLatched) {
       otpLatched = true;
+      captureTrigger(CaptureReason::Otp);
       powerSetMainRelay(false, PowerChangeReason::Command);
 #if LOG_ENABLE
       LOGF("[OTP] CRITICAL OVER-TEMP! FORCE SHUTDOWN\n");
@@ -360,6 +375,7 @@ void powerTick(const uint32_t now) {
   // SMPS Hardware Fault Detect (Opto)
   if (powerIsOn() && _readSmpsFaultActive() && !smpsHwFaultLatched) {
       smpsHwFaultLatched = true;
+      captureTrigger(CaptureReason::SmpsHwFault);
       powerSetMainRelay(false, PowerChangeReason::Command);
 #if LOG_ENABLE
       LOGF("[SMPS_HW_FAULT] CRITICAL SHORT/LIMIT! FORCE SHUTDOWN\n");
@@ -379,6 +395,17 @@ void powerTick(const uint32_t now) {
     fanWriteDuty(0);
   }
 
+  // Model termal belajar dari duty aktual, memprediksi dengan duty kurva statis
+  {
+    uint8_t vu = 0;
+    analyzerGetVu(vu);
+    const ThermalInputs in = {
+      currentTemp, sensorsGetRtcTempC(), vu, getVoltageFiltered(),
+      fanDutyNow, powerIsOn() ? fanBaseDuty : static_cast<uint16_t>(0), powerIsOn()
+    };
+    thermalTick(now, in);
+  }
+
   // SMPS valid tracking only when ON
   if (!powerIsOn()) {
     smpsValidSince = 0;
@@ -388,12 +415,14 @@ void powerTick(const uint32_t now) {
 
   if (relayOn && !powerSmpsSoftstartActive()) {
     const bool smpsBypass = stateSmpsBypass();
-    const float voltage = getVoltageInstant();
+    const float voltage = getVoltageFiltered();
+    const bool adcUnknown = (!smpsBypass && isnan(voltage));
     const bool smpsNoPower = (!smpsBypass && voltage == 0.0f);
     const bool smpsLowVolt = (!smpsBypass && voltage > 0.0f && voltage < stateSmpsCutoffV());
     const bool smpsFault = (smpsNoPower || smpsLowVolt);
 
-    if (!smpsFault) {
+    // ADC tidak terukur bukan fault SMPS, tapi juga tidak bisa membuktikan valid
+    if (!smpsFault && !adcUnknown) {
       if (smpsValidSince == 0) smpsValidSince = now;
     } else {
       smpsValidSince = 0;
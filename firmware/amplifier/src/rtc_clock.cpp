@@ -0,0 +1,201 @@
+#include "rtc_clock.h"
+#include "i2c_bus.h"
+
+#include <Wire.h>
+#include <RTClib.h>
+#include <freertos/FreeRTOS.h>
+
+static RTC_DS3231 rtc;
+static bool ready = false;
+
+// Diubah ISR SQW: epoch detik yang berlaku sejak tepi terakhir
+static portMUX_TYPE clockMux = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint32_t edgeEpoch = 0;
+static volatile uint32_t edgeUs = 0;
+static volatile uint32_t edgeMs = 0;    // millis() tepi SQW terakhir (hanya ISR)
+static volatile bool sqwTick = false;
+static volatile bool sqwSeen = false;
+
+static uint32_t lastVerifyMs = 0;
+static bool verifyPending = false;   // verifikasi pertama setelah tepi SQW pertama
+static uint32_t verifies = 0;
+static uint32_t corrections = 0;
+static int32_t lastDriftS = 0;
+static uint32_t prevRtcEpoch = 0;
+static uint32_t prevRtcMs = 0;
+static bool stuck = false;
+
+static void IRAM_ATTR onSqwEdge() {
+  portENTER_CRITICAL_ISR(&clockMux);
+  // Tepi datang sebelum detik berjalan selesai (mis. sesudah set) → tetap +1
+  edgeEpoch = edgeEpoch + 1;
+  edgeUs = micros();
+  edgeMs = millis();
+  sqwSeen = true;
+  portEXIT_CRITICAL_ISR(&clockMux);
+  sqwTick = true;
+}
+
+static void setSoftClock(uint32_t epoch) {
+  portENTER_CRITICAL(&clockMux);
+  edgeEpoch = epoch;
+  edgeUs = micros();
+  portEXIT_CRITICAL(&clockMux);
+}
+
+static bool sqwHealthy() {
+  return sqwSeen && (millis() - edgeMs) < RTC_SQW_TIMEOUT_MS;
+}
+
+static bool readRtc(uint32_t &epoch) {
+  I2cBusLock lock(I2cPrio::Normal);
+  if (!lock.ok()) return false;
+  epoch = rtc.now().unixtime();
+  return true;
+}
+
+static bool configure() {
+  I2cBusLock lock(I2cPrio::Normal);
+  if (!lock.ok() || !rtc.begin(&Wire)) return false;
+  rtc.disable32K();
+  rtc.writeSqwPinMode(DS3231_SquareWave1Hz);
+  if (rtc.lostPower()) {
+    rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));
+  }
+  return true;
+}
+
+bool rtcClockBegin() {
+  ready = configure();
+
+  uint32_t epoch = 0;
+  if (ready && readRtc(epoch)) setSoftClock(epoch);
+  sqwSeen = false;
+  sqwTick = false;
+  verifyPending = ready;
+  lastVerifyMs = millis();
+  stuck = false;
+  prevRtcMs = 0;
+
+  pinMode(RTC_SQW_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(RTC_SQW_PIN), onSqwEdge, FALLING);
+  return ready;
+}
+
+bool rtcClockReady() { return ready; }
+
+bool rtcClockRecover() {
+  if (!configure()) return false;
+  // Belum pernah siap (tidak ada saat boot): ambil waktu langsung; sudah siap:
+  // jam software tetap jalan, verifikasi berikutnya mengoreksi bila perlu
+  uint32_t epoch;
+  if (!ready && readRtc(epoch)) setSoftClock(epoch);
+  ready = true;
+  verifyPending = true;
+  stuck = false;
+  prevRtcMs = 0;
+  return true;
+}
+
+bool rtcClockNow(uint32_t &epoch, uint16_t *msOut) {
+  if (!ready) return false;
+  portENTER_CRITICAL(&clockMux);
+  const uint32_t base = edgeEpoch;
+  const uint32_t baseUs = edgeUs;
+  portEXIT_CRITICAL(&clockMux);
+
+  // Tanpa SQW, micros() melanjutkan hitungan dari tepi/sinkron terakhir
+  const uint32_t sinceMs = (micros() - baseUs) / 1000UL;
+  uint32_t sub = sinceMs % 1000UL;
+  uint32_t whole = sinceMs / 1000UL;
+  if (sqwHealthy() && whole > 0) {
+    // Tepi berikutnya terlambat beberapa ms (ISR/latensi): jangan lompati detik
+    whole = 0;
+    sub = 999;
+  }
+  epoch = base + whole;
+  if (msOut) *msOut = static_cast<uint16_t>(sub);
+  return true;
+}
+
+bool rtcClockSet(uint32_t epoch) {
+  if (!ready) return false;
+  {
+    I2cBusLock lock(I2cPrio::Normal);
+    if (!lock.ok()) return false;
+    // Menulis detik juga me-reset pembagi 1 Hz DS3231 → tepi berikutnya +1 s
+    rtc.adjust(DateTime(epoch));
+  }
+  setSoftClock(epoch);
+  lastVerifyMs = millis();
+  return true;
+}
+
+void rtcClockTick(uint32_t now) {
+  if (!ready) return;
+
+  const bool sqwOk = sqwHealthy();
+  if (!sqwOk) {
+    // Tanpa tepi SQW basis tidak pernah maju: lipat detik utuh ke basis agar
+    // selisih micros() tidak melewati wrap (~71 menit)
+    portENTER_CRITICAL(&clockMux);
+    const uint32_t whole = (micros() - edgeUs) / 1000000UL;
+    edgeEpoch = edgeEpoch + whole;
+    edgeUs = edgeUs + whole * 1000000UL;
+    portEXIT_CRITICAL(&clockMux);
+  }
+  const uint32_t interval = sqwOk ? RTC_VERIFY_MS : RTC_VERIFY_NOSQW_MS;
+  if (!verifyPending && now - lastVerifyMs < interval) return;
+
+  // Baca tepat sesudah tepi SQW (≤ 200 ms) agar detik RTC & software sejajar
+  if (sqwOk && now - edgeMs > 200) return;
+
+  uint32_t rtcEpoch;
+  if (!readRtc(rtcEpoch)) return;
+  lastVerifyMs = now;
+  verifyPending = false;
+  ++verifies;
+
+  // Osilator DS3231 berhenti: register detik membeku walau I2C menjawab
+  stuck = prevRtcMs != 0 && now - prevRtcMs >= 2000 && rtcEpoch == prevRtcEpoch;
+  prevRtcEpoch = rtcEpoch;
+  prevRtcMs = now;
+  if (stuck) return;   // jangan "mengoreksi" jam software ke nilai beku
+
+  uint32_t softEpoch;
+  rtcClockNow(softEpoch);
+  if (rtcEpoch != softEpoch) {
+    lastDriftS = static_cast<int32_t>(rtcEpoch - softEpoch);
+    ++corrections;
+    if (sqwOk) {
+      portENTER_CRITICAL(&clockMux);
+      edgeEpoch = rtcEpoch;   // fase sub-detik tetap dari tepi terakhir
+      portEXIT_CRITICAL(&clockMux);
+    } else {
+      setSoftClock(rtcEpoch);
+    }
+  }
+}
+
+bool rtcClockSqwConsumeTick() {
+  if (sqwTick) {
+    sqwTick = false;
+    return true;
+  }
+  return false;
+}
+
+float rtcClockReadTempC() {
+  if (!ready) return NAN;
+  I2cBusLock lock(I2cPrio::Normal);
+  if (!lock.ok()) return NAN;
+  return rtc.getTemperature();
+}
+
+void rtcClockGetStats(RtcClockStats &out) {
+  out.sqwOk = ready && sqwHealthy();
+  out.verifies = verifies;
+  out.corrections = corrections;
+  out.lastDriftS = lastDriftS;
+  out.stuck = stuck;
+}
@@ -0,0 +1,162 @@
+#include "sensor_health.h"
+#include "i2c_bus.h"
+#include "ads_async.h"
+#include "rtc_clock.h"
+
+#include <atomic>
+
+static constexpr size_t kDevCount = static_cast<size_t>(SensorDev::Count);
+
+struct DevState {
+  const char *name;
+  uint8_t addr;
+  I2cPrio prio;
+
+  // state & counter ditulis task akuisisi, dibaca loop (telemetri)
+  std::atomic<uint8_t> state;
+  uint32_t errors;
+  uint32_t recoveries;
+  uint32_t stuckEvents;
+  uint32_t lastGoodMs;
+
+  uint8_t consecErr;
+  uint32_t lastRecoverMs;
+  bool stuck;
+};
+
+static DevState devs[kDevCount] = {
+  {"ads", ADS_I2C_ADDR, I2cPrio::Critical},
+  {"rtc", RTC_I2C_ADDR, I2cPrio::Normal},
+};
+
+static uint32_t lastProbeMs = 0;
+
+// Deteksi stuck ADS per channel (hanya task akuisisi)
+static int16_t adsLast[4];
+static uint16_t adsRun[4];
+
+static DevState &dev(SensorDev d) { return devs[static_cast<size_t>(d)]; }
+
+static bool devReady(SensorDev d) {
+  return d == SensorDev::Ads ? adsAsyncReady() : rtcClockReady();
+}
+
+static bool devReinit(SensorDev d) {
+  return d == SensorDev::Ads ? adsAsyncBegin() : rtcClockRecover();
+}
+
+static void setState(DevState &s, SensorHealth h) {
+  s.state.store(static_cast<uint8_t>(h), std::memory_order_relaxed);
+}
+
+static void reinit(SensorDev d, uint32_t now, bool busRecover) {
+  DevState &s = dev(d);
+  s.lastRecoverMs = now;
+  ++s.recoveries;
+  if (busRecover) i2cBusRecover();
+  if (devReinit(d)) {
+    s.stuck = false;
+    if (d == SensorDev::Ads) memset(adsRun, 0, sizeof(adsRun));
+  }
+}
+
+void sensorHealthInit() {
+  for (size_t i = 0; i < kDevCount; ++i) {
+    DevState &s = devs[i];
+    const bool ready = devReady(static_cast<SensorDev>(i));
+    setState(s, ready ? SensorHealth::Ok : SensorHealth::Failed);
+    s.errors = s.recoveries = s.stuckEvents = 0;
+    s.lastGoodMs = ready ? millis() : 0;
+    s.consecErr = ready ? 0 : SENSOR_HEALTH_FAIL_ERRS;
+    s.lastRecoverMs = millis();
+    s.stuck = false;
+  }
+  memset(adsLast, 0, sizeof(adsLast));
+  memset(adsRun, 0, sizeof(adsRun));
+  lastProbeMs = millis();
+}
+
+void sensorHealthAdsSample(uint8_t adsCh, int16_t raw) {
+  adsCh &= 3;
+  if (raw == adsLast[adsCh] && (raw > SENSOR_STUCK_MIN_LSB || raw < -SENSOR_STUCK_MIN_LSB)) {
+    if (adsRun[adsCh] < SENSOR_STUCK_SAMPLES) ++adsRun[adsCh];
+  } else {
+    adsRun[adsCh] = 0;
+  }
+  adsLast[adsCh] = raw;
+
+  DevState &s = dev(SensorDev::Ads);
+  bool anyStuck = false;
+  for (uint16_t run : adsRun) anyStuck |= run >= SENSOR_STUCK_SAMPLES;
+  if (anyStuck && !s.stuck) ++s.stuckEvents;
+  s.stuck = anyStuck;
+}
+
+void sensorHealthTick(uint32_t now) {
+  if (now - lastProbeMs < SENSOR_HEALTH_PROBE_MS) return;
+  lastProbeMs = now;
+
+  RtcClockStats clk;
+  rtcClockGetStats(clk);
+  DevState &rtcState = dev(SensorDev::Rtc);
+  if (clk.stuck && !rtcState.stuck) ++rtcState.stuckEvents;
+  rtcState.stuck = clk.stuck;
+
+  for (size_t i = 0; i < kDevCount; ++i) {
+    const SensorDev d = static_cast<SensorDev>(i);
+    DevState &s = devs[i];
+
+    bool lockOk;
+    const bool ack = i2cBusProbe(s.addr, s.prio, lockOk);
+    if (!lockOk) continue;   // bus sibuk: bukan kesalahan perangkat
+
+    if (ack) {
+      s.consecErr = 0;
+      s.lastGoodMs = now;
+      // Menjawab lagi setelah gagal / tidak ada saat boot / stuck → init ulang
+      if ((!devReady(d) || s.stuck) && now - s.lastRecoverMs >= SENSOR_HEALTH_RECOVER_MS) {
+        reinit(d, now, false);
+      }
+    } else {
+      ++s.errors;
+      if (s.consecErr < 255) ++s.consecErr;
+      if (s.consecErr >= SENSOR_HEALTH_FAIL_ERRS && now - s.lastRecoverMs >= SENSOR_HEALTH_RECOVER_MS) {
+        reinit(d, now, true);
+      }
+    }
+
+    SensorHealth h = SensorHealth::Ok;
+    if (s.consecErr >= SENSOR_HEALTH_FAIL_ERRS || !devReady(d)) h = SensorHealth::Failed;
+    else if (s.stuck) h = SensorHealth::Stuck;
+    setState(s, h);
+  }
+}
+
+bool sensorHealthOk(SensorDev dev) {
+  if (dev >= SensorDev::Count) return false;
+  return devs[static_cast<size_t>(dev)].state.load(std::memory_order_relaxed) ==
+         static_cast<uint8_t>(SensorHealth::Ok);
+}
+
+void sensorHealthGet(SensorDev d, SensorDevHealth &out) {
+  // Snapshot tanpa lock: nilai 32-bit dibaca atomik, cukup untuk telemetri
+  const DevState &s = dev(d);
+  out.state = static_cast<SensorHealth>(s.state.load(std::memory_order_relaxed));
+  out.errors = s.errors;
+  out.recoveries = s.recoveries;
+  out.stuckEvents = s.stuckEvents;
+  out.lastGoodMs = s.lastGoodMs;
+}
+
+const char *sensorDevStr(SensorDev d) {
+  return d < SensorDev::Count ? dev(d).name : "?";
+}
+
+const char *sensorHealthStr(SensorHealth s) {
+  switch (s) {
+    case SensorHealth::Ok:     return "ok";
+    case SensorHealth::Stuck:  return "stuck";
+    case SensorHealth::Failed: return "failed";
+    default:                   return "?";
+  }
+}
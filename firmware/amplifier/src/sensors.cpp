@@ -1,158 +1,326 @@
 #include "sensors.h"
 #include "config.h"
 #include "analyzer.h"
+#include "ads_async.h"
+#include "i2c_bus.h"
+#include "filters.h"
+#include "capture.h"
+#include "ds18b20.h"
+#include "rtc_clock.h"
+#include "calib.h"
+#include "sensor_health.h"
 
 #include <Wire.h>
 #include <RTClib.h>
-#include <Adafruit_ADS1X15.h>
-#include <OneWire.h>
-#include <DallasTemperature.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
-static Adafruit_ADS1115 ads;
+// Akuisisi berjalan di task "sensors" (SENSORS_TASK_ENABLE) yang memegang
+// ADS1115, DS18B20 & suhu RTC; loop utama hanya membaca snapshot/ring.
+// Akses Wire diatur i2c_bus: ADC = Critical, RTC = Normal, OLED = Display.
+static SampleRing<SENSOR_RING_LEN> rings[static_cast<size_t>(SensorCh::Count)];
+static inline SampleRing<SENSOR_RING_LEN>& ring(SensorCh ch) {
+  return rings[static_cast<size_t>(ch)];
+}
+
+// Rantai filter per channel: state filter hanya disentuh task akuisisi,
+// hasilnya dipublikasikan lewat atomic untuk pembaca di loop utama.
+struct ChannelFilter {
+  FilterChain chain;
+  std::atomic<float> out{NAN};
+  std::atomic<float> envLo{NAN};
+  std::atomic<float> envHi{NAN};
+};
+static ChannelFilter filt[static_cast<size_t>(SensorCh::Count)];
+
+static const FilterConfig kFilterCfg[static_cast<size_t>(SensorCh::Count)] = {
+  {FILT_SMPS_MEDIAN, FILT_SMPS_AVG, FILT_SMPS_IIR, FILT_SMPS_ENV},
+  {FILT_V12_MEDIAN,  FILT_V12_AVG,  FILT_V12_IIR,  FILT_V12_ENV},
+  {FILT_HEAT_MEDIAN, FILT_HEAT_AVG, FILT_HEAT_IIR, FILT_HEAT_ENV},
+  {FILT_RTC_MEDIAN,  FILT_RTC_AVG,  FILT_RTC_IIR,  FILT_RTC_ENV},
+};
 
-static inline float adcToRealVolt(float vAdc, float r1, float r2) {
-  return vAdc * ((r1 + r2) / r2);
+// Satu jalur masuk per sampel: ring mentah + rantai filter
+static void publish(SensorCh ch, uint32_t now, float value) {
+  ring(ch).push(now, value);
+  capturePush(ch, now, value);
+  ChannelFilter& f = filt[static_cast<size_t>(ch)];
+  f.out.store(f.chain.push(value));
+  const MinMaxEnvelope& env = f.chain.envelope();
+  if (env.valid()) {
+    f.envLo.store(env.lo());
+    f.envHi.store(env.hi());
+  }
 }
 
-static float voltInstant = 0.0f;
-static float volt12V = 0.0f;
+// Keluarkan kanal dari rantai filter (mis. semua sensor heatsink hilang)
+static void invalidate(SensorCh ch) {
+  ChannelFilter& f = filt[static_cast<size_t>(ch)];
+  f.chain.reset();
+  f.out.store(NAN);
+}
 
-static OneWire oneWire(DS18B20_PIN);
-static DallasTemperature dallas(&oneWire);
-static float heatC = NAN;
-static uint32_t lastTempMs = 0;
+// Suhu per sensor DS18B20 (indeks = urutan ROM), ditulis task akuisisi
+static std::atomic<float> dsTempC[DS18B20_MAX_SENSORS];
+static uint8_t dsFails[DS18B20_MAX_SENSORS];
+static float dsCycleMax = NAN;   // maks heatsink pada siklus berjalan
+static uint32_t lastRtcTempMs = 0;
+static uint32_t lastDsScanMs = 0;
+static std::atomic<bool> adsPublishing{false};   // false → SMPS/12V sudah di-invalidate
 
-static RTC_DS3231 rtc;
-static bool rtcReady = false;
-static volatile bool rtcSqwTick = false;
-static float rtcTempC = NAN;
+static TaskHandle_t sensorTask = nullptr;
 
-static void IRAM_ATTR onRtcSqw() {
-  rtcSqwTick = true;
+// Enumerasi ROM DS18B20; indeks suhu/gagal mengikuti urutan ROM yang baru
+static void dsEnumerate(uint32_t now) {
+  for (auto& t : dsTempC) t.store(NAN);
+  memset(dsFails, 0, sizeof(dsFails));
+  dsCycleMax = NAN;
+  ds18b20Begin();
+  lastDsScanMs = now;
 }
 
-void sensorsInit() {
-  Wire.begin(I2C_SDA, I2C_SCL);
-
-  ads.begin(ADS_I2C_ADDR, &Wire);
-  ads.setGain(GAIN_ONE);
-
-  dallas.begin();
-  // Set DALLAS temperature sensor ke non-blocking mode
-  // untuk mencegah keterlambatan / stall pada main loop
-  dallas.setWaitForConversion(false);
-
-  rtcReady = rtc.begin(&Wire);
-  if (rtcReady) {
-    rtc.disable32K();
-    rtc.writeSqwPinMode(DS3231_SquareWave1Hz);
-    if (rtc.lostPower()) {
-      rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));
+// Ada sensor heatsink yang masih terbaca (belum DS18B20_FAIL_LIMIT gagal beruntun)
+static bool dsHeatsinkHealthy() {
+  const uint8_t n = ds18b20Count();
+  for (uint8_t i = 0; i < n; ++i) {
+    if ((DS18B20_HEATSINK_MASK & (1u << i)) && dsFails[i] < DS18B20_FAIL_LIMIT) return true;
+  }
+  return false;
+}
+
+// ADS1115 asinkron: ambil hasil yang sudah selesai, tanpa menunggu konversi.
+// Dipanggil tiap kali task dibangunkan (konversi selesai), bukan per tick.
+static void acquireAds(uint32_t now) {
+  uint8_t ch;
+  int16_t raw;
+  while (adsAsyncPoll(micros(), ch, raw)) {
+    sensorHealthAdsSample(ch, raw);
+    if (!adsPublishing) continue;
+    // Gain/offset per unit (calib.h) diterapkan fixed-point atas nilai mentah
+    if (ch == ADS_CHANNEL_SMPS) {
+      // SMPS 65V (Channel 0)
+      calibFeed(CalCh::Smps, raw);
+      const float vRealSmps = calibApply(CalCh::Smps, raw);
+      publish(SensorCh::Smps, now, (vRealSmps >= VOLT_MIN_VALID_V) ? vRealSmps : 0.0f);
+    } else if (ch == ADS_CHANNEL_12V) {
+      // 12V rail (Channel 1)
+      calibFeed(CalCh::V12, raw);
+      const float vReal12V = calibApply(CalCh::V12, raw);
+      publish(SensorCh::V12, now, (vReal12V >= VOLT_MIN_VALID_V) ? vReal12V : 0.0f);
     }
   }
-  pinMode(RTC_SQW_PIN, INPUT);
-  attachInterrupt(digitalPinToInterrupt(RTC_SQW_PIN), onRtcSqw, RISING);
+}
+
+// Bagian berperiode SENSORS_TASK_PERIOD_MS: capture, health, DS18B20, suhu RTC
+static void acquirePeriodic(uint32_t now) {
+  captureTick(now);
+  sensorHealthTick(now);
+
+  // ADS gagal/stuck: hasil register tidak bisa dipercaya → kanal jadi NAN
+  // (bukan nilai terakhir) sampai health pulih
+  const bool adsOk = sensorHealthOk(SensorDev::Ads);
+  if (!adsOk && adsPublishing) {
+    invalidate(SensorCh::Smps);
+    invalidate(SensorCh::V12);
+  }
+  adsPublishing.store(adsOk);
+
+  // Tanpa sensor / semua heatsink gagal: sensor mungkin baru dicolok atau
+  // diganti (ROM lain) → cari ulang. Blocking singkat, jarang, hanya saat rusak.
+  if (now - lastDsScanMs >= DS18B20_RESCAN_MS && !dsHeatsinkHealthy()) {
+    dsEnumerate(now);
+    invalidate(SensorCh::Heatsink);
+  }
+
+  // DS18B20: satu potongan pendek per periode (reset/select/3 byte)
+  Ds18b20Reading rd;
+  if (ds18b20Poll(now, rd)) {
+    // Di luar rentang datasheet (-55..125) atau >120 dianggap gagal baca
+    const bool ok = rd.ok && rd.tempC > -55.0f && rd.tempC < 120.0f;
+    if (ok) {
+      dsFails[rd.idx] = 0;
+      dsTempC[rd.idx].store(rd.tempC);
+    } else if (dsFails[rd.idx] < DS18B20_FAIL_LIMIT && ++dsFails[rd.idx] >= DS18B20_FAIL_LIMIT) {
+      dsTempC[rd.idx].store(NAN);
+    }
+
+    const float t = dsTempC[rd.idx].load();
+    if ((DS18B20_HEATSINK_MASK & (1u << rd.idx)) && !isnan(t)) {
+      dsCycleMax = isnan(dsCycleMax) ? t : fmaxf(dsCycleMax, t);
+    }
+    if (rd.last) {
+      // Heatsink = sensor terpanas; rantai FILT_HEAT_* mencegah spike memicu OTP palsu
+      if (!isnan(dsCycleMax)) publish(SensorCh::Heatsink, now, dsCycleMax);
+      else invalidate(SensorCh::Heatsink);
+      dsCycleMax = NAN;
+    }
+  }
+
+  if (now - lastRtcTempMs >= 1000) {
+    lastRtcTempMs = now;
+
+    if (sensorHealthOk(SensorDev::Rtc) && FEAT_RTC_TEMP_TELEMETRY) {
+      const float t = rtcClockReadTempC();
+      if (!isnan(t)) publish(SensorCh::RtcTemp, now, t);
+    }
+  }
+}
+
+static void acquire(uint32_t now) {
+  acquirePeriodic(now);
+  acquireAds(now);
+}
+
+#if SENSORS_TASK_ENABLE
+// Task tidur sampai konversi ADS selesai (notifikasi ads_async, resolusi µs)
+// atau batas periode tetap, mana yang lebih dulu. Polling per tick 1 ms saja
+// membulatkan tiap konversi ~1.3 ms ke 2 ms (≈500 SPS).
+static void sensorTaskLoop(void*) {
+  static constexpr TickType_t kPeriod = pdMS_TO_TICKS(SENSORS_TASK_PERIOD_MS);
+  adsAsyncSetWakeTask(xTaskGetCurrentTaskHandle());
+  TickType_t last = xTaskGetTickCount();
+  acquirePeriodic(millis());
+  for (;;) {
+    acquireAds(millis());
+    const TickType_t elapsed = xTaskGetTickCount() - last;
+    if (elapsed >= kPeriod) {
+      last += kPeriod * (elapsed / kPeriod);   // periode terlewat tidak dikejar
+      acquirePeriodic(millis());
+      continue;
+    }
+    ulTaskNotifyTake(pdTRUE, kPeriod - elapsed);
+  }
+}
+#endif
+
+void sensorsInit() {
+  Wire.begin(I2C_SDA, I2C_SCL, I2C_CLOCK_HZ);
+
+  adsAsyncBegin();
+  calibInit();   // sebelum task akuisisi memakai koefisien
+
+  // Enumerasi ROM (blocking singkat saat boot); sesudahnya non-blocking
+  dsEnumerate(millis());
+
+  rtcClockBegin();
+  sensorHealthInit();
 
   analyzerInit();
   analyzerStartCore0();
   analyzerSetEnabled(true);
 
-  voltInstant = 0.0f;
-  volt12V = 0.0f;
-  heatC = NAN;
-  lastTempMs = 0;
-  rtcTempC = NAN;
-  rtcSqwTick = false;
+  for (size_t i = 0; i < static_cast<size_t>(SensorCh::Count); ++i) {
+    filt[i].chain.configure(kFilterCfg[i]);
+    filt[i].out.store(NAN);
+    filt[i].envLo.store(NAN);
+    filt[i].envHi.store(NAN);
+  }
+  lastRtcTempMs = 0;
+  adsPublishing.store(true);
+  captureInit();   // sebelum task: ring .noinit hanya ditulis konteks akuisisi
 
-  // Inisiasi konversi suhu pertama agar pembacaan pertama nanti tidak default (85C)
-  dallas.requestTemperatures();
+#if SENSORS_TASK_ENABLE
+  if (!sensorTask) {
+    xTaskCreatePinnedToCore(sensorTaskLoop, "sensors", SENSORS_TASK_STACK, nullptr,
+                            SENSORS_TASK_PRIO, &sensorTask, SENSORS_TASK_CORE);
+  }
+#endif
 }
 
 void sensorsTick(uint32_t now) {
-  // Read SMPS 65V (Channel 0)
-  int16_t rawSmps = ads.readADC_SingleEnded(ADS_CHANNEL_SMPS);
-  float vAdcSmps = ads.computeVolts(rawSmps);
-  float vRealSmps = adcToRealVolt(vAdcSmps, R1_OHMS, R2_OHMS);
-  voltInstant = (vRealSmps >= VOLT_MIN_VALID_V) ? vRealSmps : 0.0f;
-
-  // Read 12V rail (Channel 1) with software calibration
-  int16_t raw12V = ads.readADC_SingleEnded(ADS_CHANNEL_12V);
-  float vAdc12V = ads.computeVolts(raw12V);
-  float vReal12V = adcToRealVolt(vAdc12V, R1_12V_OHMS, R2_12V_OHMS);
-  
-  // Apply software calibration offset
-  vReal12V += V12_OFFSET_V;
-  
-  volt12V = (vReal12V >= VOLT_MIN_VALID_V) ? vReal12V : 0.0f;
-
-  if (now - lastTempMs >= 1000) {
-    lastTempMs = now;
-
-    // Karena non-blocking (setWaitForConversion=false),
-    // getTempCByIndex(0) ini akan mengambil nilai *hasil* request sebelumnya,
-    // yang tidak mem-blokir RTOS loop utama (mencegah lag di PWM/komunikasi).
-    float t = dallas.getTempCByIndex(0);
-    dallas.requestTemperatures(); // request konversi berikutnya
-
-    // Filter lonjakan (spike) sensor Dallas yang salah (sering -127.0 atau >120)
-    // Jangan izinkan deviasi drastis (>15C per detik) jika tidak masuk akal.
-    if (t <= -127.0f || t >= 120.0f) {
-      // Abaikan invalid reading
-    } else {
-      if (!isnan(heatC)) {
-          // Low-pass filter (30% new, 70% old) yang selalu aktif
-          // Mencegah spike mendadak memicu OTP (Over-Temperature Protection) palsu
-          heatC = 0.7f * heatC + 0.3f * t;
-      } else {
-          heatC = t;
-      }
-    }
+  // Tanpa task (atau gagal dibuat): akuisisi tetap jalan inline di loop
+  if (!sensorTask) acquire(now);
+  rtcClockTick(now);
+}
 
-    if (rtcReady && FEAT_RTC_TEMP_TELEMETRY) {
-      rtcTempC = rtc.getTemperature();
-    } else {
-      rtcTempC = NAN;
-    }
-  }
+bool sensorsLatest(SensorCh ch, SensorSample& out) {
+  if (ch >= SensorCh::Count) return false;
+  return ring(ch).latest(out);
 }
 
-float getVoltageInstant() {
-  return voltInstant;
+size_t sensorsHistory(SensorCh ch, SensorSample* out, size_t max) {
+  if (ch >= SensorCh::Count || !out) return 0;
+  return ring(ch).copyRecent(out, max);
 }
 
-float getVoltage12V() {
-  return volt12V;
+// ADS tidak sehat → NAN, bukan sampel terakhir di ring atau 0 V: "tidak
+// terukur" harus bisa dibedakan dari "tidak ada daya" oleh proteksi
+bool sensorsVoltageValid() { return adsPublishing.load(); }
+
+static float latestVoltage(SensorCh ch) {
+  SensorSample s;
+  return sensorsVoltageValid() && sensorsLatest(ch, s) ? s.value : NAN;
 }
 
+float getVoltageInstant() { return latestVoltage(SensorCh::Smps); }
+
+float getVoltage12V() { return latestVoltage(SensorCh::V12); }
+
+float getVoltageFiltered() { return sensorsFiltered(SensorCh::Smps); }
+
+float getVoltage12VFiltered() { return sensorsFiltered(SensorCh::V12); }
+
 float getHeatsinkC() {
-  return heatC;
+  return sensorsFiltered(SensorCh::Heatsink);
+}
+
+float getHeatsinkInstantC() {
+  SensorSample s;
+  return sensorsLatest(SensorCh::Heatsink, s) ? s.value : NAN;
+}
+
+uint8_t sensorsTempCount() {
+  return ds18b20Count();
+}
+
+float sensorsTempC(uint8_t idx) {
+  return idx < ds18b20Count() ? dsTempC[idx].load() : NAN;
+}
+
+bool sensorsTempRomHex(uint8_t idx, char* out, size_t n) {
+  const uint8_t* rom = ds18b20Rom(idx);
+  if (!rom || !out || n < 17) return false;
+  for (uint8_t i = 0; i < 8; ++i) snprintf(out + 2 * i, 3, "%02x", rom[i]);
+  return true;
+}
+
+float sensorsFiltered(SensorCh ch) {
+  if (ch >= SensorCh::Count) return NAN;
+  return filt[static_cast<size_t>(ch)].out.load();
+}
+
+bool sensorsEnvelope(SensorCh ch, float& lo, float& hi) {
+  if (ch >= SensorCh::Count) return false;
+  const ChannelFilter& f = filt[static_cast<size_t>(ch)];
+  lo = f.envLo.load();
+  hi = f.envHi.load();
+  return !isnan(lo) && !isnan(hi);
 }
 
 float sensorsGetRtcTempC() {
   if (!FEAT_RTC_TEMP_TELEMETRY) return NAN;
-  return rtcTempC;
+  SensorSample s;
+  return sensorsLatest(SensorCh::RtcTemp, s) ? s.value : NAN;
 }
 
+bool sensorsInitOk() { return adsAsyncReady() && rtcClockReady(); }
+
 bool sensorsGetTimeISO(char* out, size_t n) {
   if (!out || n == 0) return false;
-  if (!rtcReady) {
+  // Dari jam software (tanpa I2C) → aman dipanggil tiap frame telemetri
+  uint32_t epoch;
+  if (!rtcClockNow(epoch)) {
     out[0] = '\0';
     return false;
   }
-  DateTime now = rtc.now();
+  DateTime now(epoch);
   snprintf(out, n, "%04u-%02u-%02uT%02u:%02u:%02uZ",
            now.year(), now.month(), now.day(),
            now.hour(), now.minute(), now.second());
   return true;
 }
 
-bool sensorsSqwConsumeTick() {
-  if (rtcSqwTick) {
-    rtcSqwTick = false;
-    return true;
-  }
-  return false;
-}
+bool sensorsSqwConsumeTick() { return rtcClockSqwConsumeTick(); }
 
 void analyzerGetBytes(uint8_t outBands[], size_t nBands) {
   if (!outBands || nBands == 0) return;
@@ -176,15 +344,6 @@ void sensorsSetAnalyzerEnabled(bool en) {
   analyzerSetEnabled(en);
 }
 
-bool sensorsGetUnixTime(uint32_t& epochOut) {
-  if (!rtcReady) return false;
-  DateTime now = rtc.now();
-  epochOut = now.unixtime();
-  return true;
-}
+bool sensorsGetUnixTime(uint32_t& epochOut) { return rtcClockNow(epochOut); }
 
-bool sensorsSetUnixTime(uint32_t epoch) {
-  if (!rtcReady) return false;
-  rtc.adjust(DateTime(epoch));
-  return true;
-}
\ No newline at end of file
+bool sensorsSetUnixTime(uint32_t epoch) { return rtcClockSet(epoch); }
\ No newline at end of file
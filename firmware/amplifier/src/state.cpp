@@ -1,6 +1,7 @@
 #include "state.h"
 #include "config.h"
 #include <Preferences.h>
+#include <nvs.h>
 
 static Preferences nv;
 
@@ -29,6 +30,30 @@ static constexpr const char* K_BT_EN = "bt_en";
 static constexpr const char* K_BT_OFFMS = "bt_off";
 static constexpr const char* K_RTC_SYNC = "rtc_sync";
 
+// Batch: selama aktif, setter hanya update RAM & menandai key kotor;
+// stateBatchCommit() menulis semuanya dengan satu nvs_commit.
+enum StateKey : uint8_t {
+  SK_SPK_BIG = 0,
+  SK_SPK_PWR,
+  SK_FAN_MODE,
+  SK_FAN_DUTY,
+  SK_SMPS_BYPASS,
+  SK_SMPS_CUT,
+  SK_SMPS_REC,
+  SK_BT_EN,
+  SK_BT_OFFMS,
+  SK_RTC_SYNC
+};
+
+static bool batchActive = false;
+static uint16_t batchDirty = 0;
+
+static inline bool deferWrite(StateKey k) {
+  if (!batchActive) return false;
+  batchDirty |= (uint16_t)(1u << k);
+  return true;
+}
+
 static void loadFromNvs() {
   sSpeakerBig = nv.getBool(K_SPK_BIG, SPK_DEFAULT_BIG);
   sSpeakerPwr = nv.getBool(K_SPK_PWR, true);
@@ -57,62 +82,95 @@ void stateFactoryReset() {
 bool stateSpeakerIsBig() { return sSpeakerBig; }
 void stateSetSpeakerIsBig(bool big) {
   sSpeakerBig = big;
-  nv.putBool(K_SPK_BIG, big);
+  if (!deferWrite(SK_SPK_BIG)) nv.putBool(K_SPK_BIG, big);
 }
 
 bool stateSpeakerPowerOn() { return sSpeakerPwr; }
 void stateSetSpeakerPowerOn(bool on) {
   sSpeakerPwr = on;
-  nv.putBool(K_SPK_PWR, on);
+  if (!deferWrite(SK_SPK_PWR)) nv.putBool(K_SPK_PWR, on);
 }
 
 FanMode stateGetFanMode() { return sFanMode; }
 void stateSetFanMode(FanMode m) {
   sFanMode = m;
-  nv.putUChar(K_FAN_MODE, (uint8_t)m);
+  if (!deferWrite(SK_FAN_MODE)) nv.putUChar(K_FAN_MODE, (uint8_t)m);
 }
 
 uint16_t stateGetFanCustomDuty() { return sFanDuty; }
 void stateSetFanCustomDuty(uint16_t d) {
   if (d > 1023) d = 1023;
   sFanDuty = d;
-  nv.putUShort(K_FAN_DUTY, d);
+  if (!deferWrite(SK_FAN_DUTY)) nv.putUShort(K_FAN_DUTY, d);
 }
 
 bool stateSmpsBypass() { return sSmpsBypass; }
 void stateSetSmpsBypass(bool en) {
   sSmpsBypass = en;
-  nv.putBool(K_SMPS_BYPASS, en);
+  if (!deferWrite(SK_SMPS_BYPASS)) nv.putBool(K_SMPS_BYPASS, en);
 }
 
 float stateSmpsCutoffV() { return sSmpsCutV; }
 void stateSetSmpsCutoffV(float v) {
   sSmpsCutV = v;
-  nv.putFloat(K_SMPS_CUT, v);
+  if (!deferWrite(SK_SMPS_CUT)) nv.putFloat(K_SMPS_CUT, v);
 }
 
 float stateSmpsRecoveryV() { return sSmpsRecV; }
 void stateSetSmpsRecoveryV(float v) {
   sSmpsRecV = v;
-  nv.putFloat(K_SMPS_REC, v);
+  if (!deferWrite(SK_SMPS_REC)) nv.putFloat(K_SMPS_REC, v);
 }
 
 bool stateBtEnabled() { return sBtEn; }
 void stateSetBtEnabled(bool en) {
   sBtEn = en;
-  nv.putBool(K_BT_EN, en);
+  if (!deferWrite(SK_BT_EN)) nv.putBool(K_BT_EN, en);
 }
 
 uint32_t stateBtAutoOffMs() { return sBtOffMs; }
 void stateSetBtAutoOffMs(uint32_t ms) {
   sBtOffMs = ms;
-  nv.putULong(K_BT_OFFMS, ms);
+  if (!deferWrite(SK_BT_OFFMS)) nv.putULong(K_BT_OFFMS, ms);
 }
 
 uint32_t stateLastRtcSync() { return sRtcSyncTs; }
 void stateSetLastRtcSync(uint32_t t) {
   sRtcSyncTs = t;
-  nv.putULong(K_RTC_SYNC, t);
+  if (!deferWrite(SK_RTC_SYNC)) nv.putULong(K_RTC_SYNC, t);
+}
+
+void stateBatchBegin() {
+  batchActive = true;
+  batchDirty = 0;
+}
+
+bool stateBatchCommit() {
+  batchActive = false;
+  if (batchDirty == 0) return true;
+
+  // Tipe data sama dengan Preferences (bool/uchar=u8, float=blob) agar
+  // loadFromNvs() tetap membaca nilai yang sama.
+  nvs_handle handle;
+  if (nvs_open(NS, NVS_READWRITE, &handle) != ESP_OK) {
+    batchDirty = 0;
+    return false;
+  }
+  const uint16_t d = batchDirty;
+  if (d & (1u << SK_SPK_BIG)) nvs_set_u8(handle, K_SPK_BIG, sSpeakerBig ? 1 : 0);
+  if (d & (1u << SK_SPK_PWR)) nvs_set_u8(handle, K_SPK_PWR, sSpeakerPwr ? 1 : 0);
+  if (d & (1u << SK_FAN_MODE)) nvs_set_u8(handle, K_FAN_MODE, (uint8_t)sFanMode);
+  if (d & (1u << SK_FAN_DUTY)) nvs_set_u16(handle, K_FAN_DUTY, sFanDuty);
+  if (d & (1u << SK_SMPS_BYPASS)) nvs_set_u8(handle, K_SMPS_BYPASS, sSmpsBypass ? 1 : 0);
+  if (d & (1u << SK_SMPS_CUT)) nvs_set_blob(handle, K_SMPS_CUT, &sSmpsCutV, sizeof(sSmpsCutV));
+  if (d & (1u << SK_SMPS_REC)) nvs_set_blob(handle, K_SMPS_REC, &sSmpsRecV, sizeof(sSmpsRecV));
+  if (d & (1u << SK_BT_EN)) nvs_set_u8(handle, K_BT_EN, sBtEn ? 1 : 0);
+  if (d & (1u << SK_BT_OFFMS)) nvs_set_u32(handle, K_BT_OFFMS, sBtOffMs);
+  if (d & (1u << SK_RTC_SYNC)) nvs_set_u32(handle, K_RTC_SYNC, sRtcSyncTs);
+  const bool ok = (nvs_commit(handle) == ESP_OK);
+  nvs_close(handle);
+  batchDirty = 0;
+  return ok;
 }
 
 bool powerIsOn() { return gOn; }
@@ -0,0 +1,216 @@
+#include "thermal.h"
+
+#include <nvs.h>
+#include <jacktor_crc.h>
+
+static constexpr const char *kNvsNs = "dev/th";
+static constexpr const char *kNvsKey = "model";
+static constexpr uint16_t kNvsVersion = 1;
+static constexpr float kStepMin = THERMAL_STEP_S / 60.0f;
+
+struct ThermalNvs {
+  uint16_t version;
+  uint16_t reserved;
+  float    theta[4];
+  uint32_t updates;
+  float    errCpm;
+  uint32_t crc;       // CRC32 atas field sebelumnya
+};
+
+static float theta[4];
+static uint32_t updates = 0;
+static float errCpm = 0.0f;
+static uint32_t savedUpdates = 0;
+static uint32_t lastSaveMs = 0;
+
+// Akumulasi satu jendela THERMAL_STEP_S
+static bool winOpen = false;
+static uint32_t winStartMs = 0;
+static float winStartC = NAN;
+static float sumOn = 0.0f, sumP = 0.0f, sumDt = 0.0f, sumFanDt = 0.0f;
+static uint32_t winN = 0;
+
+static float lastP = 0.0f;
+static float predC = NAN;
+static float predMaxFanC = NAN;
+static bool otpPredicted = false;
+
+static void setDefaults() {
+  theta[0] = THERMAL_DEFAULT_IDLE;
+  theta[1] = THERMAL_DEFAULT_LOAD;
+  theta[2] = THERMAL_DEFAULT_LOSS;
+  theta[3] = THERMAL_DEFAULT_FAN;
+  updates = 0;
+  errCpm = 0.0f;
+}
+
+static uint32_t blobCrc(const ThermalNvs &b) {
+  return jacktorCrc32(0, &b, offsetof(ThermalNvs, crc));
+}
+
+static void load() {
+  setDefaults();
+  nvs_handle handle;
+  if (nvs_open(kNvsNs, NVS_READONLY, &handle) != ESP_OK) return;
+  ThermalNvs b;
+  size_t len = sizeof(b);
+  const bool got = nvs_get_blob(handle, kNvsKey, &b, &len) == ESP_OK && len == sizeof(b);
+  nvs_close(handle);
+  if (!got || b.version != kNvsVersion || b.crc != blobCrc(b)) return;
+  for (float t : b.theta) {
+    if (!isfinite(t) || t < 0.0f) return;
+  }
+  memcpy(theta, b.theta, sizeof(theta));
+  updates = b.updates;
+  errCpm = isfinite(b.errCpm) ? b.errCpm : 0.0f;
+}
+
+static void save() {
+  ThermalNvs b = {};
+  b.version = kNvsVersion;
+  memcpy(b.theta, theta, sizeof(theta));
+  b.updates = updates;
+  b.errCpm = errCpm;
+  b.crc = blobCrc(b);
+  nvs_handle handle;
+  if (nvs_open(kNvsNs, NVS_READWRITE, &handle) != ESP_OK) return;
+  nvs_set_blob(handle, kNvsKey, &b, sizeof(b));
+  nvs_commit(handle);
+  nvs_close(handle);
+  savedUpdates = updates;
+}
+
+static bool ready() {
+  return THERMAL_MODEL_ENABLE && updates >= THERMAL_MIN_UPDATES && errCpm <= THERMAL_MAX_ERR_CPM;
+}
+
+// Integrasi Euler per langkah THERMAL_STEP_S dengan input konstan
+static float predict(float startC, float ambC, float on, float p, float fan) {
+  float t = startC;
+  for (uint32_t s = 0; s < THERMAL_HORIZON_S; s += THERMAL_STEP_S) {
+    const float dt10 = (t - ambC) / 10.0f;
+    t += (theta[0] * on + theta[1] * p - theta[2] * dt10 - theta[3] * fan * dt10) * kStepMin;
+  }
+  return t;
+}
+
+static void learn(const float x[4], float y) {
+  float yHat = 0.0f, norm = 1e-3f;
+  for (int i = 0; i < 4; ++i) {
+    yHat += theta[i] * x[i];
+    norm += x[i] * x[i];
+  }
+  const float e = y - yHat;
+  const float k = THERMAL_LMS_MU * e / norm;
+  for (int i = 0; i < 4; ++i) {
+    theta[i] += k * x[i];
+    if (theta[i] < 0.0f) theta[i] = 0.0f;   // tanda fisik: sumber panas ≥ 0, rugi ≥ 0
+  }
+  errCpm = updates == 0 ? fabsf(e) : 0.95f * errCpm + 0.05f * fabsf(e);
+  ++updates;
+}
+
+void thermalInit() {
+  load();
+  savedUpdates = updates;
+  lastSaveMs = millis();
+  winOpen = false;
+  predC = predMaxFanC = NAN;
+  otpPredicted = false;
+}
+
+void thermalTick(uint32_t now, const ThermalInputs &in) {
+#if THERMAL_MODEL_ENABLE
+  if (isnan(in.heatC)) {
+    winOpen = false;   // data putus: buang jendela berjalan
+    predC = predMaxFanC = NAN;
+    otpPredicted = false;
+    return;
+  }
+
+  const float ambC = isnan(in.ambientC) ? THERMAL_AMBIENT_C : in.ambientC;
+  const float on = in.on ? 1.0f : 0.0f;
+  const float vu = in.vu / 255.0f;
+  // ADC tidak sehat (NAN): anggap tegangan nominal agar jendela tidak rusak
+  const float vRel = isnan(in.smpsV) ? 1.0f : in.smpsV / THERMAL_V_NOM;
+  const float p = on * vu * vu * vRel * vRel;
+  const float dt10 = (in.heatC - ambC) / 10.0f;
+  const float fan = in.fanDuty / 1023.0f;
+
+  if (!winOpen) {
+    winOpen = true;
+    winStartMs = now;
+    winStartC = in.heatC;
+    sumOn = sumP = sumDt = sumFanDt = 0.0f;
+    winN = 0;
+  }
+  sumOn += on;
+  sumP += p;
+  sumDt += dt10;
+  sumFanDt += fan * dt10;
+  ++winN;
+
+  const uint32_t span = now - winStartMs;
+  if (span < THERMAL_STEP_S * 1000UL) return;
+
+  // Jendela terlalu panjang (loop tersendat) → slope tidak mewakili satu langkah
+  if (span <= 2UL * THERMAL_STEP_S * 1000UL && winN > 0) {
+    const float n = static_cast<float>(winN);
+    const float x[4] = {sumOn / n, sumP / n, -sumDt / n, -sumFanDt / n};
+    const float y = (in.heatC - winStartC) / (span / 60000.0f);
+    learn(x, y);
+    lastP = sumP / n;
+  }
+  winOpen = false;
+
+  predC = predict(in.heatC, ambC, on, lastP, in.fanBase / 1023.0f);
+  predMaxFanC = predict(in.heatC, ambC, on, lastP, 1.0f);
+  if (!ready() || !in.on) {
+    otpPredicted = false;
+  } else if (predMaxFanC >= OTP_TRIP_C) {
+    otpPredicted = true;
+  } else if (predMaxFanC < OTP_TRIP_C - 2.0f) {
+    otpPredicted = false;
+  }
+
+  if (updates != savedUpdates && now - lastSaveMs >= THERMAL_SAVE_MS) {
+    save();
+    lastSaveMs = now;
+  }
+#else
+  (void)now; (void)in;
+#endif
+}
+
+float thermalFanTempC(float heatC) {
+  if (isnan(heatC) || !ready() || isnan(predC)) return heatC;
+  if (predC >= heatC) return predC;                       // pre-spin sebelum panas datang
+  return fmaxf(predC, heatC - THERMAL_FF_RELIEF_C);       // beban rendah → kipas lebih pelan
+}
+
+bool thermalOtpPredicted() {
+  return otpPredicted;
+}
+
+void thermalGetStatus(ThermalStatus &out) {
+  out.ready = ready();
+  out.predC = predC;
+  out.predMaxFanC = predMaxFanC;
+  out.errCpm = errCpm;
+  memcpy(out.theta, theta, sizeof(theta));
+  out.updates = updates;
+}
+
+void thermalFactoryReset() {
+  setDefaults();
+  nvs_handle handle;
+  if (nvs_open(kNvsNs, NVS_READWRITE, &handle) == ESP_OK) {
+    nvs_erase_all(handle);
+    nvs_commit(handle);
+    nvs_close(handle);
+  }
+  savedUpdates = 0;
+  winOpen = false;
+  predC = predMaxFanC = NAN;
+  otpPredicted = false;
+}
@@ -3,6 +3,7 @@
 #include "state.h"
 #include "power.h"
 #include "sensors.h"
+#include "i2c_bus.h"
 
 #include <U8g2lib.h>
 #include <cstring>
@@ -29,6 +30,55 @@ static bool spkBig = SPK_DEFAULT_BIG;
 static uint8_t bootRows = 0;
 static const uint8_t MAX_BOOT_ROWS = 6;
 static uint32_t lastDrawMs = 0;
+static int16_t contrastNow = -1;   // -1 = belum pernah diset
+
+// Kirim framebuffer per page (128x8 px) dengan lock Display terpisah tiap page:
+// transaksi ADC Critical bisa menyela di antara page, bukan menunggu satu frame
+// penuh. Page yang belum terkirim karena bus sibuk ditandai dirty dan disusul
+// uiTick berikutnya mulai dari cursor terakhir, sehingga layar sekali-gambar
+// (splash/error/warning/factory reset) tetap lengkap dan page bawah tidak
+// kelaparan saat timeout berulang.
+static uint16_t pageDirty = 0;    // bit per page
+static uint8_t pageCursor = 0;
+
+static void flushPendingPages() {
+  const uint8_t tw = u8g2.getBufferTileWidth();
+  const uint8_t th = u8g2.getBufferTileHeight();
+  for (uint8_t i = 0; i < th && pageDirty; ++i) {
+    const uint8_t page = (pageCursor + i) % th;
+    if (!(pageDirty & (1u << page))) continue;
+    I2cBusLock lock(I2cPrio::Display);
+    if (!lock.ok()) { pageCursor = page; return; }
+    u8g2.updateDisplayArea(0, page, tw, 1);
+    pageDirty &= ~(1u << page);
+  }
+  pageCursor = 0;
+}
+
+static void sendFramePaged() {
+  pageDirty = (1u << u8g2.getBufferTileHeight()) - 1;
+  flushPendingPages();
+}
+
+// Tahan layar sekali-gambar sambil menyusulkan page yang tertunda
+static void holdFrame(uint32_t holdMs) {
+  const uint32_t start = millis();
+  while (pageDirty && millis() - start < holdMs) {
+    delay(5);
+    flushPendingPages();
+  }
+  const uint32_t spent = millis() - start;
+  if (spent < holdMs) delay(holdMs - spent);
+}
+
+// setContrast hanya bila berubah (sebelumnya dikirim tiap frame)
+static void setContrastCached(uint8_t value) {
+  if (contrastNow == value) return;
+  I2cBusLock lock(I2cPrio::Display);
+  if (!lock.ok()) return;
+  u8g2.setContrast(value);
+  contrastNow = value;
+}
 
 static inline void drawHeader(const char* title) {
   u8g2.setFont(u8g2_font_6x12_tf);
@@ -41,9 +91,10 @@ static void drawStandbyScreen() {
   drawHeader("STANDBY");
 
   // Draw 12V voltage top-right with 2 decimals for accuracy
-  float v12 = getVoltage12V();
+  float v12 = getVoltage12VFiltered();
   char v12buf[12];
-  snprintf(v12buf, sizeof(v12buf), "%.2fV", v12);
+  if (isnan(v12)) snprintf(v12buf, sizeof(v12buf), "--.--V");
+  else snprintf(v12buf, sizeof(v12buf), "%.2fV", v12);
   u8g2.setFont(u8g2_font_6x12_tf);
   int v12W = u8g2.getStrWidth(v12buf);
   u8g2.drawStr(128 - v12W, 10, v12buf);
@@ -56,7 +107,7 @@ static void drawStandbyScreen() {
   u8g2.setFont(u8g2_font_6x12_tf);
   u8g2.drawStr(0, 62, dateStr);
 
-  u8g2.sendBuffer();
+  sendFramePaged();
 }
 
 static void drawRunScreen() {
@@ -72,9 +123,10 @@ static void drawRunScreen() {
   u8g2.drawStr(64, 24, spkBig ? "SPK: BIG" : "SPK: SMALL");
 
   char vbuf[16], tbuf[16];
-  float v = getVoltageInstant();
+  float v = getVoltageFiltered();
   float t = getHeatsinkC();
-  snprintf(vbuf, sizeof(vbuf), "V: %.1f", v);
+  if (isnan(v)) snprintf(vbuf, sizeof(vbuf), "V: --.-");
+  else snprintf(vbuf, sizeof(vbuf), "V: %.1f", v);
   if (isnan(t)) snprintf(tbuf, sizeof(tbuf), "T: --.-C");
   else snprintf(tbuf, sizeof(tbuf), "T: %.1fC", t);
 
@@ -92,7 +144,7 @@ static void drawRunScreen() {
     u8g2.drawStr(0, 52, "SPK PROTECT FAIL");
   }
 
-  u8g2.sendBuffer();
+  sendFramePaged();
 }
 
 static void drawSplash(const char* title) {
@@ -102,7 +154,7 @@ static void drawSplash(const char* title) {
   u8g2.drawHLine(0, 12, 128);
   u8g2.setFont(u8g2_font_7x13B_tf);
   u8g2.drawStr(10, 40, "Booting...");
-  u8g2.sendBuffer();
+  sendFramePaged();
 }
 
 static void drawBootLogLine(const char* label, bool ok) {
@@ -119,7 +171,7 @@ static void drawError(const char* msg) {
   drawHeader("ERROR");
   u8g2.setFont(u8g2_font_6x12_tf);
   u8g2.drawStr(0, 28, msg ? msg : "Unknown error");
-  u8g2.sendBuffer();
+  sendFramePaged();
 }
 
 static void drawWarning(const char* msg) {
@@ -127,12 +179,17 @@ static void drawWarning(const char* msg) {
   drawHeader("NOTICE");
   u8g2.setFont(u8g2_font_6x12_tf);
   u8g2.drawStr(0, 28, msg ? msg : "Notice");
-  u8g2.sendBuffer();
+  sendFramePaged();
 }
 
 void uiInit() {
-  u8g2.begin();
-  u8g2.setPowerSave(0);
+  {
+    I2cBusLock lock(I2cPrio::Display);
+    u8g2.setBusClock(I2C_CLOCK_HZ);   // U8g2 men-set clock Wire tiap transfer
+    u8g2.begin();
+    u8g2.setPowerSave(0);
+  }
+  contrastNow = -1;
   scene = powerIsOn() ? UiScene::SPLASH : UiScene::STANDBY;
   lastDrawMs = 0;
 }
@@ -140,7 +197,7 @@ void uiInit() {
 void uiShowBoot(uint32_t holdMs) {
   scene = UiScene::SPLASH;
   drawSplash(FW_NAME);
-  if (holdMs > 0) delay(holdMs);
+  if (holdMs > 0) holdFrame(holdMs);
 }
 
 void uiShowFactoryReset(const char* subtitle, uint32_t holdMs) {
@@ -150,8 +207,8 @@ void uiShowFactoryReset(const char* subtitle, uint32_t holdMs) {
   u8g2.setFont(u8g2_font_6x12_tf);
   const char *line = (subtitle && subtitle[0]) ? subtitle : "Menghapus NVS...";
   u8g2.drawStr(0, 32, line);
-  u8g2.sendBuffer();
-  if (holdMs > 0) delay(holdMs);
+  sendFramePaged();
+  if (holdMs > 0) holdFrame(holdMs);
 }
 
 void uiTick(uint32_t now) {
@@ -162,22 +219,23 @@ void uiTick(uint32_t now) {
   // Redupkan layar (setContrast) jika tidak ada interaksi selama 30 detik untuk mencegah burn-in
   if (scene == UiScene::STANDBY) {
       if (now - last_ui_interaction_ms > 30000) {
-          u8g2.setContrast(0); // Sangat redup
+          setContrastCached(0); // Sangat redup
       } else {
-          u8g2.setContrast(255); // Terang
+          setContrastCached(255); // Terang
       }
   } else {
-      u8g2.setContrast(255);
+      setContrastCached(255);
       last_ui_interaction_ms = now; // Selalu reset timer di mode RUN/ERROR
   }
 
   switch (scene) {
-    case UiScene::SPLASH: break;
-    case UiScene::BOOTLOG: u8g2.sendBuffer(); break;
     case UiScene::STANDBY: drawStandbyScreen(); break;
     case UiScene::RUN: drawRunScreen(); break;
-    case UiScene::ERROR: break;
-    case UiScene::WARN: break;
+    // Layar statis: cukup susulkan page yang tertunda
+    case UiScene::SPLASH:
+    case UiScene::BOOTLOG:
+    case UiScene::ERROR:
+    case UiScene::WARN: flushPendingPages(); break;
   }
 }
 
@@ -193,7 +251,7 @@ void uiBootLogLine(const char* label, bool ok) {
     drawHeader("BOOT LOG");
   }
   drawBootLogLine(label, ok);
-  u8g2.sendBuffer();
+  sendFramePaged();
 }
 
 void uiShowError(const char* msg) {
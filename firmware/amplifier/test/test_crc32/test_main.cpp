@@ -0,0 +1,73 @@
+// Host test jalur slicing-by-8 jacktorCrc32 terhadap vektor zlib CRC32.
+//   pio test -e native
+#include <unity.h>
+#include <jacktor_crc.h>
+
+#include <string.h>
+
+// Referensi bit-per-bit (poly 0xEDB88320), sama dengan zlib.crc32
+static uint32_t refCrc32(uint32_t crc, const uint8_t *p, size_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *p++;
+    for (int k = 0; k < 8; ++k) crc = (crc & 1) ? (0xEDB88320u ^ (crc >> 1)) : (crc >> 1);
+  }
+  return ~crc;
+}
+
+static uint8_t pattern[1024 + 8];
+
+static void fillPattern() {
+  for (size_t i = 0; i < sizeof(pattern); ++i) pattern[i] = (uint8_t)(i * 7 + 3);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_empty() {
+  TEST_ASSERT_EQUAL_HEX32(0x00000000u, jacktorCrc32(0, "", 0));
+  TEST_ASSERT_EQUAL_HEX32(0x00000000u, jacktorCrc32(0, nullptr, 0));
+  // Panjang 0 tidak mengubah crc berjalan
+  TEST_ASSERT_EQUAL_HEX32(0xCBF43926u, jacktorCrc32(0xCBF43926u, "x", 0));
+}
+
+static void test_known_vectors() {
+  TEST_ASSERT_EQUAL_HEX32(0xE8B7BE43u, jacktorCrc32(0, "a", 1));
+  TEST_ASSERT_EQUAL_HEX32(0xCBF43926u, jacktorCrc32(0, "123456789", 9));
+  const char *fox = "The quick brown fox jumps over the lazy dog";
+  TEST_ASSERT_EQUAL_HEX32(0x414FA339u, jacktorCrc32(0, fox, strlen(fox)));
+  // zlib.crc32(bytes((i*7+3) & 0xff for i in range(1024)))
+  TEST_ASSERT_EQUAL_HEX32(0x5D3DE8EDu, jacktorCrc32(0, pattern, 1024));
+}
+
+// Semua offset awal 0..7 (pointer tidak sejajar) × panjang di sekitar blok 8 byte
+static void test_unaligned_lengths() {
+  for (size_t off = 0; off < 8; ++off) {
+    for (size_t len = 0; len <= 67; ++len) {
+      TEST_ASSERT_EQUAL_HEX32(refCrc32(0, pattern + off, len), jacktorCrc32(0, pattern + off, len));
+    }
+  }
+}
+
+// Inkremental: potongan di setiap titik sama dengan satu panggilan penuh
+static void test_chained() {
+  const uint32_t whole = jacktorCrc32(0, pattern, 257);
+  for (size_t cut = 0; cut <= 257; ++cut) {
+    uint32_t c = jacktorCrc32(0, pattern, cut);
+    c = jacktorCrc32(c, pattern + cut, 257 - cut);
+    TEST_ASSERT_EQUAL_HEX32(whole, c);
+  }
+  uint32_t c = 0;
+  for (size_t i = 0; i < 9; i += 3) c = jacktorCrc32(c, "123456789" + i, 3);
+  TEST_ASSERT_EQUAL_HEX32(0xCBF43926u, c);
+}
+
+int main(int, char **) {
+  fillPattern();
+  UNITY_BEGIN();
+  RUN_TEST(test_empty);
+  RUN_TEST(test_known_vectors);
+  RUN_TEST(test_unaligned_lengths);
+  RUN_TEST(test_chained);
+  return UNITY_END();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Relay OTA amplifier: image (mentah/terkompresi/delta) diterima utuh dari
+// PC via HTTP /amp/update atau frame USB {"type":"amp_ota"}, disimpan di
+// PSRAM, diverifikasi, lalu bridge sendiri menjalankan OTA biner amplifier
+// pada kecepatan penuh UART. PC boleh lepas setelah image tersimpan.
+enum class AmpRelayState : uint8_t {
+  Idle,
+  Staging,     // menerima image dari PC
+  Starting,    // ota_begin terkirim, menunggu begin_ok
+  Flashing,    // mengirim frame biner
+  Finishing,   // ota_end terkirim, menunggu end_ok
+  Done,
+  Failed,
+};
+
+void ampRelayInit();
+void ampRelayTick(uint32_t nowMs);
+
+// Staging. beginJson = objek ota_begin amplifier (opsional; kosong = image
+// mentah, size & crc32 dihitung dari data). capacity = batas atas ukuran.
+bool ampRelayStageBegin(size_t capacity, const String &beginJson);
+bool ampRelayStageWrite(size_t offset, const uint8_t *data, size_t len);
+// Verifikasi image lalu mulai mem-flash amplifier (hanya dari loop())
+bool ampRelayStageCommit();
+// Tandai staging selesai; commit dijalankan ampRelayTick di loop().
+// Aman dipanggil dari task lain (upload HTTP), begitu juga Begin/Write.
+bool ampRelayStageFinish();
+bool ampRelayCommitPending();
+void ampRelayAbort(const char *reason);
+
+// Frame dari PC {"type":"amp_ota","op":...} (ditangani bridge, tidak diteruskan)
+void ampRelayHandleHostFrame(JsonDocument &doc);
+// Event OTA dari amplifier selama relay aktif
+void ampRelayHandleAmpFrame(JsonDocument &doc);
+
+AmpRelayState ampRelayState();
+bool ampRelayBusy();  // Starting/Flashing/Finishing: link amp dipakai relay
+// Salin error terakhir ke buffer pemanggil (aman dari task lain)
+void ampRelayLastError(char *out, size_t n);
@@ -27,6 +27,16 @@
 #define HOST_SERIAL_BAUD      115200 // Native USB otomatis pakai kecepatan maximum
 #define AMP_SERIAL_BAUD       921600
 #define BRIDGE_MAX_FRAME      2048
+#define AMP_BIN_IDLE_MS       5000   // batas diam passthrough OTA biner (Amp sendiri 3 s)
+#define AMP_TX_BUF_SIZE       4096   // ring buffer TX UART ke Amp (frame OTA biner)
+
+// --- Relay OTA amplifier (image di-stage di PSRAM lalu di-flash oleh bridge)
+#define AMP_RELAY_STAGE_MAX         (2 * 1024 * 1024)
+#define AMP_RELAY_FRAME_MAX         1024   // payload frame biner maks. yang didukung relay
+#define AMP_RELAY_ACK_TIMEOUT_MS    500    // tanpa ack → ulangi frame terbuka
+#define AMP_RELAY_REPLY_TIMEOUT_MS  5000   // batas tunggu begin_ok/resume_ok/end_ok
+#define AMP_RELAY_RESUME_TRIES      3      // ota_resume setelah bin_exit tak terduga
+#define AMP_RELAY_REPORT_MS         250    // interval progres ke PC
 
 // Waktu tunggu deteksi PC Sleep via USB Suspend
 #define PC_SLEEP_TIMEOUT_MS   3000
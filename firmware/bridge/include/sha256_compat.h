@@ -0,0 +1,14 @@
+#pragma once
+#include <mbedtls/sha256.h>
+#include <mbedtls/version.h>
+
+// mbedtls 2.x (IDF 4.4) memakai varian *_ret; 3.x sudah mengembalikan int
+#if defined(MBEDTLS_VERSION_MAJOR) && MBEDTLS_VERSION_MAJOR >= 3
+#define SHA256_STARTS mbedtls_sha256_starts
+#define SHA256_UPDATE mbedtls_sha256_update
+#define SHA256_FINISH mbedtls_sha256_finish
+#else
+#define SHA256_STARTS mbedtls_sha256_starts_ret
+#define SHA256_UPDATE mbedtls_sha256_update_ret
+#define SHA256_FINISH mbedtls_sha256_finish_ret
+#endif
@@ -0,0 +1,463 @@
+#include "amp_relay.h"
+#include "config.h"
+#include "comms.h"
+
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <jacktor_crc.h>
+#include <mbedtls/base64.h>
+#include "sha256_compat.h"
+
+// Frame biner amplifier (lihat firmware/amplifier/include/ota_stream.h):
+// [0xA5][type u8][seq u16][len u16][payload][crc32 u32], little-endian
+static constexpr uint8_t kFrameMagic = 0xA5;
+static constexpr uint8_t kFrameData = 0x01;
+static constexpr size_t kFrameHdr = 6;
+static constexpr size_t kFrameOverhead = kFrameHdr + 4;
+
+static AmpRelayState sState = AmpRelayState::Idle;
+static String sError;
+static String sBeginJson;
+static uint8_t *sImage = nullptr;
+static size_t sCapacity = 0;
+static size_t sStaged = 0;
+
+// Parameter sesi dari begin_ok/resume_ok amplifier
+static uint16_t sFrameMax = 0;
+static uint8_t sWindow = 0;
+
+static uint32_t sBase = 0;      // seq terkecil yang belum di-ack
+static uint32_t sNextSend = 0;  // seq berikutnya yang dikirim pertama kali
+static uint32_t sFrames = 0;    // jumlah frame total
+static uint32_t sRetx[8];       // antrean retransmit selektif
+static uint8_t sRetxCount = 0;
+static uint32_t sLastProgressMs = 0;
+static uint32_t sLastReportMs = 0;
+static uint32_t sStateMs = 0;
+static uint8_t sResumeTries = 0;
+static uint8_t sFrameBuf[kFrameOverhead + AMP_RELAY_FRAME_MAX];
+
+// Upload HTTP berjalan di task AsyncTCP, sedangkan loop() menjalankan relay
+// dan Serial1. Semua state di atas dijaga sLock; perintah ke amplifier dan
+// laporan ke PC hanya dikirim dari loop() (ampRelayTick).
+static SemaphoreHandle_t sLock = nullptr;
+static volatile bool sCommitPending = false;
+static volatile bool sStateDirty = false;
+
+struct RelayLock {
+  RelayLock() { xSemaphoreTakeRecursive(sLock, portMAX_DELAY); }
+  ~RelayLock() { xSemaphoreGiveRecursive(sLock); }
+};
+
+static const char *stateName(AmpRelayState s) {
+  switch (s) {
+    case AmpRelayState::Idle:      return "idle";
+    case AmpRelayState::Staging:   return "staging";
+    case AmpRelayState::Starting:  return "starting";
+    case AmpRelayState::Flashing:  return "flashing";
+    case AmpRelayState::Finishing: return "finishing";
+    case AmpRelayState::Done:      return "done";
+    case AmpRelayState::Failed:    return "failed";
+  }
+  return "unknown";
+}
+
+// Progres ke PC (telemetri bridge, format sama dengan frame lain: satu baris JSON)
+static void report(const char *evt) {
+  JsonDocument doc;
+  doc["type"] = "amp_ota";
+  doc["evt"] = evt;
+  doc["state"] = stateName(sState);
+  doc["staged"] = (uint32_t)sStaged;
+  if (sFrames) {
+    const uint32_t acked = (sBase >= sFrames) ? sStaged : sBase * sFrameMax;
+    doc["acked"] = acked;
+    doc["pct"] = sStaged ? (uint8_t)((uint64_t)acked * 100 / sStaged) : 0;
+  }
+  if (sError.length()) doc["err"] = sError;
+  String out;
+  serializeJson(doc, out);
+  Serial.print(out);
+  Serial.print('\n');
+}
+
+static void setState(AmpRelayState s) {
+  sState = s;
+  sStateMs = millis();
+  sStateDirty = true;  // dilaporkan oleh ampRelayTick
+}
+
+static void releaseImage() {
+  if (sImage) heap_caps_free(sImage);
+  sImage = nullptr;
+  sCapacity = 0;
+}
+
+static void fail(const char *why) {
+  sError = why ? why : "error";
+  releaseImage();
+  setState(AmpRelayState::Failed);
+}
+
+void ampRelayInit() {
+  if (!sLock) sLock = xSemaphoreCreateRecursiveMutex();
+  RelayLock lock;
+  releaseImage();
+  sState = AmpRelayState::Idle;
+  sError = "";
+  sStaged = 0;
+  sFrames = 0;
+  sCommitPending = false;
+}
+
+AmpRelayState ampRelayState() { return sState; }
+void ampRelayLastError(char *out, size_t n) {
+  if (!out || n == 0) return;
+  RelayLock lock;   // sError (String) bisa dialokasi ulang oleh loop()
+  snprintf(out, n, "%s", sError.c_str());
+}
+
+bool ampRelayBusy() {
+  return sState == AmpRelayState::Starting || sState == AmpRelayState::Flashing ||
+         sState == AmpRelayState::Finishing;
+}
+
+bool ampRelayStageBegin(size_t capacity, const String &beginJson) {
+  RelayLock lock;
+  if (ampRelayBusy() || sCommitPending) {
+    sError = "relay busy";
+    return false;
+  }
+  if (capacity == 0 || capacity > AMP_RELAY_STAGE_MAX) {
+    sError = "invalid size";
+    return false;
+  }
+  releaseImage();
+  sImage = static_cast<uint8_t *>(heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  if (!sImage) {
+    sError = "psram alloc";
+    return false;
+  }
+  sCapacity = capacity;
+  sStaged = 0;
+  sFrames = 0;
+  sBeginJson = beginJson;
+  sError = "";
+  sCommitPending = false;
+  setState(AmpRelayState::Staging);
+  return true;
+}
+
+bool ampRelayStageWrite(size_t offset, const uint8_t *data, size_t len) {
+  RelayLock lock;
+  if (sCommitPending) return false;
+  if (sState != AmpRelayState::Staging) return false;
+  if (offset != sStaged) return false;  // data harus berurutan
+  if (len > sCapacity - sStaged) {
+    fail("image too large");
+    return false;
+  }
+  memcpy(sImage + sStaged, data, len);
+  sStaged += len;
+  return true;
+}
+
+// Validasi .bin mentah seperti bootloader (esp_image_format.c): header 24 byte,
+// segmen [addr u32][len u32][data], checksum XOR (awal 0xEF) di byte terakhir
+// blok 16 byte, lalu SHA-256 32 byte bila hash_appended. Panjang harus pas.
+static constexpr size_t kEspHdrLen = 24;
+static constexpr size_t kEspSegHdrLen = 8;
+static constexpr size_t kEspHashAppendedOff = 23;
+static constexpr uint8_t kEspMaxSegments = 16;
+
+static uint32_t rdU32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static const char *checkEspImage(const uint8_t *img, size_t len) {
+  if (len < kEspHdrLen || img[0] != 0xE9) return "not an esp image";
+  const uint8_t segs = img[1];
+  if (segs == 0 || segs > kEspMaxSegments) return "bad segment count";
+  size_t off = kEspHdrLen;
+  uint8_t sum = 0xEF;
+  for (uint8_t i = 0; i < segs; ++i) {
+    if (len - off < kEspSegHdrLen) return "truncated image";
+    const uint32_t segLen = rdU32(img + off + 4);
+    off += kEspSegHdrLen;
+    if (segLen > len - off) return "truncated image";
+    for (uint32_t j = 0; j < segLen; ++j) sum ^= img[off + j];
+    off += segLen;
+  }
+  const size_t padded = (off + 1 + 15) & ~(size_t)15;   // + byte checksum
+  if (padded > len) return "truncated image";
+  if (img[padded - 1] != sum) return "image checksum mismatch";
+  size_t end = padded;
+  if (img[kEspHashAppendedOff] == 1) {
+    if (len - padded < 32) return "truncated image";
+    mbedtls_sha256_context ctx;
+    uint8_t digest[32];
+    mbedtls_sha256_init(&ctx);
+    SHA256_STARTS(&ctx, 0);
+    SHA256_UPDATE(&ctx, img, padded);
+    SHA256_FINISH(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    if (memcmp(digest, img + padded, sizeof(digest)) != 0) return "image sha256 mismatch";
+    end += 32;
+  }
+  return end == len ? nullptr : "image size mismatch";
+}
+
+static void sendAmpCmd(const char *key, JsonVariantConst arg) {
+  JsonDocument doc;
+  doc["type"] = "cmd";
+  doc["id"] = "relay";
+  doc["cmd"][key] = arg;
+  commsSendAmpCommand(doc);
+}
+
+bool ampRelayStageCommit() {
+  RelayLock lock;
+  sCommitPending = false;
+  if (sState != AmpRelayState::Staging) return false;
+  if (sStaged == 0) {
+    fail("empty image");
+    return false;
+  }
+
+  const uint32_t crc = jacktorCrc32(0, sImage, sStaged);
+  JsonDocument begin;
+  if (sBeginJson.length() == 0) {
+    // Image mentah: tidak ada CRC dari pengirim → struktur, checksum & SHA-256
+    // image ESP diverifikasi sendiri sebelum parameter dihitung
+    const char *err = checkEspImage(sImage, sStaged);
+    if (err) {
+      fail(err);
+      return false;
+    }
+    char hex[9];
+    snprintf(hex, sizeof(hex), "%08lx", (unsigned long)crc);
+    begin["size"] = (uint32_t)sStaged;
+    begin["crc32"] = hex;
+  } else {
+    if (deserializeJson(begin, sBeginJson) != DeserializationError::Ok || !begin.is<JsonObject>()) {
+      fail("invalid ota_begin");
+      return false;
+    }
+    // Panjang stream yang dikirim harus sama dengan yang diharapkan amplifier
+    size_t expect = begin["comp"]["size"] | (size_t)(begin["stream_size"] | 0);
+    if (expect == 0) expect = begin["size"] | 0;
+    if (expect != sStaged) {
+      fail("staged size mismatch");
+      return false;
+    }
+    // CRC stream wajib dari pengirim: stage_crc32, atau crc32 image bila
+    // yang dikirim image itu sendiri (tanpa comp/delta)
+    const bool packed = !begin["comp"].isNull() || !begin["stream_size"].isNull() ||
+                        (begin["delta"] | false);
+    const char *stageCrc = begin["stage_crc32"] | nullptr;
+    if (!stageCrc && !packed) stageCrc = begin["crc32"] | nullptr;
+    if (!stageCrc) {
+      fail("stage_crc32 required");
+      return false;
+    }
+    if (strtoul(stageCrc, nullptr, 16) != crc) {
+      fail("staged crc mismatch");
+      return false;
+    }
+    begin.remove("stage_crc32");
+  }
+  begin["mode"] = "bin";
+
+  sResumeTries = 0;
+  sRetxCount = 0;
+  sBase = sNextSend = 0;
+  setState(AmpRelayState::Starting);
+  sendAmpCmd("ota_begin", begin.as<JsonVariantConst>());
+  return true;
+}
+
+bool ampRelayStageFinish() {
+  RelayLock lock;
+  if (sState != AmpRelayState::Staging || sStaged == 0) return false;
+  sCommitPending = true;
+  return true;
+}
+
+bool ampRelayCommitPending() { return sCommitPending; }
+
+void ampRelayAbort(const char *reason) {
+  RelayLock lock;
+  sCommitPending = false;
+  if (ampRelayBusy()) {
+    commsSendAmpCommandRaw("{\"type\":\"cmd\",\"id\":\"relay\",\"cmd\":{\"ota_abort\":true}}");
+  }
+  fail(reason ? reason : "aborted");
+}
+
+// ---- Pengiriman frame ----
+static size_t frameLen(uint32_t seq) {
+  const size_t off = (size_t)seq * sFrameMax;
+  const size_t rem = sStaged - off;
+  return rem < sFrameMax ? rem : sFrameMax;
+}
+
+// Kirim satu frame bila buffer TX UART cukup; false = coba lagi nanti
+static bool sendFrame(uint32_t seq) {
+  const size_t len = frameLen(seq);
+  const size_t total = kFrameOverhead + len;
+  if (commsAmpTxRoom() < total) return false;
+
+  uint8_t *f = sFrameBuf;
+  f[0] = kFrameMagic;
+  f[1] = kFrameData;
+  f[2] = (uint8_t)(seq & 0xFF);
+  f[3] = (uint8_t)((seq >> 8) & 0xFF);
+  f[4] = (uint8_t)(len & 0xFF);
+  f[5] = (uint8_t)(len >> 8);
+  memcpy(f + kFrameHdr, sImage + (size_t)seq * sFrameMax, len);
+  const uint32_t crc = jacktorCrc32(0, f, kFrameHdr + len);
+  for (int i = 0; i < 4; ++i) f[kFrameHdr + len + i] = (uint8_t)(crc >> (8 * i));
+  commsSendAmpBytes(f, total);
+  return true;
+}
+
+static uint32_t expand16(uint16_t seq) {
+  return sBase + (uint32_t)(int32_t)(int16_t)(uint16_t)(seq - (uint16_t)sBase);
+}
+
+static void onSessionParams(JsonDocument &doc) {
+  sFrameMax = doc["frame_max"] | 0;
+  sWindow = doc["window"] | 0;
+  if (sFrameMax == 0 || sFrameMax > AMP_RELAY_FRAME_MAX || sWindow == 0) {
+    ampRelayAbort("unsupported session");
+    return;
+  }
+  if (sWindow > sizeof(sRetx) / sizeof(sRetx[0])) sWindow = sizeof(sRetx) / sizeof(sRetx[0]);
+  sFrames = (uint32_t)((sStaged + sFrameMax - 1) / sFrameMax);
+  const size_t offset = doc["offset"] | 0;
+  sBase = sNextSend = (uint32_t)(offset / sFrameMax);
+  sRetxCount = 0;
+  sLastProgressMs = millis();
+  setState(AmpRelayState::Flashing);
+}
+
+void ampRelayHandleAmpFrame(JsonDocument &doc) {
+  RelayLock lock;
+  if (!ampRelayBusy()) return;
+  const char *evt = doc["evt"] | "";
+
+  if (strcmp(evt, "begin_ok") == 0 || strcmp(evt, "resume_ok") == 0) {
+    onSessionParams(doc);
+  } else if (strcmp(evt, "bin_ack") == 0) {
+    const uint32_t next = expand16(doc["next"] | 0);
+    if ((int32_t)(next - sBase) > 0) {
+      sBase = next;
+      sLastProgressMs = millis();
+      sResumeTries = 0;
+    }
+  } else if (strcmp(evt, "bin_nak") == 0) {
+    for (JsonVariant v : doc["missing"].as<JsonArray>()) {
+      const uint32_t seq = expand16(v.as<uint16_t>());
+      if ((int32_t)(seq - sBase) < 0 || (int32_t)(seq - sNextSend) >= 0) continue;
+      if (sRetxCount < sizeof(sRetx) / sizeof(sRetx[0])) sRetx[sRetxCount++] = seq;
+    }
+  } else if (strcmp(evt, "bin_exit") == 0) {
+    const char *reason = doc["reason"] | "";
+    if (strcmp(reason, "complete") == 0) {
+      setState(AmpRelayState::Finishing);
+      JsonDocument arg;
+      arg["reboot"] = true;
+      sendAmpCmd("ota_end", arg.as<JsonVariantConst>());
+    } else if (sResumeTries++ < AMP_RELAY_RESUME_TRIES) {
+      // Link sempat macet: lanjutkan dari posisi terakhir yang ter-commit
+      setState(AmpRelayState::Starting);
+      JsonDocument arg;
+      arg["mode"] = "bin";
+      sendAmpCmd("ota_resume", arg.as<JsonVariantConst>());
+    } else {
+      ampRelayAbort(reason);
+    }
+  } else if (strcmp(evt, "end_ok") == 0) {
+    releaseImage();
+    setState(AmpRelayState::Done);
+  } else if (strcmp(evt, "begin_err") == 0 || strcmp(evt, "end_err") == 0 ||
+             strcmp(evt, "resume_err") == 0 || strcmp(evt, "error") == 0) {
+    fail(doc["err"] | evt);
+  }
+}
+
+void ampRelayTick(uint32_t nowMs) {
+  RelayLock lock;
+  if (sCommitPending) ampRelayStageCommit();
+
+  if (sState == AmpRelayState::Flashing) {
+    // Retransmit selektif dulu, lalu frame baru selama window masih ada
+    while (sRetxCount > 0) {
+      if (!sendFrame(sRetx[0])) break;
+      memmove(sRetx, sRetx + 1, (sRetxCount - 1) * sizeof(sRetx[0]));
+      --sRetxCount;
+    }
+    while (sRetxCount == 0 && sNextSend < sFrames && sNextSend - sBase < sWindow) {
+      if (!sendFrame(sNextSend)) break;
+      ++sNextSend;
+    }
+    // Tidak ada ack: ulangi semua frame yang masih terbuka
+    if (nowMs - sLastProgressMs > AMP_RELAY_ACK_TIMEOUT_MS) {
+      sNextSend = sBase;
+      sRetxCount = 0;
+      sLastProgressMs = nowMs;
+    }
+  } else if ((sState == AmpRelayState::Starting || sState == AmpRelayState::Finishing) &&
+             nowMs - sStateMs > AMP_RELAY_REPLY_TIMEOUT_MS) {
+    ampRelayAbort("amp timeout");
+  }
+
+  if (ampRelayBusy() && nowMs - sLastReportMs >= AMP_RELAY_REPORT_MS) {
+    sLastReportMs = nowMs;
+    report("progress");
+  }
+  if (sStateDirty) {
+    sStateDirty = false;
+    report("state");
+  }
+}
+
+// ---- Jalur USB: {"type":"amp_ota","op":"begin|data|commit|abort|status"} ----
+void ampRelayHandleHostFrame(JsonDocument &doc) {
+  RelayLock lock;
+  const char *op = doc["op"] | "";
+  bool ok = true;
+
+  if (strcmp(op, "begin") == 0) {
+    String beginJson;
+    if (!doc["ota_begin"].isNull()) serializeJson(doc["ota_begin"], beginJson);
+    ok = ampRelayStageBegin(doc["size"] | 0, beginJson);
+  } else if (strcmp(op, "data") == 0) {
+    const char *b64 = doc["data_b64"] | "";
+    size_t outLen = 0;
+    static uint8_t buf[BRIDGE_MAX_FRAME];
+    ok = mbedtls_base64_decode(buf, sizeof(buf), &outLen,
+                               reinterpret_cast<const unsigned char *>(b64), strlen(b64)) == 0 &&
+         ampRelayStageWrite(doc["off"] | 0, buf, outLen);
+    if (ok) {
+      // Ack ringkas per chunk supaya PC bisa mengatur laju
+      String out = String("{\"type\":\"amp_ota\",\"evt\":\"data_ok\",\"next\":") + (uint32_t)sStaged + "}";
+      Serial.print(out);
+      Serial.print('\n');
+      return;
+    }
+    if (sError.length() == 0) sError = "data";
+  } else if (strcmp(op, "commit") == 0) {
+    ok = ampRelayStageCommit();
+  } else if (strcmp(op, "abort") == 0) {
+    ampRelayAbort("aborted");
+  } else if (strcmp(op, "status") == 0) {
+    report("status");
+    return;
+  } else {
+    ok = false;
+    sError = "invalid op";
+  }
+  report(ok ? "ok" : "err");
+}
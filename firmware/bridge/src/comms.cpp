@@ -1,12 +1,19 @@
 #include "comms.h"
 #include "config.h"
 #include "display.h"
+#include "amp_relay.h"
 #include "USB.h"
 
 String hostRxBuffer;
 String ampRxBuffer;
 String lastAmpTelemetry;
 
+// OTA biner amplifier: selama aktif, byte dari host diteruskan mentah ke Amp
+// (tanpa pemotongan baris). Diaktifkan oleh begin_ok {"mode":"bin"}, selesai
+// saat Amp mengirim bin_exit atau host diam terlalu lama.
+static bool ampBinPassthrough = false;
+static uint32_t ampBinLastMs = 0;
+
 // Anti-spam debounce timers for USB events
 static uint32_t last_usb_suspend_ms = 0;
 static uint32_t last_usb_resume_ms = 0;
@@ -35,6 +42,7 @@ static void usbEventCallback(void* arg, esp_event_base_t event_base, int32_t eve
 
 void commsInit() {
   Serial.begin(HOST_SERIAL_BAUD); // USB CDC Native
+  Serial1.setTxBufferSize(AMP_TX_BUF_SIZE);
   Serial1.begin(AMP_SERIAL_BAUD, SERIAL_8N1, PIN_UART_AMP_RX, PIN_UART_AMP_TX);
 
   USB.onEvent(usbEventCallback);
@@ -48,6 +56,14 @@ void commsSendAmpCommandRaw(const String &jsonStr) {
   Serial1.print('\n');
 }
 
+void commsSendAmpBytes(const uint8_t *data, size_t len) {
+  Serial1.write(data, len);
+}
+
+size_t commsAmpTxRoom() {
+  return (size_t)Serial1.availableForWrite();
+}
+
 void commsSendAmpCommand(JsonDocument &doc) {
   String out;
   serializeJson(doc, out);
@@ -67,6 +83,25 @@ static void handleAmpFrame(const String &line) {
     if (strcmp(type, "telemetry") == 0) {
       lastAmpTelemetry = line;
       displayUpdateTelemetry(doc);
+    } else if (strcmp(type, "link") == 0 && strcmp(doc["evt"] | "", "probe") == 0) {
+      // Health check OTA amplifier: bukti link UART hidup walau tanpa PC/panel
+      if (!ampRelayBusy() && !ampBinPassthrough) {
+        commsSendAmpCommandRaw("{\"type\":\"link\",\"evt\":\"probe_ack\"}");
+      }
+    } else if (strcmp(type, "ota") == 0 && ampRelayBusy()) {
+      ampRelayHandleAmpFrame(doc);  // sesi milik relay, bukan passthrough PC
+    } else if (strcmp(type, "ota") == 0) {
+      const char *evt = doc["evt"] | "";
+      const char *mode = doc["mode"] | "";
+      // ota_resume {"mode":"bin"} juga mengembalikan amp ke mode biner
+      const bool binSession = strcmp(evt, "begin_ok") == 0 || strcmp(evt, "resume_ok") == 0;
+      if (binSession && strcmp(mode, "bin") == 0) {
+        ampBinPassthrough = true;
+        ampBinLastMs = millis();
+        hostRxBuffer = "";
+      } else if (strcmp(evt, "bin_exit") == 0) {
+        ampBinPassthrough = false;
+      }
     }
   }
 }
@@ -75,15 +110,24 @@ static void handleHostFrame(const String &line) {
   // Parsing json utk kontrol, atau cuma redirect ke Amp
   // tools/esp32_monitor dkk mengirim json format 'cmd'
   // atau command baris.
-  if (line.startsWith("{")) {
-    commsSendAmpCommandRaw(line); // forward as it is ke amplifier
+  if (!line.startsWith("{")) return;
+  if (line.indexOf("\"amp_ota\"") >= 0) {
+    JsonDocument doc;
+    if (deserializeJson(doc, line) == DeserializationError::Ok &&
+        strcmp(doc["type"] | "", "amp_ota") == 0) {
+      ampRelayHandleHostFrame(doc);
+      return;
+    }
   }
+  // Selama relay mem-flash, link Amp dalam mode biner: jangan sisipkan JSON
+  if (ampRelayBusy()) return;
+  commsSendAmpCommandRaw(line); // forward as it is ke amplifier
 }
 
 void commsTick(uint32_t now) {
   // --- Handle USB Events with Debounce ---
   // Jika suspend bertahan > 2 detik tanpa diselingi resume (stabil)
-  if (pending_suspend && (now - last_usb_suspend_ms > 2000)) {
+  if (pending_suspend && (now - last_usb_suspend_ms > 2000) && !ampRelayBusy()) {
       pending_suspend = false;
       displaySetBacklight(false);
       JsonDocument doc;
@@ -93,7 +137,7 @@ void commsTick(uint32_t now) {
   }
 
   // Jika resume bertahan > 1 detik tanpa diselingi suspend (stabil)
-  if (pending_resume && (now - last_usb_resume_ms > 1000)) {
+  if (pending_resume && (now - last_usb_resume_ms > 1000) && !ampRelayBusy()) {
       pending_resume = false;
       displaySetBacklight(true);
       JsonDocument doc;
@@ -123,6 +167,21 @@ void commsTick(uint32_t now) {
   // kita nonaktifkan pengiriman auto power off dari Bridge ini.
   // Biarkan fitur PC Detect ditangani murni dari input hardware PC_DETECT_PIN di unit Amplifier secara mandiri.
 
+  if (ampBinPassthrough) {
+    uint8_t chunk[256];
+    // Baca hanya yang sudah ada: readBytes() menunggu Stream timeout bila kurang
+    int avail;
+    while ((avail = Serial.available()) > 0) {
+      const size_t want = (size_t)avail < sizeof(chunk) ? (size_t)avail : sizeof(chunk);
+      size_t n = Serial.readBytes(chunk, want);
+      if (n == 0) break;
+      Serial1.write(chunk, n);
+      ampBinLastMs = now;
+    }
+    if (now - ampBinLastMs > AMP_BIN_IDLE_MS) ampBinPassthrough = false;
+    return;
+  }
+
   while (Serial.available()) {
     char c = static_cast<char>(Serial.read());
     if (c == '\r') continue;
@@ -6,6 +6,8 @@ void commsInit();
 void commsTick(uint32_t now);
 void commsSendAmpCommand(JsonDocument &doc);
 void commsSendAmpCommandRaw(const String &jsonStr);
+void commsSendAmpBytes(const uint8_t *data, size_t len);
+size_t commsAmpTxRoom();
 extern String lastAmpTelemetry;
 // Add declaration for displayBootLog wrapper inside comms/net so they dont directly include LVGL/display if not needed
 // actually we already included display.h so it's fine
@@ -3,10 +3,12 @@
 #include "comms.h"
 #include "display.h"
 #include "net.h"
+#include "amp_relay.h"
 
 void setup() {
   displayInit(); // Tampilkan boot log pertama
   commsInit();
+  ampRelayInit();
   displayBootLog("[ OK ] Comms (UART & USB CDC) Initialized");
 
   netInit(); // Inisiasi Wi-Fi & Web OTA server
@@ -21,6 +23,7 @@ void setup() {
 void loop() {
   uint32_t now = millis();
   commsTick(now);
+  ampRelayTick(now);
   netTick(now);
   displayTick(now);
 }
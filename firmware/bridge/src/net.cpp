@@ -6,6 +6,7 @@
 #include <Update.h>
 #include "display.h"
 #include "comms.h"
+#include "amp_relay.h"
 
 static AsyncWebServer server(80);
 static Preferences prefs;
@@ -66,6 +67,40 @@ void netInit() {
     }
   });
 
+  // Image amplifier: di-stage di PSRAM lalu di-flash oleh relay.
+  // Query "begin" (opsional) = objek ota_begin dari tools/ota_pack.py.
+  // Callback upload jalan di task AsyncTCP: hanya menyalin data; verifikasi
+  // dan ota_begin ke amplifier dijalankan ampRelayTick di loop().
+  // _tempObject != NULL menandai upload yang ditolak (pesan error).
+  server.on("/amp/update", HTTP_POST, [](AsyncWebServerRequest *request){
+    if (request->_tempObject) {
+      request->send(500, "text/plain", static_cast<const char *>(request->_tempObject));
+      return;
+    }
+    if (ampRelayCommitPending()) {
+      request->send(202, "text/plain", "STAGED");
+      return;
+    }
+    char err[64];
+    ampRelayLastError(err, sizeof(err));
+    request->send(500, "text/plain", err);
+  }, [](AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final){
+    if (!index) {
+      String begin = request->hasParam("begin") ? request->getParam("begin")->value() : String();
+      if (!ampRelayStageBegin(request->contentLength(), begin)) {
+        char err[64];
+        ampRelayLastError(err, sizeof(err));
+        request->_tempObject = strdup(err);
+      }
+    }
+    if (request->_tempObject) return;  // begin ditolak: sisa upload dibuang
+    if (!ampRelayStageWrite(index, data, len)) {
+      request->_tempObject = strdup("stage write failed");
+      return;
+    }
+    if (final && !ampRelayStageFinish()) request->_tempObject = strdup("empty image");
+  });
+
   server.begin();
   displayBootLog("[ OK ] Web Server started for OTA.");
 }
@@ -1,6 +1,7 @@
 #include "ota_panel.h"
 
 #include <Update.h>
+#include <jacktor_crc.h>
 
 static PanelOtaStatus sStatus = PanelOtaStatus::Idle;
 static String         sError;
@@ -11,31 +12,6 @@ static uint32_t       sRunningCrc   = 0;
 static bool           sRebootPending = false;
 static uint32_t       sRebootAtMs    = 0;
 
-static uint32_t crc32_update(uint32_t crc, const uint8_t *buf, size_t len) {
-  static uint32_t table[256];
-  static bool tableInit = false;
-  if (!tableInit) {
-    for (uint32_t i = 0; i < 256; ++i) {
-      uint32_t c = i;
-      for (int j = 0; j < 8; ++j) {
-        if (c & 1U) {
-          c = 0xEDB88320UL ^ (c >> 1);
-        } else {
-          c >>= 1;
-        }
-      }
-      table[i] = c;
-    }
-    tableInit = true;
-  }
-
-  crc = ~crc;
-  for (size_t i = 0; i < len; ++i) {
-    crc = table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
-  }
-  return ~crc;
-}
-
 static void resetState() {
   sStatus = PanelOtaStatus::Idle;
   sError = "";
@@ -120,7 +96,7 @@ int panelOtaWrite(const uint8_t *data, size_t len) {
 
   sWritten += w;
   if (sExpectedCrc != 0) {
-    sRunningCrc = crc32_update(sRunningCrc, data, w);
+    sRunningCrc = jacktorCrc32(sRunningCrc, data, w);
   }
   return static_cast<int>(w);
 }
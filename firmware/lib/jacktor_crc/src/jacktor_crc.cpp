@@ -0,0 +1,70 @@
+#include "jacktor_crc.h"
+
+#if defined(ESP_PLATFORM) && __has_include(<esp_rom_crc.h>)
+#include <esp_rom_crc.h>
+#define JACKTOR_CRC_ROM 1
+#else
+#define JACKTOR_CRC_ROM 0
+#endif
+
+#if JACKTOR_CRC_ROM
+
+uint32_t jacktorCrc32(uint32_t crc, const void *data, size_t len) {
+  if (!data || len == 0) return crc;
+  // ROM crc32_le sudah melakukan inversi awal/akhir seperti zlib
+  return esp_rom_crc32_le(crc, static_cast<const uint8_t *>(data), (uint32_t)len);
+}
+
+#else
+
+namespace {
+
+struct Crc32Tables {
+  uint32_t t[8][256];
+};
+
+// Tabel slicing-by-8 dibangun saat kompilasi (tanpa init lazy di runtime)
+constexpr Crc32Tables makeTables() {
+  Crc32Tables r{};
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t c = i;
+    for (int j = 0; j < 8; ++j) c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+    r.t[0][i] = c;
+  }
+  for (int k = 1; k < 8; ++k) {
+    for (uint32_t i = 0; i < 256; ++i) {
+      const uint32_t prev = r.t[k - 1][i];
+      r.t[k][i] = (prev >> 8) ^ r.t[0][prev & 0xFF];
+    }
+  }
+  return r;
+}
+
+constexpr Crc32Tables kTables = makeTables();
+
+static_assert(kTables.t[0][1] == 0x77073096u, "tabel CRC32 salah");
+
+inline uint32_t rdLe32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+}  // namespace
+
+uint32_t jacktorCrc32(uint32_t crc, const void *data, size_t len) {
+  if (!data || len == 0) return crc;
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  const auto &t = kTables.t;
+  crc = ~crc;
+  while (len >= 8) {
+    const uint32_t one = rdLe32(p) ^ crc;
+    const uint32_t two = rdLe32(p + 4);
+    crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+          t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+    p += 8;
+    len -= 8;
+  }
+  while (len--) crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+#endif
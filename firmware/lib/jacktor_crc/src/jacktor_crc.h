@@ -0,0 +1,10 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC32 IEEE 802.3 (reflected, poly 0xEDB88320), kompatibel zlib/binascii.crc32.
+// Inkremental: mulai dengan crc = 0, lalu umpankan hasil sebelumnya.
+//   uint32_t c = jacktorCrc32(0, a, na);
+//   c = jacktorCrc32(c, b, nb);
+// Di ESP32 memakai crc32_le dari ROM; di tempat lain (host) slicing-by-8.
+uint32_t jacktorCrc32(uint32_t crc, const void *data, size_t len);
@@ -0,0 +1,203 @@
+# -*- coding: utf-8 -*-
+
+"""
+Capture Dump - Jacktor Audio Amplifier
+
+Mengunduh & mendekode capture pra-trigger (ring SMPS/12V/suhu yang beku saat
+proteksi trip atau reset tak terduga) untuk analisis brown-out tanpa kunjungan
+ke lokasi.
+
+Subcommand:
+  fetch   : cap_info + cap_read berulang → file .bin (CRC32 diverifikasi)
+  decode  : .bin → ringkasan + CSV (t_ms relatif trigger, channel, nilai)
+  arm     : buang dump di amplifier & jalankan ring lagi
+
+Contoh:
+  python tools/cap_dump.py fetch /dev/ttyUSB0 cap.bin --csv cap.csv
+  python tools/cap_dump.py decode cap.bin --csv cap.csv
+  python tools/cap_dump.py arm /dev/ttyUSB0
+"""
+
+import argparse
+import base64
+import csv
+import json
+import struct
+import sys
+import time
+import zlib
+
+# Harus sama dengan CaptureHeader di firmware/amplifier/include/capture.h
+HEADER_FMT = "<IBBBBIIHHHHII"
+HEADER_LEN = struct.calcsize(HEADER_FMT)
+MAGIC = 0x5041434A  # "JCAP"
+READ_MAX = 1344     # AUDIT_READ_MAX firmware
+
+CHANNELS = {0: ("smps_v", 0.01), 1: ("v12_v", 0.001), 2: ("heat_c", 0.01)}
+REASONS = ["none", "smps_low", "smps_hw_fault", "otp", "reset", "manual"]
+STATES = ["armed", "triggered", "frozen"]
+
+
+class CapLink:
+    """Baris JSON ke/dari amplifier; hanya frame type "cap" yang dikembalikan."""
+
+    def __init__(self, port, baud):
+        import serial
+        self.ser = serial.Serial(port, baud, timeout=0.05)
+        self.ser.reset_input_buffer()
+        self.buf = b""
+
+    def send(self, cmd):
+        line = json.dumps({"type": "cmd", "cmd": cmd}, separators=(",", ":"))
+        self.ser.write(line.encode() + b"\n")
+
+    def recv(self, evts, timeout):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            nl = self.buf.find(b"\n")
+            if nl < 0:
+                self.buf += self.ser.read(self.ser.in_waiting or 1)
+                continue
+            line, self.buf = self.buf[:nl], self.buf[nl + 1:]
+            try:
+                msg = json.loads(line)
+            except ValueError:
+                continue
+            if isinstance(msg, dict) and msg.get("type") == "cap" and msg.get("evt") in evts:
+                return msg
+        return None
+
+
+def parse_image(data):
+    if len(data) < HEADER_LEN:
+        raise ValueError("image terlalu pendek")
+    (magic, version, state, reason, rst, trig_ms, last_ms, _head, count,
+     trig_idx, rec_size, _res, crc) = struct.unpack_from(HEADER_FMT, data)
+    if magic != MAGIC or version != 1 or rec_size != 4:
+        raise ValueError("header capture tidak dikenal")
+    if len(data) != HEADER_LEN + count * rec_size:
+        raise ValueError("panjang image tidak cocok dengan jumlah record")
+    calc = zlib.crc32(data[:HEADER_LEN - 4] + b"\0\0\0\0" + data[HEADER_LEN:])
+    if calc != crc:
+        raise ValueError(f"CRC32 salah (header {crc:08x}, hitung {calc:08x})")
+
+    # millis 14 bit di-unwrap mundur dari last_ms (jarak antar record < 16 s)
+    records = []
+    ms = last_ms
+    prev_lo = last_ms & 0x3FFF
+    for i in range(count - 1, -1, -1):
+        tc, raw = struct.unpack_from("<Hh", data, HEADER_LEN + 4 * i)
+        lo = tc & 0x3FFF
+        ms -= (prev_lo - lo) & 0x3FFF
+        prev_lo = lo
+        name, scale = CHANNELS.get(tc >> 14, ("?", 1.0))
+        value = None if raw == -32768 else raw * scale
+        records.append((ms, name, value))
+    records.reverse()
+
+    info = {
+        "state": STATES[state] if state < len(STATES) else state,
+        "reason": REASONS[reason] if reason < len(REASONS) else reason,
+        "rst": rst,
+        "trig_ms": trig_ms,
+        "records": count,
+        "trig_idx": trig_idx,
+        "span_ms": (records[-1][0] - records[0][0]) if records else 0,
+    }
+    return info, records
+
+
+def write_csv(path, info, records):
+    with open(path, "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(["t_ms", "channel", "value"])
+        for ms, name, value in records:
+            w.writerow([ms - info["trig_ms"], name, "" if value is None else f"{value:.3f}"])
+
+
+def summarize(info, records):
+    print(json.dumps(info))
+    for name, _ in CHANNELS.values():
+        vals = [v for _, n, v in records if n == name and v is not None]
+        if vals:
+            print(f"  {name:7s} n={len(vals):5d} min={min(vals):8.3f} max={max(vals):8.3f}")
+
+
+def cmd_fetch(args):
+    link = CapLink(args.port, args.baud)
+    link.send({"cap_info": True})
+    info = link.recv(("info",), args.timeout)
+    if not info:
+        print("tidak ada respons cap_info", file=sys.stderr)
+        return 1
+    if info.get("state") != "frozen":
+        print(f"capture belum beku: {info}", file=sys.stderr)
+        return 1
+
+    total = info["bytes"]
+    data = bytearray()
+    while len(data) < total:
+        n = min(args.chunk, total - len(data))
+        link.send({"cap_read": {"offset": len(data), "len": n}})
+        msg = link.recv(("read", "read_err"), args.timeout)
+        if not msg or msg["evt"] != "read" or msg.get("offset") != len(data):
+            print(f"cap_read gagal di offset {len(data)}: {msg}", file=sys.stderr)
+            return 1
+        data += base64.b64decode(msg["data_b64"])
+
+    with open(args.output, "wb") as f:
+        f.write(data)
+    dec, records = parse_image(bytes(data))
+    summarize(dec, records)
+    if args.csv:
+        write_csv(args.csv, dec, records)
+    return 0
+
+
+def cmd_decode(args):
+    with open(args.input, "rb") as f:
+        info, records = parse_image(f.read())
+    summarize(info, records)
+    if args.csv:
+        write_csv(args.csv, info, records)
+    return 0
+
+
+def cmd_arm(args):
+    link = CapLink(args.port, args.baud)
+    link.send({"cap_arm": True})
+    msg = link.recv(("arm_ok", "arm_err"), args.timeout)
+    print(json.dumps(msg))
+    return 0 if msg and msg["evt"] == "arm_ok" else 1
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Unduh & dekode capture brown-out Jacktor Audio")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("fetch", help="unduh capture beku ke file .bin")
+    p.add_argument("port", help="port serial amplifier (mis. /dev/ttyUSB0, COM5)")
+    p.add_argument("output")
+    p.add_argument("--csv", help="sekalian tulis CSV hasil dekode")
+    p.add_argument("-b", "--baud", type=int, default=921600)
+    p.add_argument("-c", "--chunk", type=int, default=READ_MAX, help="byte per cap_read")
+    p.add_argument("--timeout", type=float, default=2.0)
+    p.set_defaults(func=cmd_fetch)
+
+    p = sub.add_parser("decode", help="dekode file .bin")
+    p.add_argument("input")
+    p.add_argument("--csv")
+    p.set_defaults(func=cmd_decode)
+
+    p = sub.add_parser("arm", help="buang dump & jalankan ring lagi")
+    p.add_argument("port")
+    p.add_argument("-b", "--baud", type=int, default=921600)
+    p.add_argument("--timeout", type=float, default=2.0)
+    p.set_defaults(func=cmd_arm)
+
+    args = ap.parse_args(argv)
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,684 @@
+# -*- coding: utf-8 -*-
+
+"""
+OTA Pack - Jacktor Audio Amplifier
+
+Menyiapkan image firmware untuk OTA via UART/Bridge.
+
+Subcommand:
+  compress  : kompres .bin dengan heatshrink (LZSS) untuk ota_begin "comp"
+  delta     : patch (gaya bsdiff) dari firmware yang sedang berjalan ke image baru
+  info      : tampilkan ukuran & CRC32 image (parameter ota_begin mentah)
+  keygen    : buat kunci ECDSA P-256 + include/ota_pubkey.h untuk firmware
+  sign      : tempel trailer tanda tangan JSIG (lakukan sebelum compress/delta)
+  bench     : ukur throughput upload OTA (jalur JSON) untuk beberapa ukuran chunk
+
+Contoh:
+  python tools/ota_pack.py compress firmware.bin firmware.hs -w 10 -l 5
+  → menulis firmware.hs dan mencetak payload ota_begin yang sesuai.
+  python tools/ota_pack.py delta running.bin firmware.bin firmware.jdp
+  → menulis patch (default terkompresi heatshrink) + payload ota_begin delta.
+  python tools/ota_pack.py sign firmware.bin firmware.signed.bin -k ota_sign_key.pem
+  → image + trailer 128 byte; compress/delta/info otomatis menambah "sig":true.
+  python tools/ota_pack.py bench /dev/ttyUSB0 firmware.bin -c 256,512,1024,2048
+  → upload berulang lalu ota_abort (partisi boot tidak berubah), cetak KiB/s.
+"""
+
+import argparse
+import base64
+import hashlib
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+import zlib
+
+
+# ---------------------------------------------------------------------------
+# Heatshrink encoder (format kompatibel decoder referensi & ota_decomp.cpp)
+#   literal : bit 1 + 8 bit byte
+#   backref : bit 0 + W bit (offset-1) + L bit (panjang-1), MSB dulu
+# ---------------------------------------------------------------------------
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.nbits = 0
+
+    def put(self, value, bits):
+        self.acc = (self.acc << bits) | (value & ((1 << bits) - 1))
+        self.nbits += bits
+        while self.nbits >= 8:
+            self.nbits -= 8
+            self.out.append((self.acc >> self.nbits) & 0xFF)
+        self.acc &= (1 << self.nbits) - 1
+
+    def finish(self):
+        if self.nbits:
+            self.out.append((self.acc << (8 - self.nbits)) & 0xFF)
+            self.nbits = 0
+            self.acc = 0
+        return bytes(self.out)
+
+
+def heatshrink_compress(data, window_bits=10, lookahead_bits=5, chain_limit=32):
+    if not 4 <= window_bits <= 15 or not 3 <= lookahead_bits < window_bits:
+        raise ValueError("parameter heatshrink tidak valid")
+    max_off = 1 << window_bits
+    max_len = 1 << lookahead_bits
+    # Backref hanya menguntungkan bila lebih hemat dari literal (9 bit/byte)
+    br_bits = 1 + window_bits + lookahead_bits
+    min_len = br_bits // 9 + 1
+
+    bw = BitWriter()
+    heads = {}
+    n = len(data)
+    i = 0
+
+    def insert(pos):
+        if pos + 3 <= n:
+            key = data[pos:pos + 3]
+            chain = heads.get(key)
+            if chain is None:
+                heads[key] = [pos]
+            else:
+                chain.append(pos)
+                if len(chain) > chain_limit * 4:
+                    del chain[:-chain_limit]
+
+    while i < n:
+        best_len = 0
+        best_off = 0
+        if i + 3 <= n:
+            chain = heads.get(data[i:i + 3])
+            if chain:
+                limit = min(max_len, n - i)
+                for cand in reversed(chain[-chain_limit:]):
+                    off = i - cand
+                    if off > max_off:
+                        break
+                    length = 3
+                    while length < limit and data[cand + length] == data[i + length]:
+                        length += 1
+                    if length > best_len:
+                        best_len = length
+                        best_off = off
+                        if length == limit:
+                            break
+
+        if best_len >= max(min_len, 3):
+            bw.put(0, 1)
+            bw.put(best_off - 1, window_bits)
+            bw.put(best_len - 1, lookahead_bits)
+            for k in range(best_len):
+                insert(i + k)
+            i += best_len
+        else:
+            bw.put(1, 1)
+            bw.put(data[i], 8)
+            insert(i)
+            i += 1
+
+    return bw.finish()
+
+
+def heatshrink_decompress(data, window_bits, lookahead_bits):
+    """Decoder acuan (dipakai untuk verifikasi setelah kompresi)."""
+    out = bytearray()
+    acc = 0
+    nbits = 0
+    pos = 0
+
+    def take(bits):
+        nonlocal acc, nbits, pos
+        while nbits < bits:
+            if pos >= len(data):
+                return None
+            acc = (acc << 8) | data[pos]
+            pos += 1
+            nbits += 8
+        nbits -= bits
+        v = (acc >> nbits) & ((1 << bits) - 1)
+        acc &= (1 << nbits) - 1
+        return v
+
+    while True:
+        tag = take(1)
+        if tag is None:
+            break
+        if tag:
+            b = take(8)
+            if b is None:
+                break
+            out.append(b)
+        else:
+            idx = take(window_bits)
+            cnt = take(lookahead_bits) if idx is not None else None
+            if cnt is None:
+                break
+            off = idx + 1
+            for _ in range(cnt + 1):
+                out.append(out[-off] if off <= len(out) else 0)
+    return bytes(out)
+
+
+# ---------------------------------------------------------------------------
+# Delta (format "JDP1", lihat firmware/amplifier/include/ota_delta.h)
+#   berulang: varint diff_len, varint extra_len, zigzag-varint seek,
+#             diff (new - old, mod 256), extra (literal)
+# Pencarian match memakai indeks hash k-gram atas image lama; penentuan
+# batas diff/extra mengikuti heuristik bsdiff (skor kecocokan maju/mundur).
+# ---------------------------------------------------------------------------
+DELTA_MAGIC = b"JDP1"
+DELTA_KEY = 8
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        b = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def zigzag(value):
+    return (value << 1) ^ (value >> 63)
+
+
+def common_prefix(a, ai, b, bi, limit):
+    """Panjang prefix sama a[ai:] vs b[bi:] (maks. limit), per blok lalu per byte."""
+    n = 0
+    step = 256
+    while n < limit:
+        k = min(step, limit - n)
+        if a[ai + n:ai + n + k] == b[bi + n:bi + n + k]:
+            n += k
+            continue
+        if k == 1:
+            break
+        step = max(1, k // 4)
+    return n
+
+
+class MatchIndex:
+    def __init__(self, old, chain_limit=16):
+        self.old = old
+        self.chain_limit = chain_limit
+        self.table = {}
+        for i in range(0, len(old) - DELTA_KEY + 1):
+            key = old[i:i + DELTA_KEY]
+            chain = self.table.get(key)
+            if chain is None:
+                self.table[key] = [i]
+            elif len(chain) < chain_limit:
+                chain.append(i)
+
+    def search(self, new, pos):
+        """Match terpanjang untuk new[pos:] di image lama → (panjang, posisi lama)."""
+        if pos + DELTA_KEY > len(new):
+            return 0, 0
+        chain = self.table.get(new[pos:pos + DELTA_KEY])
+        if not chain:
+            return 0, 0
+        best_len, best_pos = 0, 0
+        limit = len(new) - pos
+        for cand in chain:
+            n = common_prefix(self.old, cand, new, pos, min(limit, len(self.old) - cand))
+            if n > best_len:
+                best_len, best_pos = n, cand
+        return best_len, best_pos
+
+
+def delta_encode(old, new):
+    index = MatchIndex(old)
+    oldsize, newsize = len(old), len(new)
+    out = bytearray(DELTA_MAGIC)
+
+    scan = lastscan = lastpos = lastoffset = 0
+    length = pos = 0
+    while scan < newsize:
+        oldscore = 0
+        scan += length
+        scsc = scan
+        while scan < newsize:
+            length, pos = index.search(new, scan)
+            while scsc < scan + length:
+                if scsc + lastoffset < oldsize and old[scsc + lastoffset] == new[scsc]:
+                    oldscore += 1
+                scsc += 1
+            if (length == oldscore and length != 0) or length > oldscore + 8:
+                break
+            if scan + lastoffset < oldsize and old[scan + lastoffset] == new[scan]:
+                oldscore -= 1
+            scan += 1
+
+        if length != oldscore or scan == newsize:
+            s = sf = lenf = 0
+            i = 0
+            while lastscan + i < scan and lastpos + i < oldsize:
+                if old[lastpos + i] == new[lastscan + i]:
+                    s += 1
+                i += 1
+                if s * 2 - i > sf * 2 - lenf:
+                    sf, lenf = s, i
+
+            lenb = 0
+            if scan < newsize:
+                s = sb = 0
+                i = 1
+                while scan >= lastscan + i and pos >= i:
+                    if old[pos - i] == new[scan - i]:
+                        s += 1
+                    if s * 2 - i > sb * 2 - lenb:
+                        sb, lenb = s, i
+                    i += 1
+
+            if lastscan + lenf > scan - lenb:
+                overlap = (lastscan + lenf) - (scan - lenb)
+                s = ss = lens = 0
+                for i in range(overlap):
+                    if new[lastscan + lenf - overlap + i] == old[lastpos + lenf - overlap + i]:
+                        s += 1
+                    if new[scan - lenb + i] == old[pos - lenb + i]:
+                        s -= 1
+                    if s > ss:
+                        ss, lens = s, i + 1
+                lenf += lens - overlap
+                lenb -= lens
+
+            extra_start = lastscan + lenf
+            extra_len = (scan - lenb) - extra_start
+            seek = (pos - lenb) - (lastpos + lenf)
+            out += varint(lenf) + varint(extra_len) + varint(zigzag(seek))
+            out += bytes((new[lastscan + i] - old[lastpos + i]) & 0xFF for i in range(lenf))
+            out += new[extra_start:extra_start + extra_len]
+
+            lastscan = scan - lenb
+            lastpos = pos - lenb
+            lastoffset = pos - scan
+
+    return bytes(out)
+
+
+def delta_apply(old, patch):
+    """Penerap acuan (sama dengan ota_delta.cpp) untuk verifikasi."""
+    if patch[:4] != DELTA_MAGIC:
+        raise ValueError("magic delta salah")
+    p = 4
+    out = bytearray()
+    src = 0
+
+    def read_varint():
+        nonlocal p
+        value = shift = 0
+        while True:
+            b = patch[p]
+            p += 1
+            value |= (b & 0x7F) << shift
+            if not b & 0x80:
+                return value
+            shift += 7
+
+    while p < len(patch):
+        diff_len = read_varint()
+        extra_len = read_varint()
+        z = read_varint()
+        seek = (z >> 1) ^ -(z & 1)
+        out += bytes((old[src + i] + patch[p + i]) & 0xFF for i in range(diff_len))
+        p += diff_len
+        src += diff_len
+        out += patch[p:p + extra_len]
+        p += extra_len
+        src += seek
+    return bytes(out)
+
+
+def esp_image_sha256(image):
+    """Sama dengan esp_partition_get_sha256() untuk partisi app: bila header
+    menandai hash_appended, pakai digest yang ditempel di akhir image."""
+    if len(image) > 32 and image[0] == 0xE9 and image[23] == 1:
+        return image[-32:].hex()
+    return hashlib.sha256(image).hexdigest()
+
+
+def crc32_hex(data):
+    return "%08x" % (zlib.crc32(data) & 0xFFFFFFFF)
+
+
+# ---------------------------------------------------------------------------
+# Trailer tanda tangan (format = include/ota_sig.h). Penandatanganan memakai
+# CLI openssl: ECDSA P-256 atas SHA-256(image || header trailer 32 byte).
+SIG_MAGIC = b"JSIG"
+SIG_VERSION = 1
+SIG_TRAILER_LEN = 128
+SIG_SIGNED_LEN = 32
+SIG_TARGET_MAX = 24
+DEFAULT_TARGET = "jacktor-amp"
+PUBKEY_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                             "..", "firmware", "amplifier", "include", "ota_pubkey.h")
+
+
+def has_sig_trailer(blob):
+    return (len(blob) > SIG_TRAILER_LEN and blob[-SIG_TRAILER_LEN:][:4] == SIG_MAGIC
+            and blob[-SIG_TRAILER_LEN + 4] == SIG_VERSION)
+
+
+def strip_sig(blob):
+    return blob[:-SIG_TRAILER_LEN] if has_sig_trailer(blob) else blob
+
+
+def openssl(*args, data=None):
+    return subprocess.run(["openssl", *args], input=data, capture_output=True, check=True).stdout
+
+
+def sig_header(target):
+    tid = target.encode()
+    if len(tid) >= SIG_TARGET_MAX:
+        raise ValueError(f"target id maks. {SIG_TARGET_MAX - 1} karakter")
+    return SIG_MAGIC + bytes([SIG_VERSION, 0, 0, 0]) + tid.ljust(SIG_TARGET_MAX, b"\0")
+
+
+def sign_image(image, key, target):
+    header = sig_header(target)
+    sig = openssl("dgst", "-sha256", "-sign", key, data=image + header)
+    room = SIG_TRAILER_LEN - SIG_SIGNED_LEN - 1
+    if len(sig) > room:
+        raise ValueError("signature DER terlalu panjang (kunci bukan P-256?)")
+    return header + bytes([len(sig)]) + sig.ljust(room, b"\0")
+
+
+def verify_image(blob, pubkey_der):
+    trailer = blob[-SIG_TRAILER_LEN:]
+    sig = trailer[SIG_SIGNED_LEN + 1:SIG_SIGNED_LEN + 1 + trailer[SIG_SIGNED_LEN]]
+    with tempfile.TemporaryDirectory() as tmp:
+        pub = os.path.join(tmp, "pub.der")
+        sigf = os.path.join(tmp, "sig.der")
+        with open(pub, "wb") as f:
+            f.write(pubkey_der)
+        with open(sigf, "wb") as f:
+            f.write(sig)
+        try:
+            openssl("dgst", "-sha256", "-verify", pub, "-keyform", "DER", "-signature", sigf,
+                    data=blob[:-SIG_TRAILER_LEN] + trailer[:SIG_SIGNED_LEN])
+        except subprocess.CalledProcessError:
+            return False
+    return True
+
+
+def begin_base(blob):
+    begin = {"size": len(blob), "crc32": crc32_hex(blob)}
+    if has_sig_trailer(blob):
+        begin["sig"] = True
+    return begin
+
+
+def cmd_info(args):
+    with open(args.input, "rb") as f:
+        image = f.read()
+    print(json.dumps({"ota_begin": begin_base(image)}))
+    return 0
+
+
+def cmd_compress(args):
+    with open(args.input, "rb") as f:
+        image = f.read()
+    packed = heatshrink_compress(image, args.window, args.lookahead)
+    check = heatshrink_decompress(packed, args.window, args.lookahead)[:len(image)]
+    if check != image:
+        print("ERROR: verifikasi dekompresi gagal", file=sys.stderr)
+        return 1
+    with open(args.output, "wb") as f:
+        f.write(packed)
+
+    ratio = 100.0 * len(packed) / len(image) if image else 0.0
+    print(f"{args.input}: {len(image)} -> {len(packed)} byte ({ratio:.1f}%)", file=sys.stderr)
+    begin = begin_base(image)
+    begin["comp"] = {"alg": "heatshrink", "w": args.window, "l": args.lookahead, "size": len(packed)}
+    begin["stage_crc32"] = crc32_hex(packed)  # diverifikasi relay bridge, dibuang sebelum ke amp
+    print(json.dumps({"ota_begin": begin}))
+    return 0
+
+
+def cmd_delta(args):
+    with open(args.old, "rb") as f:
+        old = strip_sig(f.read())  # partisi app hanya berisi image, tanpa trailer
+    with open(args.new, "rb") as f:
+        new = f.read()
+    patch = delta_encode(old, new)
+    if delta_apply(old, patch) != new:
+        print("ERROR: verifikasi patch gagal", file=sys.stderr)
+        return 1
+
+    begin = begin_base(new)
+    begin["sha256"] = hashlib.sha256(new).hexdigest()
+    begin["src_sha256"] = esp_image_sha256(old)
+    begin["delta"] = True
+    stream = patch
+    if args.raw:
+        begin["stream_size"] = len(patch)
+    else:
+        stream = heatshrink_compress(patch, args.window, args.lookahead)
+        check = heatshrink_decompress(stream, args.window, args.lookahead)[:len(patch)]
+        if check != patch:
+            print("ERROR: verifikasi dekompresi gagal", file=sys.stderr)
+            return 1
+        begin["comp"] = {"alg": "heatshrink", "w": args.window, "l": args.lookahead, "size": len(stream)}
+
+    begin["stage_crc32"] = crc32_hex(stream)  # diverifikasi relay bridge, dibuang sebelum ke amp
+    with open(args.output, "wb") as f:
+        f.write(stream)
+    ratio = 100.0 * len(stream) / len(new) if new else 0.0
+    print(f"{args.new}: {len(new)} -> patch {len(patch)} -> kirim {len(stream)} byte ({ratio:.1f}%)",
+          file=sys.stderr)
+    print(json.dumps({"ota_begin": begin}))
+    return 0
+
+
+def cmd_keygen(args):
+    if os.path.exists(args.key):
+        print(f"ERROR: {args.key} sudah ada, tidak ditimpa", file=sys.stderr)
+        return 1
+    openssl("ecparam", "-name", "prime256v1", "-genkey", "-noout", "-out", args.key)
+    der = openssl("ec", "-in", args.key, "-pubout", "-outform", "DER")
+    rows = ",\n".join("    " + ", ".join("0x%02x" % b for b in der[i:i + 12])
+                      for i in range(0, len(der), 12))
+    with open(args.header, "w", newline="\n") as f:
+        f.write("#pragma once\n#include <stdint.h>\n\n"
+                "// Kunci publik ECDSA P-256 (DER SubjectPublicKeyInfo) untuk image OTA bertanda tangan.\n"
+                "// Dibuat oleh: python tools/ota_pack.py keygen ota_sign_key.pem\n"
+                "// Private key JANGAN di-commit. Panjang 0 = belum di-provision (image \"sig\" ditolak).\n"
+                f"#define OTA_SIGN_PUBKEY_LEN {len(der)}\n"
+                f"static const uint8_t kOtaSignPubKey[] = {{\n{rows}\n}};\n")
+    print(f"private key: {args.key} (simpan di luar repo)\npublic key : {args.header}", file=sys.stderr)
+    return 0
+
+
+def cmd_sign(args):
+    with open(args.input, "rb") as f:
+        image = f.read()
+    if has_sig_trailer(image):
+        print("ERROR: image sudah bertanda tangan", file=sys.stderr)
+        return 1
+    blob = image + sign_image(image, args.key, args.target)
+    pub = openssl("ec", "-in", args.key, "-pubout", "-outform", "DER")
+    if not verify_image(blob, pub):
+        print("ERROR: verifikasi tanda tangan gagal", file=sys.stderr)
+        return 1
+    with open(args.output, "wb") as f:
+        f.write(blob)
+    print(f"{args.input}: +{SIG_TRAILER_LEN} byte trailer, target {args.target}", file=sys.stderr)
+    print(json.dumps({"ota_begin": begin_base(blob)}))
+    return 0
+
+
+class OtaLink:
+    """Baris JSON ke/dari amplifier; hanya frame type "ota" yang dikembalikan."""
+
+    def __init__(self, port, baud):
+        import serial  # hanya dibutuhkan subcommand bench
+        self.ser = serial.Serial(port, baud, timeout=0.05)
+        self.ser.reset_input_buffer()
+        self.buf = b""
+
+    def send(self, cmd):
+        line = json.dumps({"type": "cmd", "cmd": cmd}, separators=(",", ":"))
+        self.ser.write(line.encode() + b"\n")
+
+    def recv(self, deadline):
+        while time.monotonic() < deadline:
+            nl = self.buf.find(b"\n")
+            if nl < 0:
+                self.buf += self.ser.read(self.ser.in_waiting or 1)
+                continue
+            line, self.buf = self.buf[:nl], self.buf[nl + 1:]
+            try:
+                msg = json.loads(line)
+            except ValueError:
+                continue
+            if isinstance(msg, dict) and msg.get("type") == "ota":
+                return msg
+        return None
+
+    def wait_evt(self, names, timeout):
+        deadline = time.monotonic() + timeout
+        while True:
+            msg = self.recv(deadline)
+            if msg is None or msg.get("evt") in names:
+                return msg
+
+
+def bench_upload(link, image, chunk, window, timeout):
+    link.send({"ota_abort": True})
+    link.wait_evt(("abort_ok",), 2.0)
+    link.send({"ota_begin": {"size": len(image), "crc32": crc32_hex(image)}})
+    msg = link.wait_evt(("begin_ok", "begin_err"), 5.0)
+    if not msg or msg["evt"] != "begin_ok":
+        raise RuntimeError(f"ota_begin gagal: {msg}")
+    window = min(window, msg.get("window", window))
+
+    chunks = [image[i:i + chunk] for i in range(0, len(image), chunk)]
+    next_seq = 0   # seq tertua yang belum di-ack
+    send_seq = 0
+    rewound_to = -1  # satu rewind per celah; write_err susulan untuk celah sama diabaikan
+    stalls = 0     # timeout berturut-turut
+    resends = 0
+    t0 = time.monotonic()
+    while next_seq < len(chunks):
+        while send_seq < len(chunks) and send_seq < next_seq + window:
+            data = chunks[send_seq]
+            link.send({"ota_write": {"seq": send_seq, "crc32": crc32_hex(data),
+                                     "data_b64": base64.b64encode(data).decode()}})
+            send_seq += 1
+        msg = link.recv(time.monotonic() + timeout)
+        if msg is None:
+            # Tidak ada ack: ulang dari chunk tertua
+            stalls += 1
+            if stalls > 5:
+                raise RuntimeError(f"timeout pada seq {next_seq}")
+            resends += send_seq - next_seq
+            send_seq = next_seq
+            continue
+        evt = msg.get("evt")
+        if evt == "error":
+            raise RuntimeError(f"OTA error: {msg.get('err')}")
+        if evt == "write_err" and msg.get("err") not in ("window", "crc", "b64_decode"):
+            raise RuntimeError(f"write_err: {msg.get('err')}")
+        if evt in ("write_ok", "write_err"):
+            nxt = msg.get("next", next_seq)
+            if nxt > next_seq:
+                next_seq = nxt
+                stalls = 0
+            if evt == "write_err" and rewound_to != next_seq:
+                resends += send_seq - next_seq
+                send_seq = next_seq
+                rewound_to = next_seq
+    elapsed = time.monotonic() - t0
+    link.send({"ota_abort": True})
+    link.wait_evt(("abort_ok",), 2.0)
+    return elapsed, resends
+
+
+def cmd_bench(args):
+    with open(args.image, "rb") as f:
+        image = f.read()
+    if args.limit:
+        image = image[:args.limit]
+    sizes = [int(x) for x in args.chunks.split(",") if x]
+    link = OtaLink(args.port, args.baud)
+    print(f"{'chunk':>6} {'detik':>8} {'KiB/s':>8} {'resend':>6}")
+    results = []
+    for chunk in sizes:
+        # Baris JSON (base64 + overhead) harus muat COMMS_RX_LINE_MAX
+        if chunk <= 0 or (chunk + 2) // 3 * 4 + 96 > args.line_max:
+            print(f"{chunk:>6} dilewati (melebihi batas baris {args.line_max})")
+            continue
+        elapsed, resends = bench_upload(link, image, chunk, args.window, args.timeout)
+        rate = len(image) / 1024.0 / elapsed if elapsed > 0 else 0.0
+        results.append({"chunk": chunk, "seconds": round(elapsed, 3),
+                        "kib_s": round(rate, 1), "resends": resends})
+        print(f"{chunk:>6} {elapsed:>8.2f} {rate:>8.1f} {resends:>6}")
+    if args.json:
+        print(json.dumps({"bench": {"bytes": len(image), "results": results}}))
+    return 0
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Persiapan image OTA Jacktor Audio")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("info", help="ukuran & CRC32 image")
+    p.add_argument("input")
+    p.set_defaults(func=cmd_info)
+
+    p = sub.add_parser("keygen", help="buat kunci tanda tangan + header kunci publik firmware")
+    p.add_argument("key", help="file private key PEM yang dibuat (jangan di-commit)")
+    p.add_argument("--header", default=PUBKEY_HEADER, help="keluaran ota_pubkey.h")
+    p.set_defaults(func=cmd_keygen)
+
+    p = sub.add_parser("sign", help="tempel trailer tanda tangan ECDSA P-256")
+    p.add_argument("input")
+    p.add_argument("output")
+    p.add_argument("-k", "--key", required=True, help="private key PEM (P-256)")
+    p.add_argument("-t", "--target", default=DEFAULT_TARGET, help="target id (= OTA_SIGN_TARGET)")
+    p.set_defaults(func=cmd_sign)
+
+    p = sub.add_parser("compress", help="kompres image dengan heatshrink")
+    p.add_argument("input")
+    p.add_argument("output")
+    p.add_argument("-w", "--window", type=int, default=10, help="window bits (4..12 untuk amplifier)")
+    p.add_argument("-l", "--lookahead", type=int, default=5, help="lookahead bits (3..w-1)")
+    p.set_defaults(func=cmd_compress)
+
+    p = sub.add_parser("delta", help="patch dari image yang berjalan ke image baru")
+    p.add_argument("old", help="image yang sedang berjalan di amplifier")
+    p.add_argument("new", help="image baru")
+    p.add_argument("output")
+    p.add_argument("--raw", action="store_true", help="jangan kompres patch")
+    p.add_argument("-w", "--window", type=int, default=10, help="window bits heatshrink")
+    p.add_argument("-l", "--lookahead", type=int, default=5, help="lookahead bits heatshrink")
+    p.set_defaults(func=cmd_delta)
+
+    p = sub.add_parser("bench", help="benchmark throughput upload OTA per ukuran chunk")
+    p.add_argument("port", help="port serial amplifier (mis. /dev/ttyUSB0, COM5)")
+    p.add_argument("image", help="image yang diunggah (tidak di-commit, sesi di-abort)")
+    p.add_argument("-c", "--chunks", default="256,512,1024,2048", help="daftar ukuran chunk (byte)")
+    p.add_argument("-b", "--baud", type=int, default=921600)
+    p.add_argument("--window", type=int, default=4, help="ota_write in-flight maks.")
+    p.add_argument("--limit", type=int, default=0, help="hanya kirim N byte pertama")
+    p.add_argument("--timeout", type=float, default=2.0, help="batas tunggu ack (detik)")
+    p.add_argument("--line-max", type=int, default=4096, help="COMMS_RX_LINE_MAX firmware")
+    p.add_argument("--json", action="store_true", help="cetak ringkasan JSON di akhir")
+    p.set_defaults(func=cmd_bench)
+
+    args = ap.parse_args(argv)
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())